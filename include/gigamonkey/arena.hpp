@@ -0,0 +1,72 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_ARENA
+#define GIGAMONKEY_ARENA
+
+#include <gigamonkey/types.hpp>
+
+namespace Gigamonkey {
+
+    // A buffer which grows as things are written to the end of it and
+    // which is emptied all at once. Since the buffer may move as it grows,
+    // anything written to it is referred to by its position. The memory
+    // is kept after clear(), so that a long run of similar jobs stops
+    // allocating once the arena is big enough for one of them.
+    class arena {
+        bytes Buffer;
+        size_t Size;
+
+    public:
+        struct span {
+            size_t Offset;
+            size_t Size;
+        };
+
+        explicit arena(size_t capacity = 0) : Buffer(capacity), Size{0} {}
+
+        // the number of bytes that have been written.
+        size_t size() const {
+            return Size;
+        }
+
+        size_t capacity() const {
+            return Buffer.size();
+        }
+
+        // make room for n more bytes at the end.
+        span allocate(size_t n) {
+            if (Size + n > Buffer.size()) Buffer.resize(std::max(2 * Buffer.size(), Size + n));
+            span x{Size, n};
+            Size += n;
+            return x;
+        }
+
+        span append(bytes_view b) {
+            span x = allocate(b.size());
+            std::copy(b.begin(), b.end(), Buffer.begin() + x.Offset);
+            return x;
+        }
+
+        bytes_writer writer(span x) {
+            return bytes_writer{Buffer.begin() + x.Offset, Buffer.begin() + x.Offset + x.Size};
+        }
+
+        // only valid until the next allocation.
+        bytes_view view(span x) const {
+            return bytes_view{Buffer.data() + x.Offset, x.Size};
+        }
+
+        // the span from the beginning of a to the end of b.
+        static span join(span a, span b) {
+            return span{a.Offset, b.Offset + b.Size - a.Offset};
+        }
+
+        void clear() {
+            Size = 0;
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_BLOCK_STORE
+#define GIGAMONKEY_BLOCK_STORE
+
+#include <gigamonkey/headers.hpp>
+#include <gigamonkey/txid_index.hpp>
+#include <array>
+#include <mutex>
+#include <string>
+
+namespace Gigamonkey::Bitcoin {
+
+    // A timechain kept in a single file on disk in the same format as the
+    // blk*.dat files written by a node: each block is preceded by four
+    // magic bytes and its size as a uint32_little. Blocks are indexed as they
+    // are added, so that looking up a transaction is a single read. The
+    // txid index is kept next to the file with the extension .txids.
+    class block_store final : public timechain {
+    public:
+        using magic = std::array<byte, 4>;
+        constexpr static magic Mainnet{0xe3, 0xe1, 0xf3, 0xe8};
+
+        struct position {
+            uint64 Height;
+            uint64 Offset; // in the file.
+            uint32 Size;
+        };
+
+    private:
+        struct block_entry {
+            uint64 Offset; // of the block itself, after the magic and size.
+            uint32 Size;
+        };
+
+        // every level of the Merkle tree of a block, starting with the txids.
+        using merkle_levels = std::vector<std::vector<digest256>>;
+
+        std::string Path;
+        magic Magic;
+        int File;
+        uint64 End;
+
+        header_store Headers;
+        std::vector<block_entry> Blocks;
+        std::unordered_map<digest256, uint64> Roots;
+        txid_index Index;
+
+        // Merkle trees of the blocks we've looked at recently.
+        mutable std::mutex Mutex;
+        mutable std::unordered_map<uint64, ptr<merkle_levels>> Trees;
+        mutable std::vector<uint64> Recent;
+        size_t CacheSize;
+
+        // The txids of a block that can be added to the tip: it must connect
+        // to the tip, be new and match its Merkle root. Empty if it cannot.
+        std::vector<txid> check(bytes_view block) const;
+
+        // index a block which has been checked and written at the given offset.
+        bool index(bytes_view block, const std::vector<txid>&, uint64 offset);
+
+        // a block whose transactions are already in the txid index.
+        bool index(const slice<80> header, uint64 offset, uint32 size);
+
+        // look up a txid and read the transaction.
+        std::optional<position> locate(const txid&, bytes* tx) const;
+
+        // find a block by header hash or Merkle root.
+        std::optional<uint64> find(const digest256&) const;
+
+        ptr<merkle_levels> tree(uint64 height) const;
+
+        bytes read(uint64 offset, size_t size) const;
+
+    public:
+        // Open the store at the given path, creating it if it does not exist,
+        // and index any blocks already in it. base is the height of the first block.
+        explicit block_store(const std::string& path, uint64 base = 0,
+            const magic& m = Mainnet, size_t cache_size = 16);
+
+        ~block_store();
+
+        block_store(const block_store&) = delete;
+        block_store& operator=(const block_store&) = delete;
+
+        // whether the file could be opened and read.
+        bool valid() const {
+            return File >= 0;
+        }
+
+        uint64 height() const {
+            return Headers.height();
+        }
+
+        size_t size() const {
+            return Blocks.size();
+        }
+
+        const header_store& chain() const {
+            return Headers;
+        }
+
+        // Add a block to the tip. It must parse, connect to the tip and
+        // match its Merkle root. Returns false if the block was not added,
+        // including if it could not be written.
+        bool add(bytes_view block);
+
+        // Add every block in a blk*.dat file in order, stopping at the first
+        // that cannot be added. Returns the number of blocks added.
+        uint32 ingest(const std::string& path);
+
+        std::optional<position> locate(const txid& id) const {
+            return locate(id, nullptr);
+        }
+
+        list<uint<80>> headers(uint64 since_height) const override;
+
+        header_range headers(uint64 from, uint64 to) const override {
+            return Headers.headers(from, to);
+        }
+
+        header_range headers(const locator& l, uint32 max) const override {
+            return Headers.headers(l, max);
+        }
+
+        header_range headers_to_tip(const digest<32>& d) const override {
+            return Headers.headers_to_tip(d);
+        }
+
+        locator locate() const override {
+            return Headers.locate();
+        }
+
+        bytes transaction(const digest<32>&) const override;
+        Merkle::path merkle_path(const digest<32>&) const override;
+        uint<80> header(const digest<32>&) const override;
+        list<txid> transactions(const digest<32>&) const override;
+        bytes block(const digest<32>&) const override;
+    };
+
+}
+
+#endif
@@ -75,7 +75,23 @@ namespace Gigamonkey {
                 return valid() ? Bitcoin::hash256(write()) : digest256{};
             }
             
-            static output_script read(bytes);
+            static output_script read(bytes_view);
+            
+            // The pattern of a Boost output script. The arguments are
+            // the parts that vary, in the order they are captured. 
+            static Bitcoin::pattern pattern(
+                bytes& miner_address, 
+                bytes& category, 
+                bytes& content, 
+                bytes& target, 
+                bytes& tag, 
+                bytes& user_nonce, 
+                bytes& data);
+            
+            static const Bitcoin::matcher& compiled();
+            
+            // An output script from the captures of compiled(). 
+            static output_script from_captures(const bytes_view*);
             
             explicit output_script(bytes b) : output_script{read(b)} {}
         
@@ -94,45 +110,26 @@ namespace Gigamonkey {
                 return !operator==(o);
             }
             
-            static Boost::type type(script x) {
-                return read(x).Type;
-            }
+            // These read only the part of the script that is asked for. 
+            static Boost::type type(bytes_view x);
             
-            static bool valid(script x) {
-                return read(x).valid();
-            }
+            static bool valid(bytes_view x);
             
-            static uint256 hash(script x) {
-                return read(x).hash();
-            }
+            static uint256 hash(bytes_view x);
             
-            static int32_little version(script x) {
-                return read(x).Type;
-            }
+            static int32_little version(bytes_view x);
             
-            static uint256 content(script x) {
-                return read(x).Content;
-            }
+            static uint256 content(bytes_view x);
             
-            static work::target target(script x) {
-                return read(x).Target;
-            }
+            static work::target target(bytes_view x);
             
-            static bytes tag(script x) {
-                return read(x).Tag;
-            }
+            static bytes tag(bytes_view x);
             
-            static uint32_little user_nonce(script x) {
-                return read(x).UserNonce;
-            }
+            static uint32_little user_nonce(bytes_view x);
             
-            static bytes additional_data(script x) {
-                return read(x).AdditionalData;
-            }
+            static bytes additional_data(bytes_view x);
             
-            static digest160 miner_address(script x) {
-                return read(x).MinerAddress;
-            }
+            static digest160 miner_address(bytes_view x);
             
         private:
             output_script(
@@ -182,6 +179,86 @@ namespace Gigamonkey {
             
         };
     
+        // The parts of a Boost output script, which point into the script. 
+        // Reading one is much faster than output_script::read because 
+        // it only checks a fixed layout: the "boostpow" push, pushes 
+        // of the right sizes and then the part of the script which 
+        // is the same for every Boost output, compared all at once. 
+        struct output_script_view {
+            Boost::type Type;
+            bytes_view MinerAddress; // empty for bounty scripts. 
+            bytes_view Category;
+            bytes_view Content;
+            bytes_view Target;
+            bytes_view Tag;
+            bytes_view UserNonce;
+            bytes_view AdditionalData;
+            
+            output_script_view() : Type{Boost::invalid}, 
+                MinerAddress{}, Category{}, Content{}, Target{}, 
+                Tag{}, UserNonce{}, AdditionalData{} {}
+            
+            bool valid() const {
+                return Type != Boost::invalid;
+            }
+            
+            static output_script_view read(bytes_view);
+            
+            explicit operator output_script() const;
+        };
+        
+        inline Boost::type output_script::type(bytes_view x) {
+            return output_script_view::read(x).Type;
+        }
+        
+        inline bool output_script::valid(bytes_view x) {
+            return output_script_view::read(x).valid();
+        }
+        
+        inline uint256 output_script::hash(bytes_view x) {
+            return read(x).hash();
+        }
+        
+        inline int32_little output_script::version(bytes_view x) {
+            return output_script_view::read(x).Type;
+        }
+        
+        inline uint256 output_script::content(bytes_view x) {
+            output_script_view v = output_script_view::read(x);
+            uint256 content{};
+            if (v.valid()) std::copy(v.Content.begin(), v.Content.end(), content.data());
+            return content;
+        }
+        
+        inline work::target output_script::target(bytes_view x) {
+            output_script_view v = output_script_view::read(x);
+            work::target target{};
+            if (v.valid()) std::copy(v.Target.begin(), v.Target.end(), target.data());
+            return target;
+        }
+        
+        inline bytes output_script::tag(bytes_view x) {
+            return bytes(output_script_view::read(x).Tag);
+        }
+        
+        inline uint32_little output_script::user_nonce(bytes_view x) {
+            output_script_view v = output_script_view::read(x);
+            uint32_little user_nonce{};
+            if (v.valid()) std::copy(v.UserNonce.begin(), v.UserNonce.end(), user_nonce.data());
+            return user_nonce;
+        }
+        
+        inline bytes output_script::additional_data(bytes_view x) {
+            return bytes(output_script_view::read(x).AdditionalData);
+        }
+        
+        inline digest160 output_script::miner_address(bytes_view x) {
+            output_script_view v = output_script_view::read(x);
+            digest160 miner_address{};
+            if (v.Type == Boost::contract) std::copy(v.MinerAddress.begin(), v.MinerAddress.end(), miner_address.begin());
+            return miner_address;
+        }
+    
         struct output {
             Bitcoin::outpoint Reference;
             output_script Script;
@@ -279,7 +356,7 @@ namespace Gigamonkey {
                 return input_script{signature, pubkey, nonce, timestamp, extra_nonce_2, extra_nonce_1};
             }
             
-            static input_script read(bytes); 
+            static input_script read(bytes_view); 
             
             explicit input_script(bytes b) : input_script{read(b)} {}
         
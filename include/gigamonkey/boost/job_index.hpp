@@ -0,0 +1,101 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_BOOST_JOB_INDEX
+#define GIGAMONKEY_BOOST_JOB_INDEX
+
+#include <gigamonkey/boost/boost.hpp>
+#include <gigamonkey/timechain.hpp>
+#include <map>
+#include <optional>
+#include <unordered_map>
+
+namespace Gigamonkey::Boost {
+
+    // The open Boost outputs found in some transactions and blocks. Outputs are
+    // removed when a transaction that spends them is added. Besides by
+    // outpoint, jobs can be looked up by content, category, tag or a range
+    // of difficulty. Transactions in a block must be added in order.
+    class job_index {
+    public:
+        struct job {
+            Boost::output Output;
+            double Difficulty;
+        };
+
+    private:
+        template <typename K> using by = std::multimap<K, Bitcoin::outpoint>;
+
+        by<uint256> ByContent;
+        by<int64> ByCategory;
+        by<bytes> ByTag;
+        by<double> ByDifficulty;
+
+        // A job and where it is in each of the maps above, so that it can
+        // be removed without searching among jobs with the same key.
+        struct entry {
+            job Job;
+            by<uint256>::iterator Content;
+            by<int64>::iterator Category;
+            by<bytes>::iterator Tag;
+            by<double>::iterator Difficulty;
+        };
+
+        std::unordered_map<Bitcoin::outpoint, entry> Jobs;
+
+        template <typename K>
+        std::vector<job> find(const by<K>& m, const K& k) const {
+            std::vector<job> jobs{};
+            auto range = m.equal_range(k);
+            for (auto i = range.first; i != range.second; i++) jobs.push_back(Jobs.at(i->second).Job);
+            return jobs;
+        }
+
+    public:
+        job_index() : ByContent{}, ByCategory{}, ByTag{}, ByDifficulty{}, Jobs{} {}
+
+        // Remove the outputs that a transaction spends and add its Boost
+        // outputs. Returns the number of jobs added.
+        uint32 add_transaction(bytes_view tx);
+
+        // Returns false if the block cannot be read.
+        bool add_block(bytes_view block);
+
+        bool add_block(const Bitcoin::timechain& t, const digest256& hash) {
+            return add_block(t.block(hash));
+        }
+
+        // false if the output is invalid or already in the index.
+        bool add(const Boost::output&);
+
+        bool remove(const Bitcoin::outpoint&);
+
+        size_t size() const {
+            return Jobs.size();
+        }
+
+        std::optional<job> find(const Bitcoin::outpoint& o) const {
+            auto x = Jobs.find(o);
+            if (x == Jobs.end()) return {};
+            return x->second.Job;
+        }
+
+        std::vector<job> by_content(const uint256& content) const {
+            return find(ByContent, content);
+        }
+
+        std::vector<job> by_category(int32_little category) const {
+            return find(ByCategory, int64(category));
+        }
+
+        std::vector<job> by_tag(bytes_view tag) const {
+            return find(ByTag, bytes(tag));
+        }
+
+        // jobs with difficulty in [min, max], from least to most difficult.
+        std::vector<job> by_difficulty(double min, double max) const;
+    };
+
+}
+
+#endif
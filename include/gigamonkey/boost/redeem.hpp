@@ -0,0 +1,47 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_BOOST_REDEEM
+#define GIGAMONKEY_BOOST_REDEEM
+
+#include <gigamonkey/boost/boost.hpp>
+#include <gigamonkey/arena.hpp>
+
+namespace Gigamonkey::Boost {
+
+    // A Boost output and a proof that solves it.
+    struct solved_output {
+        Bitcoin::outpoint Outpoint;
+        satoshi Value;
+        Boost::proof Proof;
+
+        bool valid() const {
+            return Outpoint.valid() && Proof.Type != invalid && Proof.valid();
+        }
+    };
+
+    // A signature is at most 72 bytes in DER format and is followed by its sighash directive.
+    constexpr size_t MaxSignatureSize = 73;
+
+    // The greatest size of an input script that redeems a Boost output.
+    // Everything but the signature is always the same size.
+    size_t input_script_size(type, bool compressed_pubkey);
+
+    // Redeem many Boost outputs in one transaction which pays everything but
+    // the fee to one address. Every output must have been solved by the given
+    // key. The transaction is signed with sighash all and fork id, and the parts
+    // of the signature hash that every input shares are computed only once.
+    // The fee is the fee rate (satoshis per byte) times the size of the
+    // transaction, which is known exactly except for the signatures, which are
+    // counted at MaxSignatureSize. Therefore the fee rate is never less than
+    // the one given. The span is empty if any output is not solved by the key
+    // or if the fee is more than the outputs are worth.
+    arena::span redeem(arena&, const std::vector<solved_output>&, const Bitcoin::secret&,
+        const digest160& pay_to, double fee_rate, int32_little locktime = 0);
+
+    bytes redeem(const std::vector<solved_output>&, const Bitcoin::secret&,
+        const digest160& pay_to, double fee_rate, int32_little locktime = 0);
+
+}
+
+#endif
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_BOOST_SCHEDULER
+#define GIGAMONKEY_BOOST_SCHEDULER
+
+#include <gigamonkey/boost/boost.hpp>
+#include <mutex>
+#include <optional>
+#include <set>
+#include <unordered_map>
+
+namespace Gigamonkey::Boost {
+
+    // Open Boost outputs ranked by profitability, which is the satoshis
+    // they pay after the fee to redeem them per unit of difficulty. Solver
+    // threads claim the best job that no other thread has and then either
+    // release it or remove it once it is solved or spent. A job is never
+    // given to two threads at once. Everything is O(log n) except changing
+    // the fee, which ranks every job again. Any thread may call any method.
+    class scheduler {
+    public:
+        struct job {
+            Boost::output Output;
+            double Difficulty;
+            double Profitability;
+        };
+
+    private:
+        struct rank {
+            double Profitability;
+            Bitcoin::outpoint Outpoint;
+
+            // most profitable first.
+            bool operator<(const rank& r) const;
+        };
+
+        struct entry {
+            job Job;
+            bool Claimed;
+        };
+
+        mutable std::mutex Mutex;
+        satoshi Fee;
+        std::unordered_map<Bitcoin::outpoint, entry> Jobs;
+        std::set<rank> Open; // the jobs that are not claimed.
+
+        double profitability(const Boost::output&, double difficulty) const;
+
+    public:
+        // the fee to redeem a Boost output.
+        explicit scheduler(satoshi fee = 0) : Mutex{}, Fee{fee}, Jobs{}, Open{} {}
+
+        void add(const Boost::output&);
+
+        // remove a job whether or not it is claimed.
+        bool remove(const Bitcoin::outpoint&);
+
+        // change the fee and rank every job again.
+        void set_fee(satoshi);
+
+        // Claim the most profitable job that has not been claimed, but not
+        // one that is less profitable than the given price, which is what
+        // a unit of difficulty costs to mine.
+        std::optional<job> claim(price minimum = 0);
+
+        // let another thread work on a job.
+        bool release(const Bitcoin::outpoint&);
+
+        // the most profitable unclaimed jobs.
+        std::vector<job> best(uint32 count) const;
+
+        size_t size() const;
+        size_t claimed() const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,48 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_BOOST_SOLVER
+#define GIGAMONKEY_BOOST_SOLVER
+
+#include <gigamonkey/boost/boost.hpp>
+#include <gigamonkey/midstate.hpp>
+#include <optional>
+
+namespace Gigamonkey::Boost {
+
+    // Searches for solutions to a Boost puzzle. The metadata document is
+    // Tag ‖ MinerAddress ‖ ExtraNonce1 ‖ ExtraNonce2 ‖ UserNonce ‖ AdditionalData,
+    // and everything before ExtraNonce2 is the same for every attempt, so
+    // it is hashed once when the solver is made. Likewise the first 64 bytes
+    // of the work string are hashed once per extra nonce rather than once
+    // per nonce. Hashes are computed midstate::lanes at a time.
+    class solver {
+        Boost::puzzle Puzzle;
+        uint256 Target;
+        midstate Meta;
+
+    public:
+        explicit solver(const Boost::puzzle&);
+
+        bool valid() const {
+            return Puzzle.valid();
+        }
+
+        // the same as Boost::proof{Puzzle, solution}.merkle_root().
+        digest256 merkle_root(uint64_little extra_nonce_2) const;
+
+        // the Merkle roots for count extra nonces in a row, starting with first.
+        std::vector<digest256> merkle_roots(uint64 first, size_t count) const;
+
+        // Try count nonces starting with that of the given solution. Returns
+        // the first solution that works.
+        std::optional<work::solution> solve(const work::solution&, uint32 count) const;
+
+        Boost::proof proof(const work::solution& x) const {
+            return Boost::proof{Puzzle, x};
+        }
+    };
+
+}
+
+#endif
@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_CLASSIFIER
+#define GIGAMONKEY_CLASSIFIER
+
+#include <gigamonkey/script.hpp>
+#include <array>
+
+namespace Gigamonkey::Bitcoin {
+
+    // Finds which of a set of script templates a script matches. The templates
+    // are compiled into matchers and indexed by the first byte of the scripts they
+    // can match, so that usually only one of them needs to be tried. Templates
+    // which begin with fixed instructions are checked against those before
+    // anything else. If more than one template matches, the first added wins.
+    class classifier {
+    public:
+        using id = uint32;
+        constexpr static id none = 0xffffffff;
+
+        constexpr static uint32 MaxCaptures = 16;
+
+        struct result {
+            id Template;
+            uint32 Captures;
+            bytes_view Capture[MaxCaptures];
+
+            result() : Template{none}, Captures{0}, Capture{} {}
+
+            bool valid() const {
+                return Template != none;
+            }
+
+            bytes_view operator[](uint32 i) const {
+                return Capture[i];
+            }
+        };
+
+    private:
+        std::vector<matcher> Templates;
+        std::array<std::vector<id>, 256> First;
+
+    public:
+        classifier() : Templates{}, First{} {}
+
+        // returns the id of the new template, which is the number of templates
+        // added before it, or none if it has more than MaxCaptures captures.
+        id add(const matcher&);
+
+        id add(const pattern& p) {
+            return add(matcher{p});
+        }
+
+        size_t size() const {
+            return Templates.size();
+        }
+
+        const matcher& operator[](id i) const {
+            return Templates[i];
+        }
+
+        result classify(bytes_view script) const;
+
+        // the ids of the templates in standard().
+        enum standard_template : id {
+            pay_to_address,
+            pay_to_pubkey,
+            op_return,
+            boost
+        };
+
+        // P2PKH, P2PK, OP_RETURN data and Boost outputs. Captures are the same as
+        // those of pay_to_address::compiled(), pay_to_pubkey::compiled() and
+        // Boost::output_script::compiled().
+        static const classifier& standard();
+    };
+
+}
+
+#endif
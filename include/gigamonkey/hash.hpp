@@ -290,6 +290,20 @@ inline Gigamonkey::bytes_reader operator>>(Gigamonkey::bytes_reader r, Gigamonke
     return r >> s.Value;
 }
 
+namespace std {
+
+    // digests are already uniformly distributed, so we just take the first few bytes.
+    template <size_t size> struct hash<Gigamonkey::digest<size>> {
+        size_t operator()(const Gigamonkey::digest<size>& d) const {
+            static_assert(size >= sizeof(size_t));
+            size_t x;
+            std::copy(d.begin(), d.begin() + sizeof(size_t), reinterpret_cast<Gigamonkey::byte*>(&x));
+            return x;
+        }
+    };
+
+}
+
 namespace Gigamonkey {
 
     template <size_t size, unsigned int bits>
@@ -0,0 +1,255 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_HEADERS
+#define GIGAMONKEY_HEADERS
+
+#include <gigamonkey/timechain.hpp>
+#include <optional>
+#include <functional>
+#include <unordered_map>
+
+namespace Gigamonkey::Bitcoin {
+
+    // The headers of a single chain, stored contiguously so that
+    // ranges of them can be handed out without copying.
+    class header_store {
+        uint64 Base; // height of the first header.
+        bytes Headers;
+        std::vector<digest256> Hashes;
+        std::unordered_map<digest256, uint64> Index;
+
+    public:
+        header_store() : Base{0}, Headers{}, Hashes{}, Index{} {}
+        explicit header_store(uint64 base) : Base{base}, Headers{}, Hashes{}, Index{} {}
+
+        bool empty() const {
+            return Hashes.size() == 0;
+        }
+
+        size_t size() const {
+            return Hashes.size();
+        }
+
+        uint64 base() const {
+            return Base;
+        }
+
+        // height of the last header.
+        uint64 height() const {
+            return empty() ? Base : Base + Hashes.size() - 1;
+        }
+
+        digest256 tip() const {
+            return empty() ? digest256{} : Hashes.back();
+        }
+
+        bool contains(uint64 height) const {
+            return height >= Base && height - Base < Hashes.size();
+        }
+
+        std::optional<uint64> height(const digest256&) const;
+
+        // The header at a given height, which must be in the store.
+        const slice<80> operator[](uint64 height) const {
+            return slice<80>(const_cast<byte*>(Headers.data() + 80 * (height - Base)));
+        }
+
+        const digest256& hash(uint64 height) const {
+            return Hashes[height - Base];
+        }
+
+        // add a header to the tip. Fails if it does not
+        // refer to the tip as its previous header.
+        bool append(const slice<80>);
+
+        bool append(const header& h) {
+            return append(h.write());
+        }
+
+        // remove all headers above the given height.
+        void truncate(uint64 height);
+
+        void reserve(size_t headers) {
+            Headers.reserve(80 * headers);
+            Hashes.reserve(headers);
+            Index.reserve(headers);
+        }
+
+        header_range headers(uint64 from, uint64 to) const;
+        header_range headers(const locator&, uint32 max) const;
+        header_range headers_to_tip(const digest256&) const;
+
+        locator locate() const;
+    };
+
+    // Every header we know about, arranged as a tree in which each header
+    // refers to its parent by index. The best chain is the one with the
+    // most cumulative work and is kept in a header_store.
+    class fork_tree {
+    public:
+        using index = uint32;
+        constexpr static index none = 0xffffffff;
+
+        // Sent whenever the best chain changes.
+        struct reorg {
+            // The last header that the old and new best chains have in common.
+            index Ancestor;
+            // Headers removed from the best chain, from the old tip down.
+            std::vector<index> Disconnected;
+            // Headers added to the best chain, from the ancestor up.
+            std::vector<index> Connected;
+
+            // whether this is just a new header on the tip.
+            bool extension() const {
+                return Disconnected.size() == 0;
+            }
+        };
+
+        using listener = std::function<void(const fork_tree&, const reorg&)>;
+
+    private:
+        struct node {
+            digest256 Hash;
+            index Parent;
+            uint64 Height;
+            uint256 Work; // cumulative.
+        };
+
+        bytes Headers;
+        std::vector<node> Nodes;
+        std::unordered_map<digest256, index> Index;
+        index Tip;
+        header_store Best;
+        listener Listener;
+
+        reorg change_tip(index);
+
+    public:
+        // start the tree with a given header at a given height,
+        // with the cumulative work of the chain up to it.
+        fork_tree(const slice<80> root, uint64 height = 0, const uint256& work = uint256{});
+
+        void listen(listener l) {
+            Listener = l;
+        }
+
+        // Add a new header, which must have valid proof of work and whose
+        // parent must already be in the tree. Returns the new index or none.
+        index attach(const slice<80>);
+
+        index attach(const Bitcoin::header& h) {
+            return attach(h.write());
+        }
+
+        size_t size() const {
+            return Nodes.size();
+        }
+
+        index tip() const {
+            return Tip;
+        }
+
+        index find(const digest256& d) const {
+            auto i = Index.find(d);
+            return i == Index.end() ? none : i->second;
+        }
+
+        index parent(index i) const {
+            return Nodes[i].Parent;
+        }
+
+        uint64 height(index i) const {
+            return Nodes[i].Height;
+        }
+
+        const digest256& hash(index i) const {
+            return Nodes[i].Hash;
+        }
+
+        const uint256& work(index i) const {
+            return Nodes[i].Work;
+        }
+
+        const slice<80> operator[](index i) const {
+            return slice<80>(const_cast<byte*>(Headers.data() + 80 * i));
+        }
+
+        // the last header that two branches have in common.
+        index ancestor(index, index) const;
+
+        // The best chain.
+        const header_store& best() const {
+            return Best;
+        }
+    };
+
+    // A snapshot of a header chain that a new node can trust in place of
+    // downloading every header. It has enough of the last headers to compute
+    // the median time past and the difficulty adjustment of the next header,
+    // and it commits to every header hash in the chain with a Merkle root.
+    struct checkpoint {
+        // 11 headers for median time past and 144 + 3 for the difficulty adjustment.
+        constexpr static uint32 Window = 147;
+
+        uint64 Height;
+        digest256 Tip;
+        uint256 Work; // cumulative work up to the tip.
+
+        // The last headers up to and including the tip and the
+        // cumulative work up to and including the first of them.
+        bytes Headers;
+        uint256 WindowWork;
+
+        // Merkle root of all header hashes from genesis to the tip.
+        digest256 Commitment;
+        // so that later checkpoints can extend the commitment.
+        Merkle::frontier Frontier;
+
+        checkpoint() : Height{0}, Tip{}, Work{}, Headers{}, WindowWork{}, Commitment{}, Frontier{} {}
+
+        // Make a checkpoint at the tip of a store which contains every header from genesis.
+        static checkpoint make(const header_store&);
+
+        // Make a checkpoint at the tip of a store which was started from an earlier checkpoint.
+        static checkpoint make(const checkpoint&, const header_store&);
+
+        // whether the parts of the checkpoint are consistent with one another.
+        bool valid() const;
+
+        size_t window() const {
+            return Headers.size() / 80;
+        }
+
+        const slice<80> operator[](size_t i) const {
+            return slice<80>(const_cast<byte*>(Headers.data() + 80 * i));
+        }
+
+        // median of the timestamps of the last 11 headers.
+        timestamp median_time_past() const;
+
+        // A store containing the window, which can be extended with append.
+        header_store load() const;
+
+        // cumulative work up to every header in the window.
+        std::vector<uint256> window_work() const;
+
+        bytes write() const;
+        static checkpoint read(bytes_view);
+
+        bool operator==(const checkpoint& c) const {
+            return Height == c.Height && Tip == c.Tip && Work == c.Work && Headers == c.Headers &&
+                WindowWork == c.WindowWork && Commitment == c.Commitment && Frontier == c.Frontier;
+        }
+
+        bool operator!=(const checkpoint& c) const {
+            return !operator==(c);
+        }
+
+    private:
+        static checkpoint make(const header_store&, uint64 from, uint256 work, Merkle::frontier);
+    };
+
+}
+
+#endif
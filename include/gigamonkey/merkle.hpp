@@ -5,6 +5,7 @@
 #define GIGAMONKEY_MERKLE
 
 #include "hash.hpp"
+#include <vector>
 
 namespace Gigamonkey::Merkle {
         
@@ -39,6 +40,31 @@ namespace Gigamonkey::Merkle {
         explicit path(bytes_view b);
     };
     
+    // Takes leaves one at a time and keeps only the roots of the complete
+    // subtrees, so that the root of everything so far can be computed
+    // with about log n hashes. Gives the same root as Merkle::root.
+    struct frontier {
+        uint64 Leaves;
+        // Peaks[i] is the root of a subtree of 2^i leaves if bit i of Leaves
+        // is set and is zero otherwise.
+        std::vector<digest256> Peaks;
+
+        frontier() : Leaves{0}, Peaks{} {}
+        frontier(uint64 l, std::vector<digest256> p) : Leaves{l}, Peaks{p} {}
+
+        void add(const digest256&);
+
+        digest256 root() const;
+
+        bool operator==(const frontier& f) const {
+            return Leaves == f.Leaves && Peaks == f.Peaks;
+        }
+
+        bool operator!=(const frontier& f) const {
+            return !operator==(f);
+        }
+    };
+
     class tree {
         using digest_tree = Gigamonkey::tree<digest256>;
         
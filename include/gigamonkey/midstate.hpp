@@ -0,0 +1,60 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_MIDSTATE
+#define GIGAMONKEY_MIDSTATE
+
+#include <gigamonkey/hash.hpp>
+#include <gigamonkey/merkle.hpp>
+#include <gigamonkey/work/string.hpp>
+#include <array>
+
+namespace Gigamonkey {
+
+    // SHA-256 for many messages that begin the same way. The whole 64-byte
+    // blocks of the beginning are hashed once and the state afterwards is
+    // kept, so that only the rest of the beginning and the part that changes
+    // are hashed for each message.
+    class midstate {
+        std::array<uint32, 8> State;
+        std::array<byte, 64> Rest;
+        size_t RestSize;
+        uint64 Length; // the number of bytes that went into State.
+
+    public:
+        // the number of messages that are hashed together.
+        static constexpr size_t lanes = 8;
+
+        midstate();
+        explicit midstate(bytes_view prefix);
+
+        // the size of the prefix.
+        uint64 size() const {
+            return Length + RestSize;
+        }
+
+        // sha256 and hash256 of the prefix followed by a suffix.
+        digest256 sha256(bytes_view suffix) const;
+        digest256 hash256(bytes_view suffix) const;
+
+        // hash256 of the prefix followed by each of count suffixes of the
+        // same size, which are stored one after another. The messages are
+        // hashed in groups of lanes, one step of SHA-256 at a time for the
+        // whole group, which is a form the compiler can turn into vector
+        // instructions.
+        void hash256(const byte* suffixes, size_t suffix_size, size_t count, digest256* out) const;
+    };
+
+    // The Merkle roots of blocks whose coinbases differ only in an 8-byte
+    // ExtraNonce2, which comes after the part of the coinbase in the
+    // midstate and before rest. All of the coinbases are hashed together,
+    // and then each level of the Merkle path for all of them together.
+    std::vector<digest256> merkle_roots(const midstate& coinbase, bytes_view rest,
+        const std::vector<uint64>& extra_nonce_2, const Merkle::path&);
+
+    // hash256 of many work strings together.
+    std::vector<digest256> hash256(const std::vector<work::string>&);
+
+}
+
+#endif
@@ -28,6 +28,15 @@ namespace Gigamonkey::Bitcoin::redemption {
                 compile(Bitcoin::program{} << push_data(dummy_signature ? signature{} : Secret->sign(tx, Directive)));
         };
         
+        // write the script to the end of an arena. 
+        arena::span redeem(arena& a, const input_index& tx, bool dummy_signature = false) const {
+            if (Secret == nullptr) return a.append(Script);
+            signature x = dummy_signature ? signature{} : Secret->sign(tx, Directive);
+            arena::span s = a.allocate(push_length(bytes_view(x).size()));
+            write_push(a.writer(s), x);
+            return s;
+        }
+        
         uint32 expected_size() const {
             return Secret == nullptr ? Script.size() : DerSignatureExpectedSize;
         };
@@ -37,6 +46,8 @@ namespace Gigamonkey::Bitcoin::redemption {
     
     bytes redeem(incomplete x, const input_index& tx, bool dummy_signature = false);
     
+    arena::span redeem(incomplete x, const input_index& tx, arena&, bool dummy_signature = false);
+    
     uint32 expected_size(incomplete x);
 }
 
@@ -87,6 +98,13 @@ namespace Gigamonkey::Bitcoin {
     
     vertex redeem(list<data::entry<spendable, sighash::directive>> prev, list<output> out, int32_little locktime);
     
+    // Write a transaction to the end of an arena, along with the scripts that 
+    // are used to build it. Nothing else is allocated for each script, 
+    // so that many transactions can be built in the same arena, which is 
+    // cleared afterwards. The span is empty if the outputs are worth more 
+    // than the inputs. 
+    arena::span redeem(arena&, list<data::entry<spendable, sighash::directive>> prev, list<output> out, int32_little locktime);
+    
     inline vertex redeem(list<data::entry<spendable, sighash::directive>> prev, list<output> out) {
         return redeem(prev, out, 0);
     }
@@ -8,8 +8,13 @@
 #define GIGAMONKEY_SCRIPT
 
 #include <boost/endian/conversion.hpp>
+#include <array>
+#include <bitset>
+#include <cstring>
+#include <iterator>
 #include <gigamonkey/signature.hpp>
 #include <gigamonkey/address.hpp>
+#include <gigamonkey/arena.hpp>
 
 #include <script/script.h>
 #include <script/script_error.h>
@@ -42,6 +47,39 @@ namespace Gigamonkey::Bitcoin {
     // Evaluate script with real signature operations. 
     evaluated evaluate_script(const script& unlock, const script& lock, const input_index& tx);
     
+    // Evaluates the input scripts of one transaction against the output 
+    // scripts they redeem. The transaction is read only once and all 
+    // evaluations share one cancellation token. 
+    class evaluation_context {
+        struct implementation;
+        ptr<implementation> Implementation;
+        
+    public:
+        // redeemed contains the outputs that are spent by each input, in order. 
+        evaluation_context(bytes_view transaction, list<output> redeemed);
+        
+        // false if the transaction could not be read or if there
+        // is not exactly one redeemed output for every input. 
+        bool valid() const {
+            return Implementation != nullptr;
+        }
+        
+        uint32 inputs() const;
+        
+        evaluated evaluate(index input) const;
+        
+        // Evaluate every input using up to the given number of threads. 
+        std::vector<evaluated> evaluate_all(uint32 threads = 1) const;
+        
+        // Whether every input evaluates to true. Evaluations 
+        // still in progress are cancelled after the first failure. 
+        bool verify(uint32 threads = 1) const;
+        
+        // Stop all evaluations. Any that are running or which 
+        // are started afterwards return without a result. 
+        void cancel();
+    };
+    
     using op = opcodetype;
     
     const op OP_PUSHSIZE1 = op(0x01);
@@ -149,8 +187,8 @@ namespace Gigamonkey::Bitcoin {
         
         instruction(bytes_view data) : Op{[](size_t size)->op{
             if (size <= OP_PUSHSIZE75) return static_cast<op>(size);
-            if (size <= 0xffff) return OP_PUSHDATA1;
-            if (size <= 0xffffffff) return OP_PUSHDATA2;
+            if (size <= 0xff) return OP_PUSHDATA1;
+            if (size <= 0xffff) return OP_PUSHDATA2;
             return OP_PUSHDATA4;
         }(data.size())}, Data{data} {} 
         
@@ -165,9 +203,9 @@ namespace Gigamonkey::Bitcoin {
             if (Op == OP_INVALIDOPCODE) return false;
             size_t size = Data.size();
             return (!is_push_data(Op) && size == 0) || (Op <= OP_PUSHSIZE75 && Op == size) 
-                || (Op == OP_PUSHDATA1 && size <= 0xffff) 
-                || (Op == OP_PUSHDATA2 && size <= 0xffffffff) 
-                || (Op == OP_PUSHDATA4 && size <= 0xffffffffffffffff);
+                || (Op == OP_PUSHDATA1 && size <= 0xff) 
+                || (Op == OP_PUSHDATA2 && size <= 0xffff) 
+                || (Op == OP_PUSHDATA4 && size <= 0xffffffff);
         }
         
         uint32 length() const {
@@ -213,7 +251,7 @@ namespace Gigamonkey::Bitcoin {
             if (Push <= OP_PUSHSIZE75) return w << static_cast<byte>(Push);
             if (Push == OP_PUSHDATA1) return w << static_cast<byte>(OP_PUSHDATA1) << static_cast<byte>(size); 
             if (Push == OP_PUSHDATA2) return w << static_cast<byte>(OP_PUSHDATA2) << static_cast<uint16_little>(size); 
-            return w << static_cast<byte>(OP_PUSHDATA2) << static_cast<uint32_little>(size);
+            return w << static_cast<byte>(OP_PUSHDATA4) << static_cast<uint32_little>(size);
         }
     };
     
@@ -245,8 +283,14 @@ namespace Gigamonkey::Bitcoin {
     
     bytes compile(program p); 
     
+    // Append a compiled program to the end of a script. 
+    void compile(program p, bytes& script); 
+    
+    arena::span compile(program p, arena&); 
+    
     bytes compile(instruction i); 
     
+    // Returns nothing if the script ends in the middle of an instruction. 
     program decompile(bytes_view); 
     
     inline size_t length(instruction o) {
@@ -254,14 +298,256 @@ namespace Gigamonkey::Bitcoin {
     }
     
     inline size_t length(program p) {
-        if (p.empty()) return 0;
-        return length(p.first()) + length(p.rest());
+        size_t size = 0;
+        for (; !p.empty(); p = p.rest()) size += length(p.first());
+        return size;
+    }
+    
+    // A part of a script template: either an op code or a push of a 
+    // fixed number of bytes, which are filled in when the script is written.
+    struct template_part {
+        op Op;
+        uint32 Size;
+        bool Hole;
+        
+        constexpr template_part(op o) : Op{o}, Size{0}, Hole{false} {}
+        
+        constexpr static template_part push(uint32 size) {
+            return template_part{
+                size <= OP_PUSHSIZE75 ? static_cast<op>(size) : 
+                    size <= 0xff ? OP_PUSHDATA1 : size <= 0xffff ? OP_PUSHDATA2 : OP_PUSHDATA4, 
+                size, true};
+        }
+        
+        // the size of the op code and of the size of the push. 
+        constexpr uint32 header() const {
+            return !Hole || Op <= OP_PUSHSIZE75 ? 1 : Op == OP_PUSHDATA1 ? 2 : Op == OP_PUSHDATA2 ? 3 : 5;
+        }
+        
+        constexpr uint32 length() const {
+            return header() + Size;
+        }
+        
+    private:
+        constexpr template_part(op o, uint32 size, bool hole) : Op{o}, Size{size}, Hole{hole} {}
+    };
+    
+    template <size_t k> 
+    constexpr size_t template_length(const template_part (&parts)[k]) {
+        size_t size = 0;
+        for (size_t i = 0; i < k; i++) size += parts[i].length();
+        return size;
+    }
+    
+    template <size_t k> 
+    constexpr size_t template_holes(const template_part (&parts)[k]) {
+        size_t holes = 0;
+        for (size_t i = 0; i < k; i++) if (parts[i].Hole) holes++;
+        return holes;
+    }
+    
+    // A script with a fixed layout, compiled at compile time. Writing it 
+    // copies the skeleton and then copies each push into its place. 
+    // n must be template_length(parts) and holes must be template_holes(parts).
+    template <size_t n, size_t holes> 
+    struct script_template {
+        std::array<byte, n> Skeleton;
+        std::array<uint32, holes> Offsets; // where the data of each push begins. 
+        std::array<uint32, holes> Sizes;
+        
+        template <size_t k> 
+        constexpr explicit script_template(const template_part (&parts)[k]) : Skeleton{}, Offsets{}, Sizes{} {
+            size_t at = 0;
+            size_t hole = 0;
+            for (size_t i = 0; i < k; i++) {
+                template_part x = parts[i];
+                Skeleton[at++] = static_cast<byte>(x.Op);
+                if (!x.Hole) continue;
+                for (uint32 j = 1; j < x.header(); j++) Skeleton[at++] = static_cast<byte>(x.Size >> (8 * (j - 1)));
+                Offsets[hole] = static_cast<uint32>(at);
+                Sizes[hole++] = x.Size;
+                at += x.Size;
+            }
+        }
+        
+        constexpr static size_t size() {
+            return n;
+        }
+        
+        // Write the script to a buffer with room for size() bytes. Nothing is 
+        // written if any of the pushes is not of the size given in the template.
+        bool write(byte* out, const std::array<bytes_view, holes>& push) const {
+            for (size_t i = 0; i < holes; i++) if (push[i].size() != Sizes[i]) return false;
+            std::memcpy(out, Skeleton.data(), n);
+            for (size_t i = 0; i < holes; i++) std::memcpy(out + Offsets[i], push[i].data(), Sizes[i]);
+            return true;
+        }
+        
+        // Returns an empty script if the pushes are the wrong size. 
+        bytes write(const std::array<bytes_view, holes>& push) const {
+            bytes script(n);
+            if (!write(script.data(), push)) return {};
+            return script;
+        }
+    };
+    
+    // the length of a push of some number of bytes. 
+    inline size_t push_length(size_t size) {
+        return template_part::push(size).length();
+    }
+    
+    // write a push without copying its data into an instruction first. 
+    bytes_writer write_push(bytes_writer w, bytes_view data);
+    
+    // The length of the instruction at the front of a script, 
+    // or 0 if the script ends before the instruction does. 
+    uint32 next_instruction_size(bytes_view);
+    
+    // An instruction as it appears in a script. Nothing is copied out 
+    // of the script, so it must outlive any instruction_view read from it. 
+    struct instruction_view {
+        op Op;
+        bytes_view Data; // the data after the op code and size of a push.
+        uint32 Offset;   // where the instruction begins in the script. 
+        uint32 Size;     // the length of the whole instruction, or 0 if invalid. 
+        
+        instruction_view() : Op{OP_INVALIDOPCODE}, Data{}, Offset{0}, Size{0} {}
+        instruction_view(op o, bytes_view d, uint32 offset, uint32 size) : Op{o}, Data{d}, Offset{offset}, Size{size} {}
+        instruction_view(const instruction& i) : Op{i.Op}, Data{bytes_view{i.Data}}, Offset{0}, Size{i.length()} {}
+        
+        bool valid() const {
+            return Size != 0;
+        }
+        
+        // the value that is pushed, as given by instruction::data.
+        bytes_view data() const;
+        
+        explicit operator instruction() const {
+            return instruction{Op, bytes(Data)};
+        }
+        
+        // The instruction at the given offset of a script. 
+        static instruction_view read(bytes_view script, uint32 offset = 0);
+    };
+    
+    // The instructions of a script, which can be iterated over without
+    // allocating anything. If the script ends in the middle of an 
+    // instruction, iteration stops before it and valid() is false. 
+    class instructions {
+        bytes_view Script;
+        
+    public:
+        explicit instructions(bytes_view script) : Script{script} {}
+        
+        class iterator {
+            bytes_view Script;
+            instruction_view Current;
+            
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = instruction_view;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const instruction_view*;
+            using reference = const instruction_view&;
+            
+            iterator() : Script{}, Current{} {}
+            iterator(bytes_view script, uint32 offset) : Script{script}, Current{instruction_view::read(script, offset)} {
+                if (!Current.valid()) Current.Offset = Script.size();
+            }
+            
+            reference operator*() const {
+                return Current;
+            }
+            
+            pointer operator->() const {
+                return &Current;
+            }
+            
+            iterator& operator++() {
+                *this = iterator{Script, Current.Offset + Current.Size};
+                return *this;
+            }
+            
+            iterator operator++(int) {
+                iterator i = *this;
+                ++(*this);
+                return i;
+            }
+            
+            // only iterators over the same script can be compared. 
+            bool operator==(const iterator& i) const {
+                return Current.Offset == i.Current.Offset;
+            }
+            
+            bool operator!=(const iterator& i) const {
+                return !operator==(i);
+            }
+        };
+        
+        iterator begin() const {
+            return iterator{Script, 0};
+        }
+        
+        iterator end() const {
+            return iterator{Script, static_cast<uint32>(Script.size())};
+        }
+        
+        // the number of complete instructions. 
+        uint32 size() const;
+        
+        // whether the script ends at the end of an instruction. 
+        bool valid() const;
+    };
+    
+    // Properties of a script that are found by reading through it once. 
+    struct script_metrics {
+        uint32 Instructions;
+        uint32 Sigops;         // OP_CHECKMULTISIG counts as 20. 
+        uint32 AccurateSigops; // OP_CHECKMULTISIG after OP_1 through OP_16 counts as that number. 
+        uint32 MaxPush;        // the size of the largest push. 
+        bool PushOnly;
+        bool DataCarrier;      // begins with OP_RETURN or OP_FALSE OP_RETURN. 
+        bool Valid;            // false if the script ends in the middle of an instruction. 
+        
+        script_metrics() : Instructions{0}, Sigops{0}, AccurateSigops{0}, MaxPush{0}, 
+            PushOnly{true}, DataCarrier{false}, Valid{true} {}
+        
+        explicit script_metrics(bytes_view script);
+        
+        // Totals over several scripts, which are push only or valid 
+        // if all of them are and a data carrier if any of them is. 
+        script_metrics operator+(const script_metrics&) const;
+    };
+    
+    // The number of signature operations in a script, counted as they are
+    // for the sigop limit. OP_CHECKMULTISIG counts as 20 unless accurate is 
+    // true and it comes right after OP_1 through OP_16, which give the count. 
+    inline uint32 sigops(bytes_view script, bool accurate = false) {
+        script_metrics m{script};
+        return accurate ? m.AccurateSigops : m.Sigops;
     }
     
+    struct transaction_metrics {
+        script_metrics Inputs;
+        script_metrics Outputs;
+        bool Valid; // false if the transaction could not be read. 
+        
+        transaction_metrics() : Inputs{}, Outputs{}, Valid{false} {}
+        transaction_metrics(const script_metrics& i, const script_metrics& o) : Inputs{i}, Outputs{o}, Valid{true} {}
+        
+        uint32 sigops() const {
+            return Inputs.Sigops + Outputs.Sigops;
+        }
+    };
+    
     class push;
     struct optional;
     struct alternatives;
     struct repeated;
+    struct any;
+    
+    // Used to turn a pattern into a matcher. 
+    struct pattern_compiler;
     
     // for matching and scraping values.
     struct pattern {
@@ -297,6 +583,8 @@ namespace Gigamonkey::Bitcoin {
         
         virtual ~pattern() {}
         
+        virtual void compile(pattern_compiler&) const;
+        
         struct sequence;
     protected:
         struct atom;
@@ -309,6 +597,7 @@ namespace Gigamonkey::Bitcoin {
     struct any final : pattern {
         any() {}
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
     };
     
     // A pattern that represents a single instruction. 
@@ -317,14 +606,16 @@ namespace Gigamonkey::Bitcoin {
         atom(instruction i) : Instruction{i} {}
         
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
     };
     
     // A pattern that represents a single instruction. 
     struct pattern::string final : pattern {
         bytes Program;
-        string(program p) : Program{compile(p)} {}
+        string(program p) : Program{Bitcoin::compile(p)} {}
         
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
     };
     
     // A pattern that represents a push instruction 
@@ -334,22 +625,24 @@ namespace Gigamonkey::Bitcoin {
         enum type : byte {any, value, data, read};
         type Type;
         Z Value;
+        int64 Number; // same as Value, for the matcher. 
         bytes Data;
         bytes& Read;
         
     public:
         // match any push data.
-        push() : Type{any}, Value{0}, Data{}, Read{Data} {}
+        push() : Type{any}, Value{0}, Number{0}, Data{}, Read{Data} {}
         // match any push data of the given value
-        push(int64 v) : Type{value}, Value{v}, Data{}, Read{Data} {}
+        push(int64 v) : Type{value}, Value{v}, Number{v}, Data{}, Read{Data} {}
         // match a push of the given data. 
-        push(bytes_view b) : Type{data}, Value{0}, Data{b}, Read{Data} {}
+        push(bytes_view b) : Type{data}, Value{0}, Number{0}, Data{b}, Read{Data} {}
         // match any push data and save the result.
-        push(bytes& r) : Type{read}, Value{0}, Data{}, Read{r} {}
+        push(bytes& r) : Type{read}, Value{0}, Number{0}, Data{}, Read{r} {}
         
-        bool match(const instruction& i) const;
+        bool match(const instruction_view& i) const;
         
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
         
         operator instruction() const;
     };
@@ -366,9 +659,10 @@ namespace Gigamonkey::Bitcoin {
         // match any push data and save the result.
         push_size(size_t s, bytes& r) : Reader(true), Size(s), Data(), Read(r) {}
         
-        bool match(const instruction& i) const;
+        bool match(const instruction_view& i) const;
         
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
     };
     
     enum repeated_directive : byte {
@@ -397,6 +691,7 @@ namespace Gigamonkey::Bitcoin {
         repeated(alternatives, uint32, uint32);
         
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
     };
     
     struct optional final : pattern {
@@ -410,6 +705,7 @@ namespace Gigamonkey::Bitcoin {
         optional(alternatives);
         
         virtual bytes_view scan(bytes_view p) const final override;
+        virtual void compile(pattern_compiler&) const final override;
     };
         
     inline pattern::pattern(op o) : pattern{instruction{o}} {}
@@ -425,6 +721,7 @@ namespace Gigamonkey::Bitcoin {
         sequence(P... p) : Patterns(make(p...)) {}
         
         virtual bytes_view scan(bytes_view p) const override;
+        virtual void compile(pattern_compiler&) const override;
         
     private:
         
@@ -435,6 +732,8 @@ namespace Gigamonkey::Bitcoin {
         static ptr<pattern> construct(push_size p);
         static ptr<pattern> construct(alternatives p);
         static ptr<pattern> construct(optional p);
+        static ptr<pattern> construct(repeated p);
+        static ptr<pattern> construct(any p);
         static ptr<pattern> construct(pattern p);
         
         template <typename X> 
@@ -450,6 +749,89 @@ namespace Gigamonkey::Bitcoin {
         alternatives(P... p) : sequence{p...} {}
         
         virtual bytes_view scan(bytes_view) const final override;
+        virtual void compile(pattern_compiler&) const final override;
+    };
+    
+    // A pattern compiled into a flat program for a small backtracking machine,
+    // which matches a script without throwing exceptions or copying any of it. 
+    // Values read by push(bytes&) and push_size(size_t, bytes&) are returned as 
+    // captures, numbered in the order in which their targets first appear in
+    // the pattern. The same target appearing twice gives the same capture. 
+    class matcher {
+    public:
+        enum result : byte {
+            success, 
+            mismatch, 
+            invalid // the script ended in the middle of an instruction. 
+        };
+        
+        enum code : byte {
+            end, 
+            literal,    // some exact instructions, from A to A + B in Literals.
+            any,        // any instruction. 
+            push_any,   // any push. If A is not none, it is captured in A. 
+            push_value, // a push of the number Values[A]. 
+            push_data,  // a push of data from A to A + B in Literals. 
+            push_size,  // a push of A bytes. If B is not none, it is captured in B. 
+            choice,     // try what follows and go to A if it fails. 
+            commit,     // drop the last choice and go to A. 
+            loop,       // drop the last choice and go to A if anything was matched since it was made. 
+            fail
+        };
+        
+        constexpr static uint32 none = 0xffffffff;
+        
+        struct step {
+            code Code;
+            uint32 A;
+            uint32 B;
+        };
+        
+    private:
+        std::vector<step> Steps;
+        bytes Literals;
+        std::vector<int64> Values;
+        uint32 Captures;
+        uint32 Depth; // the most choices that can be open at once. 
+        
+        friend struct pattern_compiler;
+        
+    public:
+        matcher() : Steps{step{end, 0, 0}}, Literals{}, Values{}, Captures{0}, Depth{0} {}
+        explicit matcher(const pattern&);
+        
+        uint32 captures() const {
+            return Captures;
+        }
+        
+        const std::vector<step>& steps() const {
+            return Steps;
+        }
+        
+        // Match a whole script. If captures is not null, it must have room for 
+        // captures() views, which will point into the script. 
+        result match(bytes_view script, bytes_view* captures = nullptr) const {
+            return run(script, captures, 0, 0);
+        }
+        
+        // The instructions that every matching script begins with. 
+        bytes_view prefix() const {
+            return Steps[0].Code == literal ? bytes_view{Literals.data() + Steps[0].A, Steps[0].B} : bytes_view{};
+        }
+        
+        // Match a script that is already known to begin with prefix(). 
+        result match_after_prefix(bytes_view script, bytes_view* captures = nullptr) const {
+            return Steps[0].Code == literal ? run(script, captures, 1, Steps[0].B) : run(script, captures, 0, 0);
+        }
+        
+        // The bytes that a non-empty matching script could begin with. 
+        std::bitset<256> starts() const {
+            return starts(0);
+        }
+        
+    private:
+        result run(bytes_view script, bytes_view* captures, uint32 pc, uint32 position) const;
+        std::bitset<256> starts(uint32 pc) const;
     };
     
     // A pattern that matches a pubkey and grabs the value of that pubkey.
@@ -482,7 +864,20 @@ namespace Gigamonkey::Bitcoin {
             return {pubkey_pattern(pubkey), OP_CHECKSIG};
         }
         
-        static bytes script(pubkey p) {
+        constexpr static template_part CompressedParts[] = {template_part::push(33), OP_CHECKSIG};
+        constexpr static template_part UncompressedParts[] = {template_part::push(65), OP_CHECKSIG};
+        
+        constexpr static script_template<
+            template_length(CompressedParts), 
+            template_holes(CompressedParts)> CompressedTemplate{CompressedParts};
+        
+        constexpr static script_template<
+            template_length(UncompressedParts), 
+            template_holes(UncompressedParts)> UncompressedTemplate{UncompressedParts};
+        
+        static bytes script(const pubkey& p) {
+            if (p.Value.size() == 33) return CompressedTemplate.write({bytes_view(p.Value)});
+            if (p.Value.size() == 65) return UncompressedTemplate.write({bytes_view(p.Value)});
             return compile(program{push_data(p), OP_CHECKSIG});
         }
         
@@ -496,10 +891,12 @@ namespace Gigamonkey::Bitcoin {
             return script(Pubkey);
         }
         
+        static const matcher& compiled();
+        
         pay_to_pubkey(bytes_view script) : Pubkey{} {
-            pubkey p;
-            if (!pattern(p.Value).match(script)) return;
-            Pubkey = p;
+            bytes_view p;
+            if (compiled().match(script, &p) != matcher::success) return;
+            Pubkey = pubkey{p};
         }
         
         static bytes redeem(const signature& s) {
@@ -512,8 +909,17 @@ namespace Gigamonkey::Bitcoin {
             return {OP_DUP, OP_HASH160, push_size{20, address}, OP_EQUALVERIFY, OP_CHECKSIG};
         }
         
+        constexpr static template_part Parts[] = {OP_DUP, OP_HASH160, template_part::push(20), OP_EQUALVERIFY, OP_CHECKSIG};
+        
+        constexpr static script_template<template_length(Parts), template_holes(Parts)> Template{Parts};
+        
         static bytes script(const digest160& a) {
-            return compile(program{OP_DUP, OP_HASH160, bytes_view(a), OP_EQUALVERIFY, OP_CHECKSIG});
+            return Template.write({bytes_view(a)});
+        }
+        
+        // Write the script for an address to a buffer with room for Template.size() bytes.
+        static void write(byte* out, const digest160& a) {
+            Template.write(out, {bytes_view(a)});
         }
         
         digest160 Address;
@@ -526,9 +932,11 @@ namespace Gigamonkey::Bitcoin {
             return script(Address);
         }
         
+        static const matcher& compiled();
+        
         pay_to_address(bytes_view script) : Address{} {
-            bytes addr{20};
-            pattern(addr).match(script);
+            bytes_view addr;
+            if (compiled().match(script, &addr) != matcher::success) return;
             std::copy(addr.begin(), addr.end(), Address.Value.begin());
         }
         
@@ -539,6 +947,14 @@ namespace Gigamonkey::Bitcoin {
     
 }
 
+namespace Gigamonkey::transaction {
+    // Metrics for all the input scripts and all the output 
+    // scripts of a serialized transaction. 
+    Bitcoin::transaction_metrics metrics(bytes_view);
+}
+
+std::ostream& write_op_code(std::ostream& o, Gigamonkey::Bitcoin::op x);
+
 std::ostream& operator<<(std::ostream& o, const Gigamonkey::Bitcoin::instruction i);
 
 inline Gigamonkey::bytes_writer operator<<(Gigamonkey::bytes_writer w, const Gigamonkey::Bitcoin::instruction i) {
@@ -608,6 +1024,14 @@ namespace Gigamonkey::Bitcoin {
         return std::make_shared<optional>(p);
     }
     
+    inline ptr<pattern> pattern::sequence::construct(repeated p) {
+        return std::make_shared<repeated>(p);
+    }
+    
+    inline ptr<pattern> pattern::sequence::construct(any p) {
+        return std::make_shared<any>(p);
+    }
+    
     inline ptr<pattern> pattern::sequence::construct(pattern p) {
         return std::make_shared<pattern>(p);
     }
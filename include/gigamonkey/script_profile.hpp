@@ -0,0 +1,62 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_SCRIPT_PROFILE
+#define GIGAMONKEY_SCRIPT_PROFILE
+
+#include <gigamonkey/script.hpp>
+#include <array>
+#include <chrono>
+
+namespace Gigamonkey::Bitcoin {
+
+    // What it cost to evaluate some scripts. A profile can be passed to
+    // many evaluations, in which case it holds the totals for all of them.
+    struct script_profile {
+        enum op_class : byte {
+            push,
+            flow,
+            stack,
+            splice,
+            bitwise,
+            arithmetic,
+            crypto,
+            signature,
+            other
+        };
+
+        constexpr static uint32 Classes = 9;
+
+        static op_class classify(op);
+        static const char* name(op_class);
+
+        std::array<uint64, 256> Executed; // how many times each op code was run.
+        std::array<std::chrono::nanoseconds, Classes> Time;
+        uint64 Evaluations;
+        uint64 BytesPushed;
+        uint32 MaxStack; // the greatest depth of the stack and the alt stack together.
+
+        script_profile() : Executed{}, Time{}, Evaluations{0}, BytesPushed{0}, MaxStack{0} {}
+
+        uint64 instructions() const;
+        uint64 executed(op_class) const;
+    };
+
+    void to_json(json&, const script_profile&);
+
+    // Evaluate with instrumentation. The result is always that of evaluating
+    // without a profile. The profile is measured separately by giving the
+    // interpreter one instruction at a time, which is much slower. This
+    // follows conditionals, the alt stack and code separators but makes none
+    // of the interpreter's other checks on whole scripts, such as its limits
+    // on op codes and stack size, so for scripts that fail one of those, the
+    // profile may include instructions that the interpreter did not run. The
+    // profile of an evaluation ends at OP_RETURN or at the first instruction
+    // that fails, including a signature without fork id, which is invalid.
+    evaluated evaluate_script(const script& unlock, const script& lock, script_profile&);
+
+    evaluated evaluate_script(const script& unlock, const script& lock, const input_index& tx, script_profile&);
+
+}
+
+#endif
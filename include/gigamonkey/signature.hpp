@@ -92,6 +92,34 @@ namespace Gigamonkey::Bitcoin {
     inline bool verify(const signature& x, const input_index& i, sighash::directive d, const pubkey& p) {
         return verify(x, signature_hash(i, d), p);
     }
+    
+    // With sighash::fork_id, the signature hash of an input contains hashes of 
+    // the outpoints, sequence numbers and outputs of the whole transaction. 
+    // Those are computed once here, so that signing every input of a big 
+    // transaction does not take time proportional to the square of its size. 
+    class sighash_cache {
+        int32_little Version;
+        bytes Inputs;   // the outpoint and sequence number of each input. 
+        bytes Outputs;
+        std::vector<size_t> Offsets; // where each output begins, and the end.
+        uint32_little Locktime;
+        
+        digest256 Prevouts;
+        digest256 Sequences;
+        digest256 AllOutputs;
+        
+    public:
+        // the scripts of the inputs do not matter. 
+        explicit sighash_cache(bytes_view transaction);
+        
+        bool valid() const {
+            return Offsets.size() > 0;
+        }
+        
+        // The same as signature_hash(input_index{prev, transaction, i}, d). Invalid
+        // if d does not have sighash::fork_id or if there is no input i. 
+        digest256 hash(index i, const output& prev, sighash::directive d) const;
+    };
 }
 
 inline std::ostream& operator<<(std::ostream& o, const Gigamonkey::Bitcoin::signature& x) {
@@ -0,0 +1,50 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_CODEC
+#define GIGAMONKEY_STRATUM_CODEC
+
+#include <gigamonkey/stratum/stratum.hpp>
+#include <string_view>
+
+// A codec for the messages that a pool sends and receives most often:
+// mining.notify, mining.submit and the responses to mining.submit. It
+// reads and writes lines of text directly, rather than going through
+// a json object. What it writes is exactly what nlohmann::json would
+// write for the same message, followed by a newline.
+namespace Gigamonkey::Stratum::codec {
+
+    // The size of a line, including the newline.
+    size_t size(const notify&);
+    size_t size(const share&);
+
+    // zero if the result is not a bool or null.
+    size_t size(const response&);
+
+    // Write a line to a buffer of the size given above and
+    // return the end of what was written. Invalid messages
+    // write nothing.
+    char* write(char*, const notify&);
+    char* write(char*, const share&);
+    char* write(char*, const response&);
+
+    std::string write(const notify&);
+    std::string write(const share&);
+    std::string write(const response&);
+
+    // Where the hex string of GenerationTx1 ends in the line written for
+    // a notify, just before the closing quote.
+    size_t generation_tx1_end(const notify&);
+
+    // Read a line, with or without the newline. false if the line is
+    // not the expected message. Names of keys must not contain escapes
+    // and unknown keys are skipped.
+    bool read(std::string_view, notify&);
+    bool read(std::string_view, share&);
+
+    // only responses with a result that is a bool or null.
+    bool read(std::string_view, response&);
+
+}
+
+#endif
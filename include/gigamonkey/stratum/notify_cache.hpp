@@ -0,0 +1,61 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_NOTIFY_CACHE
+#define GIGAMONKEY_STRATUM_NOTIFY_CACHE
+
+#include <gigamonkey/stratum/stratum.hpp>
+#include <array>
+#include <memory>
+#include <string>
+
+namespace Gigamonkey::Stratum {
+
+    // A mining.notify that is serialized once and then sent to every
+    // miner. The buffers are immutable and shared, so a server can queue
+    // the same ones on every connection and write them with scatter-gather
+    // I/O. Some pools personalize each notify by putting the ExtraNonce1
+    // of the miner at the end of GenerationTx1. Then a miner is sent the
+    // head, its own fragment and the tail, and only the fragment, which
+    // depends on nothing but the ExtraNonce1, differs between miners.
+    class notify_cache {
+    public:
+        using buffer = std::shared_ptr<const std::string>;
+
+        // the hex string of an ExtraNonce1.
+        constexpr static size_t FragmentSize = 8;
+        using fragment = std::array<char, FragmentSize>;
+
+        static fragment write_fragment(uint32_little extra_nonce_1);
+
+        notify_cache() : Line{}, Head{}, Tail{} {}
+        explicit notify_cache(const notify&);
+
+        bool valid() const {
+            return Line != nullptr;
+        }
+
+        // the line that is the same for every miner.
+        const buffer& line() const {
+            return Line;
+        }
+
+        // the line up to the end of GenerationTx1.
+        const buffer& head() const {
+            return Head;
+        }
+
+        // the rest of the line after the fragment.
+        const buffer& tail() const {
+            return Tail;
+        }
+
+    private:
+        buffer Line;
+        buffer Head;
+        buffer Tail;
+    };
+
+}
+
+#endif
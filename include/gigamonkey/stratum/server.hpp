@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_SERVER
+#define GIGAMONKEY_STRATUM_SERVER
+
+#include <gigamonkey/stratum/stratum.hpp>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace Gigamonkey::Stratum {
+
+    using connection_id = uint64;
+
+    // What a mining pool does with the messages of its miners. The
+    // server calls these from its own threads, several at once.
+    struct pool {
+        // the ExtraNonce1 of a connection that has subscribed.
+        virtual uint32_little subscribe(connection_id) = 0;
+
+        virtual bool authorize(connection_id, const worker_name&, const std::string& password) = 0;
+
+        // only called for connections with an authorized worker.
+        virtual bool submit(connection_id, const share&) = 0;
+
+        virtual void disconnected(connection_id) {}
+
+        // If true, the ExtraNonce1 of each connection goes at the end of
+        // GenerationTx1 in the notifies it is sent, and the miner is told
+        // that its ExtraNonce1 is empty.
+        virtual bool personal() const {
+            return false;
+        }
+
+        virtual ~pool() {}
+    };
+
+    // A Stratum server that listens on a TCP port. Every thread has its own
+    // epoll instance and owns the connections that it accepts. They all
+    // wait on the listening socket with EPOLLEXCLUSIVE, so only one wakes
+    // for each new connection. Messages are lines of JSON. A mining.notify
+    // is serialized once into a notify_cache, and then every thread sends
+    // the same buffers to each of its subscribed connections.
+    class server {
+    public:
+        // Listen on all interfaces. If port is 0, any free port is used.
+        server(Stratum::pool&, uint16 port, uint32 threads = 2);
+        ~server();
+
+        server(const server&) = delete;
+        server& operator=(const server&) = delete;
+
+        // false if the port could not be opened.
+        bool valid() const {
+            return Threads.size() > 0;
+        }
+
+        uint16 port() const {
+            return Port;
+        }
+
+        size_t connections() const {
+            return Connections;
+        }
+
+        // send a job to every connection that has subscribed.
+        void notify(const Stratum::notify&);
+
+        // close every connection and wait for the threads to finish.
+        void stop();
+
+    private:
+        struct worker;
+
+        Stratum::pool& Pool;
+        int Listener;
+        uint16 Port;
+
+        std::atomic<bool> Stop;
+        std::atomic<connection_id> Next;
+        std::atomic<size_t> Connections;
+
+        std::vector<std::unique_ptr<worker>> Workers;
+        std::vector<std::thread> Threads;
+    };
+
+}
+
+#endif
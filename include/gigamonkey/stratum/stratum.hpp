@@ -25,7 +25,13 @@ namespace Gigamonkey::Stratum {
     
     // Stratum error codes (incomplete)
     enum error_code {
-        none
+        none, 
+        unknown = 20, 
+        job_not_found = 21, 
+        duplicate_share = 22, 
+        low_difficulty_share = 23, 
+        unauthorized_worker = 24, 
+        not_subscribed = 25
     };
     
     std::string error_message_from_code(error_code);
@@ -51,8 +57,10 @@ namespace Gigamonkey::Stratum {
         
         std::vector<json> Params;
         
+        // Params is initialized with parentheses because
+        // braces would wrap it in another json array.
         request() : ID{0}, Method{unset}, Params{} {}
-        request(request_id id, method m, const std::vector<json>& p) : ID{id}, Method{m}, Params{p} {}
+        request(request_id id, method m, const std::vector<json>& p) : ID{id}, Method{m}, Params(p) {}
         
         bool valid() const {
             return Method != unset;
@@ -75,7 +83,7 @@ namespace Gigamonkey::Stratum {
         std::vector<json> Params;
         
         notification() : Method{unset}, Params{} {}
-        notification(method m, const std::vector<json>& p) : Method{m}, Params{p} {}
+        notification(method m, const std::vector<json>& p) : Method{m}, Params(p) {}
         
         bool valid() const {
             return Method != unset;
@@ -101,9 +109,9 @@ namespace Gigamonkey::Stratum {
         std::string ErrorMessage;
         
         response() : ID{0}, Result{}, ErrorCode{none}{}
-        response(request_id id, json p) : ID{id}, Result{p}, ErrorCode{none}, ErrorMessage{} {}
+        response(request_id id, json p) : ID{id}, Result(p), ErrorCode{none}, ErrorMessage{} {}
         response(request_id id, json p, error_code c) : 
-            ID{id}, Result{p}, ErrorCode{c}, ErrorMessage{error_message_from_code(c)} {}
+            ID{id}, Result(p), ErrorCode{c}, ErrorMessage{error_message_from_code(c)} {}
         
         bool operator==(const response& r) const {
             return ID == r.ID && Result == r.Result && ErrorCode == r.ErrorCode;
@@ -115,7 +123,7 @@ namespace Gigamonkey::Stratum {
         
     private:
         response(request_id id, json p, error_code c, std::string error_message) : 
-            ID{id}, Result{p}, ErrorCode{c}, ErrorMessage{error_message} {}
+            ID{id}, Result(p), ErrorCode{c}, ErrorMessage{error_message} {}
             
         friend void from_json(const json& j, response& p);
     };
@@ -136,14 +144,17 @@ namespace Gigamonkey::Stratum {
         // The path is always index zero, so we don't need to store an index. 
         list<digest256> Path;
         
+        // the version field of a Bitcoin header, category for Boost. 
+        int32_little Version;
+        
         work::target Target;
         timestamp Now;
         
         bool Clean;
         
-        notify() : ID{}, Digest{}, GenerationTx1{}, GenerationTx2{}, Path{}, Target{}, Now{}, Clean{} {}
-        notify(job_id id, uint256 d, bytes tx1, bytes tx2, list<digest256> p, work::target t, timestamp n, bool c) : 
-            ID{id}, Digest{d}, GenerationTx1{tx1}, GenerationTx2{tx2}, Path{p}, Target{t}, Now{n}, Clean{c} {};
+        notify() : ID{}, Digest{}, GenerationTx1{}, GenerationTx2{}, Path{}, Version{}, Target{}, Now{}, Clean{} {}
+        notify(job_id id, uint256 d, bytes tx1, bytes tx2, list<digest256> p, int32_little v, work::target t, timestamp n, bool c) : 
+            ID{id}, Digest{d}, GenerationTx1{tx1}, GenerationTx2{tx2}, Path{p}, Version{v}, Target{t}, Now{n}, Clean{c} {};
         
         explicit notify(const notification&);
             
@@ -155,7 +166,7 @@ namespace Gigamonkey::Stratum {
             return ID == n.ID && Digest == n.Digest && 
                 GenerationTx1 == n.GenerationTx1 && 
                 GenerationTx2 == n.GenerationTx2 && 
-                Path == n.Path && Target == n.Target && 
+                Path == n.Path && Version == n.Version && Target == n.Target && 
                 Now == n.Now && Clean == n.Clean;
         }
         
@@ -239,7 +250,7 @@ namespace Gigamonkey::Stratum {
             Version{v}, Worker{w}, Notify{n} {}
         job(job_id i, const work::puzzle& puzzle, const worker& w, timestamp now, bool clean) : 
             Version{puzzle.Category}, Worker{w}, 
-            Notify{i, puzzle.Digest, puzzle.Header, puzzle.Body, puzzle.Path.Hashes, puzzle.Target, now, clean} {}
+            Notify{i, puzzle.Digest, puzzle.Header, puzzle.Body, puzzle.Path.Hashes, puzzle.Category, puzzle.Target, now, clean} {}
         
         bool valid() const {
             return Notify.valid();
@@ -0,0 +1,72 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_VALIDATOR
+#define GIGAMONKEY_STRATUM_VALIDATOR
+
+#include <gigamonkey/stratum/stratum.hpp>
+#include <memory>
+#include <unordered_map>
+
+namespace Gigamonkey::Stratum {
+
+    enum share_result {
+        // the job is unknown or has been replaced by a clean job.
+        stale,
+        duplicate,
+        // does not meet the difficulty of the worker.
+        low_difficulty,
+        // meets the difficulty of the worker but not the target of the job.
+        valid,
+        // meets the target of the job.
+        block
+    };
+
+    // the error that a share is rejected with, or none.
+    error_code error(share_result);
+
+    // Checks the shares of many workers. For every job that a worker has
+    // been given, it keeps whatever is the same for all shares of that job:
+    // the SHA-256 state after the part of the coinbase before ExtraNonce2,
+    // the Merkle branch and the targets. It remembers every share that has
+    // been submitted for a job, 16 bytes apiece in an open-addressed table,
+    // in order to catch duplicates. Not thread safe.
+    class validator {
+    public:
+        validator();
+        ~validator();
+
+        validator(const validator&) = delete;
+        validator& operator=(const validator&) = delete;
+
+        // Add a job that has been sent to its worker. Shares must meet
+        // share_target, and a share that also meets the target of the job
+        // is a block. A clean job replaces the other jobs of the worker.
+        // false if the job is invalid.
+        bool add(const job&, work::target share_target);
+
+        void remove(const worker_name&, job_id);
+
+        // remove every job of a worker.
+        void remove(const worker_name&);
+
+        // the number of jobs of all workers.
+        size_t size() const;
+
+        share_result check(const share&);
+
+        // Shares are checked in order, so a share that repeats an earlier
+        // one in the same batch is a duplicate. The coinbases, Merkle
+        // branches and work strings of all of them are hashed together
+        // midstate::lanes at a time.
+        std::vector<share_result> check(const std::vector<share>&);
+
+    private:
+        struct entry;
+
+        std::unordered_map<worker_name, std::unordered_map<job_id, std::unique_ptr<entry>>> Workers;
+    };
+
+}
+
+#endif
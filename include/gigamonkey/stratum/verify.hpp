@@ -0,0 +1,30 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_VERIFY
+#define GIGAMONKEY_STRATUM_VERIFY
+
+#include <gigamonkey/stratum/stratum.hpp>
+
+namespace Gigamonkey::Stratum {
+
+    struct verdict {
+        bool Valid;
+
+        // the difficulty that the share actually met, whether or not
+        // it met the difficulty of the job.
+        double Difficulty;
+    };
+
+    // Check many shares at once. This gives the same answers as
+    // solved::valid, but shares of the same job are checked together
+    // so that the part of the metadata before ExtraNonce2 is hashed once
+    // per job, and the work strings of all the shares are hashed
+    // midstate::lanes at a time. Verdicts are in the order given.
+    std::vector<verdict> verify(const std::vector<solved>&);
+
+    std::vector<verdict> verify(const job&, const std::vector<share>&);
+
+}
+
+#endif
@@ -0,0 +1,67 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_THREAD_POOL
+#define GIGAMONKEY_THREAD_POOL
+
+#include <gigamonkey/types.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Gigamonkey {
+
+    // A fixed set of threads, each with its own queue of tasks. A thread
+    // whose queue is empty takes tasks from the back of the others' queues,
+    // so that a few long tasks don't leave the other threads idle.
+    class thread_pool {
+    public:
+        using task = std::function<void()>;
+
+        // a pool of size 0 runs everything on the calling thread.
+        explicit thread_pool(uint32 threads = std::thread::hardware_concurrency());
+        ~thread_pool();
+
+        thread_pool(const thread_pool&) = delete;
+        thread_pool& operator=(const thread_pool&) = delete;
+
+        uint32 size() const {
+            return Threads.size();
+        }
+
+        void submit(task);
+
+        // Run f(i) for every i below n and return when they are all done. The
+        // calling thread runs tasks while it waits, so run can be called from
+        // inside a task.
+        void run(uint32 n, const std::function<void(uint32)>& f);
+
+    private:
+        struct queue {
+            std::mutex Mutex;
+            std::deque<task> Tasks;
+        };
+
+        std::vector<std::unique_ptr<queue>> Queues;
+        std::vector<std::thread> Threads;
+
+        std::atomic<uint32> Next;    // the queue that gets the next task.
+        std::atomic<uint64> Pending; // tasks that have not been taken.
+        std::atomic<bool> Stop;
+
+        std::mutex Sleep;
+        std::condition_variable Wake;
+
+        // take a task, from queue first if we can.
+        bool take(uint32 first, task& t);
+        void work(uint32 self);
+    };
+
+}
+
+#endif
@@ -7,11 +7,57 @@
 #include <gigamonkey/txid.hpp>
 #include <gigamonkey/merkle.hpp>
 #include <gigamonkey/work/target.hpp>
+#include <gigamonkey/arena.hpp>
 #include "primitives/block.h"
+#include <cstring>
 
 namespace Gigamonkey::Bitcoin {
+
+    // A contiguous run of serialized headers in chain order, 80 bytes each.
+    // It points into the storage of whatever produced it and is only good
+    // until that storage is modified.
+    struct header_range {
+        uint64 Height; // height of the first header.
+        bytes_view Headers;
+
+        header_range() : Height{0}, Headers{} {}
+        header_range(uint64 h, bytes_view b) : Height{h}, Headers{b} {}
+
+        size_t size() const {
+            return Headers.size() / 80;
+        }
+
+        bool empty() const {
+            return Headers.size() == 0;
+        }
+
+        const slice<80> operator[](size_t i) const {
+            return slice<80>(const_cast<byte*>(Headers.data() + 80 * i));
+        }
+    };
+
+    // A block locator is a list of hashes of blocks on a chain, starting
+    // at the tip, dense near the tip and exponentially sparse further back.
+    // It always ends with the first header.
+    using locator = list<digest<32>>;
+
+    // The heights to put in a locator for a chain that runs
+    // from base to tip. Ten steps of one and then doubling.
+    std::vector<uint64> locator_heights(uint64 tip, uint64 base = 0);
+
     struct timechain {
         virtual list<uint<80>> headers(uint64 since_height) const = 0;
+
+        // headers with heights in [from, to).
+        virtual header_range headers(uint64 from, uint64 to) const = 0;
+        // headers following the first hash in the locator that
+        // is on our best chain, at most max of them.
+        virtual header_range headers(const locator&, uint32 max) const = 0;
+        // headers following the given header up to the tip.
+        virtual header_range headers_to_tip(const digest<32>&) const = 0;
+        // a locator for our best chain.
+        virtual locator locate() const = 0;
+
         virtual bytes transaction(const digest<32>&) const = 0;
         virtual Merkle::path merkle_path(const digest<32>&) const = 0;
         // next 3 should work for both header hash and merkle root.
@@ -127,6 +173,17 @@ inline std::ostream& operator<<(std::ostream& o, const Gigamonkey::Bitcoin::outp
     return o << "outpoint{Reference : " << p.Reference << ", Index : " << p.Index << "}";
 }
 
+namespace std {
+    // txids are already random, so part of one is as good a hash as any. 
+    template <> struct hash<Gigamonkey::Bitcoin::outpoint> {
+        size_t operator()(const Gigamonkey::Bitcoin::outpoint& o) const {
+            Gigamonkey::uint64 x;
+            std::memcpy(&x, o.Reference.Value.data(), 8);
+            return x ^ Gigamonkey::uint32(o.Index);
+        }
+    };
+}
+
 namespace Gigamonkey::input {
     bool valid(bytes_view);
     slice<36> previous(bytes_view);
@@ -223,6 +280,9 @@ namespace Gigamonkey::Bitcoin {
         static transaction read(bytes_view);
         bytes write() const;
         
+        // write to the end of an arena. 
+        arena::span write(arena&) const;
+        
         txid id() const {
             return Gigamonkey::transaction::txid(write());
         }
@@ -288,7 +348,7 @@ namespace Gigamonkey::block {
         for (bytes_view b : txs) {
             leaves = leaves << Bitcoin::hash256(b);
         }
-        return Merkle::tree(leaves).root();
+        return Merkle::root(leaves);
     }
 }
 
@@ -375,7 +435,7 @@ namespace Gigamonkey::Bitcoin {
     
     template <typename X> 
     inline bytes_writer write_sequence(bytes_writer w, list<X> l) {
-        return data::fold([](bytes_writer w, X x)->bytes_writer{return w << x;}, 
+        return data::fold([](bytes_writer w, const X& x)->bytes_writer{return w << x;}, 
             write_var_int(w, data::size(l)), l);
     }
     
@@ -493,6 +553,12 @@ namespace Gigamonkey::Bitcoin {
         return b;
     }
     
+    inline arena::span transaction::write(arena& a) const {
+        arena::span x = a.allocate(serialized_size());
+        write(a.writer(x));
+        return x;
+    }
+    
     inline bool transaction::operator==(const transaction& t) const {
         return Version == t.Version && Inputs == t.Inputs && Outputs == t.Outputs && Locktime == t.Locktime;
     }
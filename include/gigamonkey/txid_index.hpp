@@ -0,0 +1,112 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_TXID_INDEX
+#define GIGAMONKEY_TXID_INDEX
+
+#include <gigamonkey/txid.hpp>
+#include <functional>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+namespace Gigamonkey::Bitcoin {
+
+    // An index on disk from txid to the position of a transaction in some
+    // other file. Only the first 8 bytes of each txid are kept, so a lookup
+    // may find more than one candidate, and the caller must check them
+    // against the full txid. An entry is 18 bytes.
+    //
+    // New entries are kept in memory until there are enough of them and then
+    // written as a sorted run, which is divided into buckets by the first bits
+    // of the prefix. Runs are merged as they accumulate so that there are only
+    // about log n of them. The file is mapped into memory for lookups.
+    class txid_index {
+    public:
+        struct entry {
+            uint64 Offset; // only 48 bits are kept.
+            uint32 Size;
+        };
+
+        // entries to keep in memory before writing a run.
+        constexpr static uint32 RunSize = 1 << 16;
+
+        constexpr static uint32 EntrySize = 18;
+
+        // the number we sort by.
+        static uint64 prefix(const txid&);
+
+    private:
+        struct run {
+            uint64 Start; // in the file.
+            uint64 Count;
+            uint32 Bits;
+            uint64 Through;
+
+            uint64 size() const;
+        };
+
+        std::string Path;
+        int File;
+        byte* Map;
+        uint64 MapSize;
+        uint64 End;
+        std::vector<run> Runs;
+        std::unordered_multimap<uint64, entry> Pending;
+        uint64 Through;
+
+        void remap();
+
+        // write a run of sorted entries at the given position in the file.
+        run write(const std::vector<std::pair<uint64, entry>>&, uint64 through, uint64 at);
+
+        std::vector<std::pair<uint64, entry>> entries(const run&) const;
+
+        // read the run that starts at a given position in the file.
+        std::optional<run> read(uint64 at) const;
+
+        void merge();
+
+    public:
+        // Open the index at the given path, creating it if it does not exist.
+        explicit txid_index(const std::string& path);
+        ~txid_index();
+
+        txid_index(const txid_index&) = delete;
+        txid_index& operator=(const txid_index&) = delete;
+
+        bool valid() const {
+            return File >= 0;
+        }
+
+        // number of entries, including those not yet written.
+        uint64 size() const;
+
+        size_t runs() const {
+            return Runs.size();
+        }
+
+        // Every entry added before the last call to commit with this value is on disk.
+        // The caller can use it to know where to start adding entries again after a restart.
+        uint64 through() const {
+            return Runs.size() == 0 ? 0 : Runs.back().Through;
+        }
+
+        void add(const txid&, entry);
+
+        // Call after a group of entries has been added, such as a block. If enough
+        // entries have accumulated, they are written to disk. through is a number
+        // which is saved along with them and which is returned by through().
+        void commit(uint64 through);
+
+        // write everything that has been committed.
+        void flush();
+
+        // Find the entry for a txid. verify is called with each candidate until
+        // it returns true, which is necessary because only a prefix of the txid is kept.
+        std::optional<entry> find(const txid&, std::function<bool(const entry&)> verify) const;
+    };
+
+}
+
+#endif
@@ -0,0 +1,62 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_VALIDATION
+#define GIGAMONKEY_VALIDATION
+
+#include <gigamonkey/redeem.hpp>
+#include <gigamonkey/thread_pool.hpp>
+#include <optional>
+
+namespace Gigamonkey::Bitcoin {
+
+    // Finds the outputs that transactions redeem.
+    struct prevout_provider {
+        virtual std::optional<output> operator()(const outpoint&) const = 0;
+    };
+
+    // The result of running the scripts of a transaction or of a block.
+    struct script_validation {
+        enum status : byte {
+            success,
+            invalid_script,
+            missing_prevout,
+            invalid_transaction // could not be read.
+        };
+
+        status Status;
+
+        // For every input of every transaction, in order, SCRIPT_ERR_OK if its
+        // script was run and was valid. Inputs that were not run because
+        // validation stopped at a failure are SCRIPT_ERR_UNKNOWN_ERROR.
+        std::vector<std::vector<ScriptError>> Errors;
+
+        // where the failure was found, if there was one.
+        uint32 Transaction;
+        uint32 Input;
+
+        script_validation() : Status{success}, Errors{}, Transaction{0}, Input{0} {}
+
+        bool valid() const {
+            return Status == success;
+        }
+
+        ScriptError error() const {
+            return Status == invalid_script ? Errors[Transaction][Input] : SCRIPT_ERR_UNKNOWN_ERROR;
+        }
+    };
+
+    // Run every input script of a transaction on the threads of the
+    // pool. Validation stops at the first script that fails.
+    script_validation validate(const vertex&, thread_pool&);
+
+    script_validation validate_transaction(bytes_view transaction, const prevout_provider&, thread_pool&);
+
+    // The inputs of a block may redeem outputs that appear earlier in
+    // the same block, which are found without the prevout provider.
+    // The coinbase is not checked.
+    script_validation validate_block(bytes_view block, const prevout_provider&, thread_pool&);
+
+}
+
+#endif
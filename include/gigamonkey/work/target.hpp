@@ -6,6 +6,7 @@
 
 #include <gigamonkey/hash.hpp>
 #include <gigamonkey/timestamp.hpp>
+#include <cmath>
 #include <vector>
 
 namespace Gigamonkey::work {
@@ -82,6 +83,10 @@ namespace Gigamonkey::work {
         work::difficulty difficulty() const {
             return work::difficulty(*this);
         };
+
+        // expected number of hashes required to meet the target.
+        // This is what is summed to get the cumulative work of a chain.
+        uint256 work() const;
         
         explicit operator work::difficulty() const {
             return difficulty();
@@ -92,6 +97,14 @@ namespace Gigamonkey::work {
         }
     };
     
+    // the difficulty that a hash meets, on the same scale as work::difficulty.
+    // It is a double because it is only used to tell how good a share is.
+    inline double hash_difficulty(const uint256& hash) {
+        double h = 0;
+        for (int i = 31; i >= 0; i--) h = h * 256 + hash.data()[i];
+        return std::ldexp(1.0, 224) / h;
+    }
+    
     const target SuccessHalf{33, 0x8000};
     const target SuccessQuarter{32, 0x400000};
     const target SuccessEighth{32, 0x200000};
@@ -99,6 +112,17 @@ namespace Gigamonkey::work {
     
     inline difficulty::difficulty(target t) : difficulty(scale(), N(t.expand())) {}
     
+    inline uint256 target::work() const {
+        uint256 t = expand();
+        if (t == 0) return uint256{};
+        uint256 d = t;
+        d += 1;
+        uint256 w{~t};
+        w /= d;
+        w += 1;
+        return w;
+    }
+
     inline target target::encode(byte e, uint24_little v) {
         target t;
         data::writer<uint24_little::iterator>(t.begin(), t.end()) << v << e;
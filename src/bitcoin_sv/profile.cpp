@@ -0,0 +1,177 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/script_profile.hpp>
+#include "script/interpreter.h"
+#include "taskcancellation.h"
+#include "streams.h"
+#include "config.h"
+#include "policy/policy.h"
+#include <algorithm>
+
+namespace Gigamonkey::Bitcoin {
+
+    namespace {
+
+        using valtype = std::vector<uint8_t>;
+
+        bool cast_to_bool(const valtype& v) {
+            for (size_t i = 0; i < v.size(); i++) if (v[i] != 0)
+                // negative zero is false.
+                return !(i == v.size() - 1 && v[i] == 0x80);
+            return false;
+        }
+
+        // Since we give the interpreter one instruction at a time, it doesn't
+        // know the script code that a signature is over. This checker
+        // replaces it with the code of the whole script.
+        class whole_script_checker : public BaseSignatureChecker {
+            const BaseSignatureChecker& Checker;
+            const CScript& Code;
+
+        public:
+            whole_script_checker(const BaseSignatureChecker& c, const CScript& code) : Checker{c}, Code{code} {}
+
+            bool CheckSig(const std::vector<uint8_t>& sig, const std::vector<uint8_t>& pubkey,
+                const CScript&, bool forkid) const override {
+                return Checker.CheckSig(sig, pubkey, Code, forkid);
+            }
+
+            bool CheckLockTime(const CScriptNum& n) const override {
+                return Checker.CheckLockTime(n);
+            }
+
+            bool CheckSequence(const CScriptNum& n) const override {
+                return Checker.CheckSequence(n);
+            }
+        };
+
+        class always_valid : public BaseSignatureChecker {
+        public:
+            bool CheckSig(const std::vector<uint8_t>&, const std::vector<uint8_t>&, const CScript&, bool) const override {
+                return true;
+            }
+        };
+
+        // Runs scripts one instruction at a time in order to measure them.
+        // Conditionals, the alt stack and code separators have state that
+        // the interpreter would lose between instructions, so we keep it
+        // here. Nothing else about the whole script is checked, so this is
+        // never used to decide whether a script is valid.
+        struct profiler {
+            script_profile& Profile;
+            std::shared_ptr<task::CCancellationSource> Source;
+            uint32 Flags;
+
+            std::vector<valtype> Stack;
+            std::vector<valtype> AltStack;
+            std::vector<bool> Exec;
+
+            // the script code that signatures are checked against.
+            CScript Code;
+            whole_script_checker Checker;
+
+            profiler(script_profile& p, const BaseSignatureChecker& c) : Profile{p},
+                Source{task::CCancellationSource::Make()}, Flags{StandardScriptVerifyFlags(true, true)},
+                Stack{}, AltStack{}, Exec{}, Code{}, Checker{c, Code} {}
+
+            bool executing() const {
+                return std::find(Exec.begin(), Exec.end(), false) == Exec.end();
+            }
+
+            bool step(const instruction_view& i, const CScript& whole, const CScript& single) {
+                switch (i.Op) {
+                    case OP_IF:
+                    case OP_NOTIF: {
+                        bool value = false;
+                        if (executing()) {
+                            if (Stack.empty()) return false;
+                            value = cast_to_bool(Stack.back()) == (i.Op == OP_IF);
+                            Stack.pop_back();
+                        }
+                        Exec.push_back(value);
+                        return true;
+                    }
+                    case OP_ELSE:
+                        if (Exec.empty()) return false;
+                        Exec.back() = !Exec.back();
+                        return true;
+                    case OP_ENDIF:
+                        if (Exec.empty()) return false;
+                        Exec.pop_back();
+                        return true;
+                    case OP_TOALTSTACK:
+                        if (Stack.empty()) return false;
+                        AltStack.push_back(Stack.back());
+                        Stack.pop_back();
+                        return true;
+                    case OP_FROMALTSTACK:
+                        if (AltStack.empty()) return false;
+                        Stack.push_back(AltStack.back());
+                        AltStack.pop_back();
+                        return true;
+                    case OP_CODESEPARATOR:
+                        Code = CScript(whole.begin() + i.Offset + 1, whole.end());
+                        return true;
+                    default: {
+                        std::optional<bool> result = EvalScript(GlobalConfig::GetConfig(), false, Source->GetToken(),
+                            Stack, single, Flags, Checker, nullptr);
+                        return result && *result;
+                    }
+                }
+            }
+
+            // false if the rest of the evaluation cannot be measured.
+            bool run(const script& s) {
+                CScript whole(s.begin(), s.end());
+                Code = whole;
+                AltStack.clear();
+                Exec.clear();
+
+                for (const instruction_view& i : instructions{s}) {
+                    bool conditional = i.Op >= OP_IF && i.Op <= OP_ENDIF;
+                    if (!conditional && !executing()) continue;
+
+                    CScript single(whole.begin() + i.Offset, whole.begin() + i.Offset + i.Size);
+
+                    auto start = std::chrono::steady_clock::now();
+                    bool ok = step(i, whole, single);
+                    Profile.Time[script_profile::classify(i.Op)] += 
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+
+                    Profile.Executed[i.Op]++;
+                    if (is_push(i.Op)) Profile.BytesPushed += i.data().size();
+                    if (Stack.size() + AltStack.size() > Profile.MaxStack) Profile.MaxStack = Stack.size() + AltStack.size();
+                    // what follows OP_RETURN depends on whether it is in a conditional.
+                    if (!ok || i.Op == OP_RETURN) return false;
+                }
+
+                return true;
+            }
+
+            void measure(const script& unlock, const script& lock) {
+                Profile.Evaluations++;
+                if (run(unlock)) run(lock);
+            }
+        };
+
+    }
+
+    evaluated evaluate_script(const script& unlock, const script& lock, script_profile& p) {
+        profiler{p, always_valid{}}.measure(unlock, lock);
+        return evaluate_script(unlock, lock);
+    }
+
+    evaluated evaluate_script(const script& unlock, const script& lock, const input_index& transaction, script_profile& p) {
+        const bytes& b = transaction.Transaction;
+        try {
+            CDataStream stream{reinterpret_cast<const char*>(b.data()),
+                reinterpret_cast<const char*>(b.data() + b.size()), SER_NETWORK, PROTOCOL_VERSION};
+            CTransaction tx{deserialize, stream};
+            if (uint32(transaction.Index) < tx.vin.size()) profiler{p, TransactionSignatureChecker(&tx, 
+                uint32(transaction.Index), Amount(int64(transaction.Output.Value)))}.measure(unlock, lock);
+        } catch (const std::ios_base::failure&) {}
+        return evaluate_script(unlock, lock, transaction);
+    }
+
+}
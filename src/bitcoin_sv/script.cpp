@@ -7,27 +7,61 @@
 #include "streams.h"
 #include "config.h"
 #include "policy/policy.h"
+#include <atomic>
+#include <thread>
 
 // not in use but required by config.h dependency
 bool fRequireStandard = true;
 
 namespace Gigamonkey::Bitcoin {
     
+    namespace {
+        
+        evaluated evaluate_script(
+            const CScript& unlock, 
+            const CScript& lock, 
+            const BaseSignatureChecker& checker, 
+            const task::CCancellationToken& token) {
+            evaluated Response;
+            std::optional<bool> response = VerifyScript(
+                GlobalConfig::GetConfig(), // Config. 
+                false, // true for consensus rules, false for policy rules.  
+                token, 
+                unlock, 
+                lock, 
+                StandardScriptVerifyFlags(true, true), // Flags. I don't know what these should be. 
+                checker, 
+                &Response.Error);
+            if (response.has_value()) {
+                Response.Return = *response;
+            } 
+            return Response;
+        }
+        
+        // A token for evaluations which are never cancelled. 
+        const task::CCancellationToken& never_cancelled() {
+            static const std::shared_ptr<task::CCancellationSource> Source = task::CCancellationSource::Make();
+            static const task::CCancellationToken Token = Source->GetToken();
+            return Token;
+        }
+        
+        std::optional<CTransaction> read_transaction(bytes_view b) {
+            try {
+                CDataStream stream{reinterpret_cast<const char*>(b.data()), 
+                    reinterpret_cast<const char*>(b.data() + b.size()), SER_NETWORK, PROTOCOL_VERSION};
+                return CTransaction{deserialize, stream};
+            } catch (const std::ios_base::failure&) {
+                return {};
+            }
+        }
+        
+    }
+    
     evaluated evaluate_script(const script& unlock, const script& lock, const BaseSignatureChecker& checker) {
-        evaluated Response;
-        std::optional<bool> response = VerifyScript(
-            GlobalConfig::GetConfig(), // Config. 
-            false, // true for consensus rules, false for policy rules.  
-            task::CCancellationSource::Make()->GetToken(), 
+        return evaluate_script(
             CScript(unlock.begin(), unlock.end()), 
             CScript(lock.begin(), lock.end()), 
-            StandardScriptVerifyFlags(true, true), // Flags. I don't know what these should be. 
-            checker, 
-            &Response.Error);
-        if (response.has_value()) {
-            Response.Return = *response;
-        } 
-        return Response;
+            checker, never_cancelled());
     }
     
     class DummySignatureChecker : public BaseSignatureChecker {
@@ -46,11 +80,109 @@ namespace Gigamonkey::Bitcoin {
     }
     
     evaluated evaluate_script(const script& unlock, const script& lock, const input_index& transaction) {
-        // transaction needs to be made into some stream but I don't know what that is. It's a
-        // template parameter in this constructor. 
-        CDataStream stream{static_cast<const std::vector<uint8_t>&>(transaction.Transaction), SER_NETWORK, PROTOCOL_VERSION};
-        CTransaction tx{deserialize, stream}; 
-        return evaluate_script(lock, unlock, TransactionSignatureChecker(&tx, transaction.Index, Amount(int64(transaction.Output.Value))));
+        std::optional<CTransaction> tx = read_transaction(transaction.Transaction);
+        if (!tx || uint32(transaction.Index) >= tx->vin.size()) return evaluated{SCRIPT_ERR_UNKNOWN_ERROR};
+        return evaluate_script(unlock, lock, 
+            TransactionSignatureChecker(&*tx, uint32(transaction.Index), Amount(int64(transaction.Output.Value))));
+    }
+    
+    struct evaluation_context::implementation {
+        CTransaction Transaction;
+        // The hashes of the prevouts, sequence numbers and outputs, which
+        // go into the signature hash of every input with fork id, so that
+        // they are computed once rather than once for every signature. 
+        PrecomputedTransactionData Precomputed;
+        std::vector<CScript> Locks;
+        std::vector<Amount> Amounts;
+        std::shared_ptr<task::CCancellationSource> Source;
+        task::CCancellationToken Token;
+        
+        implementation(CTransaction&& tx) : Transaction{std::move(tx)}, Precomputed{Transaction}, Locks{}, Amounts{}, 
+            Source{task::CCancellationSource::Make()}, Token{Source->GetToken()} {}
+        
+        evaluated evaluate(uint32 i, const task::CCancellationToken& token) const {
+            return Bitcoin::evaluate_script(Transaction.vin[i].scriptSig, Locks[i], 
+                TransactionSignatureChecker(&Transaction, i, Amounts[i], Precomputed), token);
+        }
+    };
+    
+    evaluation_context::evaluation_context(bytes_view transaction, list<output> redeemed) : Implementation{} {
+        std::optional<CTransaction> tx = read_transaction(transaction);
+        if (!tx || tx->vin.size() != redeemed.size()) return;
+        auto x = std::make_shared<implementation>(std::move(*tx));
+        x->Locks.reserve(redeemed.size());
+        x->Amounts.reserve(redeemed.size());
+        for (; !redeemed.empty(); redeemed = redeemed.rest()) {
+            const output& o = redeemed.first();
+            x->Locks.emplace_back(o.Script.begin(), o.Script.end());
+            x->Amounts.emplace_back(int64(o.Value));
+        }
+        Implementation = x;
+    }
+    
+    uint32 evaluation_context::inputs() const {
+        return valid() ? Implementation->Locks.size() : 0;
+    }
+    
+    evaluated evaluation_context::evaluate(index i) const {
+        if (uint32(i) >= inputs()) return evaluated{SCRIPT_ERR_UNKNOWN_ERROR};
+        return Implementation->evaluate(uint32(i), Implementation->Token);
+    }
+    
+    namespace {
+        
+        // run f on every index below size using up to the given number 
+        // of threads, each of which takes the next index that is left.
+        template <typename F>
+        void for_each_input(uint32 size, uint32 threads, F f) {
+            if (threads > size) threads = size;
+            if (threads <= 1) {
+                for (uint32 i = 0; i < size; i++) f(i);
+                return;
+            }
+            
+            std::atomic<uint32> next{0};
+            auto work = [&next, size, &f]() {
+                for (uint32 i = next++; i < size; i = next++) f(i);
+            };
+            
+            std::vector<std::thread> workers{};
+            workers.reserve(threads - 1);
+            for (uint32 t = 1; t < threads; t++) workers.emplace_back(work);
+            work();
+            for (std::thread& w : workers) w.join();
+        }
+        
+    }
+    
+    std::vector<evaluated> evaluation_context::evaluate_all(uint32 threads) const {
+        std::vector<evaluated> results(inputs());
+        for_each_input(inputs(), threads, [this, &results](uint32 i) {
+            results[i] = Implementation->evaluate(i, Implementation->Token);
+        });
+        return results;
+    }
+    
+    bool evaluation_context::verify(uint32 threads) const {
+        if (!valid()) return false;
+        // We cancel this source rather than the context's own 
+        // so that the context can be used again afterwards. 
+        std::shared_ptr<task::CCancellationSource> source = task::CCancellationSource::Make();
+        task::CCancellationToken token = source->GetToken();
+        std::atomic<bool> failed{false};
+        for_each_input(inputs(), threads, [this, &source, &token, &failed](uint32 i) {
+            if (failed) return;
+            evaluated e = Implementation->evaluate(i, token);
+            if (!e.valid() || !e.Return) {
+                failed = true;
+                source->Cancel();
+            }
+        });
+        return !failed;
+    }
+    
+    void evaluation_context::cancel() {
+        if (valid()) Implementation->Source->Cancel();
     }
 
 }
@@ -31,7 +31,7 @@ namespace Gigamonkey::Bitcoin {
         Amount amount((long)v.Output.Value);
         ::uint256 tmp= SignatureHash(script, tx, v.Index, hashType, amount);
         digest<32> output;
-        std::copy(output.begin(),tmp.begin(),tmp.end());
+        std::copy(tmp.begin(), tmp.end(), output.Value.begin());
         return output;
     }
 
@@ -0,0 +1,290 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/block_store.hpp>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace Gigamonkey::Bitcoin {
+
+    namespace {
+
+        bool read_all(int file, byte* b, size_t size, uint64 offset) {
+            while (size > 0) {
+                ssize_t n = ::pread(file, b, size, offset);
+                if (n <= 0) return false;
+                b += n;
+                size -= n;
+                offset += n;
+            }
+            return true;
+        }
+
+        bool write_all(int file, const byte* b, size_t size, uint64 offset) {
+            while (size > 0) {
+                ssize_t n = ::pwrite(file, b, size, offset);
+                if (n <= 0) return false;
+                b += n;
+                size -= n;
+                offset += n;
+            }
+            return true;
+        }
+
+        // A blk*.dat file is a sequence of records consisting of magic bytes,
+        // the size of the block and then the block. The end may be padded with zeros.
+        struct record {
+            uint64 Offset;
+            uint32 Size;
+
+            bool valid() const {
+                return Size != 0;
+            }
+        };
+
+        record next_record(int file, uint64 offset, const block_store::magic& m) {
+            byte prefix[8];
+            if (!read_all(file, prefix, 8, offset)) return {0, 0};
+            if (!std::equal(m.begin(), m.end(), prefix)) return {0, 0};
+            uint32 size = uint32(prefix[4]) | (uint32(prefix[5]) << 8) | (uint32(prefix[6]) << 16) | (uint32(prefix[7]) << 24);
+            return {offset + 8, size};
+        }
+
+    }
+
+    block_store::block_store(const std::string& path, uint64 base, const magic& m, size_t cache_size) :
+        Path{path}, Magic{m}, File{-1}, End{0}, Headers{base}, Blocks{}, Roots{}, Index{path + ".txids"},
+        Mutex{}, Trees{}, Recent{}, CacheSize{cache_size} {
+        if (!Index.valid()) return;
+        File = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (File < 0) return;
+
+        // index whatever is already there. We only need to read the headers
+        // of blocks whose transactions are already in the txid index. If the
+        // file ends with something we can't read, we will write over it.
+        while (true) {
+            record r = next_record(File, End, Magic);
+            if (!r.valid()) break;
+            if (r.Offset + r.Size <= Index.through()) {
+                bytes h = read(r.Offset, 80);
+                if (h.size() != 80 || !index(slice<80>(h.data()), r.Offset, r.Size)) break;
+            } else {
+                bytes b = read(r.Offset, r.Size);
+                if (b.size() != r.Size) break;
+                std::vector<txid> ids = check(b);
+                if (ids.empty() || !index(b, ids, r.Offset)) break;
+            }
+            End = r.Offset + r.Size;
+            Index.commit(End);
+        }
+    }
+
+    block_store::~block_store() {
+        if (File >= 0) ::close(File);
+    }
+
+    bytes block_store::read(uint64 offset, size_t size) const {
+        bytes b(size);
+        if (!read_all(File, b.data(), size, offset)) return {};
+        return b;
+    }
+
+    std::vector<txid> block_store::check(bytes_view b) const {
+        if (b.size() < 80) return {};
+        const slice<80> h = Gigamonkey::block::header(b);
+        if (!Headers.empty() && Gigamonkey::header::previous(h) != Headers.tip()) return {};
+        if (Headers.height(Gigamonkey::header::hash(h))) return {};
+
+        cross<bytes_view> txs = Gigamonkey::block::transactions(b);
+        if (txs.size() == 0) return {};
+
+        std::vector<txid> ids(txs.size());
+        for (size_t i = 0; i < txs.size(); i++) ids[i] = Gigamonkey::transaction::txid(txs[i]);
+
+        list<digest256> leaves{};
+        for (const txid& id : ids) leaves = leaves << id;
+        if (Merkle::root(leaves) != Gigamonkey::header::merkle_root(h)) return {};
+        return ids;
+    }
+
+    bool block_store::index(bytes_view b, const std::vector<txid>& ids, uint64 offset) {
+        if (!index(Gigamonkey::block::header(b), offset, static_cast<uint32>(b.size()))) return false;
+
+        cross<bytes_view> txs = Gigamonkey::block::transactions(b);
+        for (size_t i = 0; i < txs.size(); i++)
+            Index.add(ids[i], txid_index::entry{
+                offset + static_cast<uint64>(txs[i].data() - b.data()), static_cast<uint32>(txs[i].size())});
+
+        return true;
+    }
+
+    bool block_store::index(const slice<80> h, uint64 offset, uint32 size) {
+        if (!Headers.append(h)) return false;
+        Blocks.push_back(block_entry{offset, size});
+        Roots[Gigamonkey::header::merkle_root(h)] = Headers.height();
+        return true;
+    }
+
+    bool block_store::add(bytes_view b) {
+        if (!valid() || b.size() > 0xffffffff) return false;
+
+        bytes record(8 + b.size());
+        bytes_writer w{record.begin(), record.end()};
+        w = w << bytes_view{Magic.data(), 4} << uint32_little{static_cast<uint32>(b.size())} << b;
+
+        // Check everything before we write anything, and index
+        // nothing until the block has been written.
+        std::vector<txid> ids = check(b);
+        if (ids.empty()) return false;
+        if (!write_all(File, record.data(), record.size(), End)) return false;
+        if (!index(b, ids, End + 8)) return false;
+
+        End += record.size();
+        Index.commit(End);
+        return true;
+    }
+
+    uint32 block_store::ingest(const std::string& path) {
+        int file = ::open(path.c_str(), O_RDONLY);
+        if (file < 0) return 0;
+
+        uint32 added = 0;
+        uint64 offset = 0;
+        while (true) {
+            record r = next_record(file, offset, Magic);
+            if (!r.valid()) break;
+            bytes b(r.Size);
+            if (!read_all(file, b.data(), r.Size, r.Offset) || !add(b)) break;
+            offset = r.Offset + r.Size;
+            added++;
+        }
+
+        ::close(file);
+        return added;
+    }
+
+    std::optional<uint64> block_store::find(const digest256& d) const {
+        auto h = Headers.height(d);
+        if (h) return h;
+        auto r = Roots.find(d);
+        if (r == Roots.end()) return {};
+        return r->second;
+    }
+
+    std::optional<block_store::position> block_store::locate(const txid& id, bytes* tx) const {
+        // the index only keeps part of the txid, so we read
+        // the transaction to check that it's the right one.
+        auto e = Index.find(id, [this, &id, tx](const txid_index::entry& e) -> bool {
+            bytes b = read(e.Offset, e.Size);
+            if (b.size() != e.Size || Gigamonkey::transaction::txid(b) != id) return false;
+            if (tx != nullptr) *tx = b;
+            return true;
+        });
+        if (!e) return {};
+
+        // the block containing it is the last one that starts before it.
+        auto next = std::upper_bound(Blocks.begin(), Blocks.end(), e->Offset,
+            [](uint64 offset, const block_entry& b) -> bool {
+                return offset < b.Offset;
+            });
+        return position{Headers.base() + (next - Blocks.begin()) - 1, e->Offset, e->Size};
+    }
+
+    ptr<block_store::merkle_levels> block_store::tree(uint64 height) const {
+        std::lock_guard<std::mutex> lock(Mutex);
+        auto cached = Trees.find(height);
+        if (cached != Trees.end()) return cached->second;
+
+        const block_entry& e = Blocks[height - Headers.base()];
+        bytes b = read(e.Offset, e.Size);
+        cross<bytes_view> txs = Gigamonkey::block::transactions(b);
+        if (txs.size() == 0) return nullptr;
+
+        ptr<merkle_levels> levels = std::make_shared<merkle_levels>();
+        std::vector<digest256> level(txs.size());
+        for (size_t i = 0; i < txs.size(); i++) level[i] = Gigamonkey::transaction::txid(txs[i]);
+        levels->push_back(level);
+
+        while (levels->back().size() > 1) {
+            const std::vector<digest256>& last = levels->back();
+            std::vector<digest256> next((last.size() + 1) / 2);
+            for (size_t i = 0; i < next.size(); i++)
+                next[i] = Merkle::hash_concatinated(last[2 * i], 2 * i + 1 < last.size() ? last[2 * i + 1] : last[2 * i]);
+            levels->push_back(next);
+        }
+
+        if (Recent.size() >= CacheSize && Recent.size() > 0) {
+            Trees.erase(Recent.front());
+            Recent.erase(Recent.begin());
+        }
+        Trees[height] = levels;
+        Recent.push_back(height);
+        return levels;
+    }
+
+    list<uint<80>> block_store::headers(uint64 since_height) const {
+        list<uint<80>> l{};
+        header_range r = Headers.headers(since_height, Headers.height() + 1);
+        for (size_t i = 0; i < r.size(); i++) {
+            uint<80> x;
+            std::copy(r[i].begin(), r[i].end(), x.data());
+            l = l << x;
+        }
+        return l;
+    }
+
+    bytes block_store::transaction(const digest<32>& id) const {
+        bytes tx{};
+        locate(id, &tx);
+        return tx;
+    }
+
+    Merkle::path block_store::merkle_path(const digest<32>& id) const {
+        auto p = locate(id);
+        if (!p) return {};
+        ptr<merkle_levels> levels = tree(p->Height);
+        if (levels == nullptr) return {};
+
+        const std::vector<digest256>& leaves = levels->front();
+        uint32 index = std::find(leaves.begin(), leaves.end(), id) - leaves.begin();
+        if (index == leaves.size()) return {};
+
+        list<digest256> hashes{};
+        uint32 i = index;
+        for (size_t l = 0; l + 1 < levels->size(); l++) {
+            const std::vector<digest256>& level = (*levels)[l];
+            uint32 sibling = i ^ 1;
+            hashes = hashes << (sibling < level.size() ? level[sibling] : level[i]);
+            i >>= 1;
+        }
+        return Merkle::path{hashes, index};
+    }
+
+    uint<80> block_store::header(const digest<32>& d) const {
+        auto h = find(d);
+        if (!h) return {};
+        uint<80> x;
+        const slice<80> s = Headers[*h];
+        std::copy(s.begin(), s.end(), x.data());
+        return x;
+    }
+
+    list<txid> block_store::transactions(const digest<32>& d) const {
+        auto h = find(d);
+        if (!h) return {};
+        ptr<merkle_levels> levels = tree(*h);
+        if (levels == nullptr) return {};
+        list<txid> l{};
+        for (const digest256& id : levels->front()) l = l << id;
+        return l;
+    }
+
+    bytes block_store::block(const digest<32>& d) const {
+        auto h = find(d);
+        if (!h) return {};
+        const block_entry& e = Blocks[*h - Headers.base()];
+        return read(e.Offset, e.Size);
+    }
+
+}
@@ -26,79 +26,98 @@ namespace Gigamonkey::Bitcoin {
 
 namespace Gigamonkey::Boost {
     
-    input_script input_script::read(bytes b) {
+    namespace {
+
+        // Everything in a Boost output script after the pushes at the beginning, 
+        // which is the same for every script. 
+        const bytes& output_script_suffix() {
+            using namespace Bitcoin;
+            static const bytes Suffix = compile(program{
+                OP_CAT, OP_SWAP, 
+                // copy mining pool’s pubkey hash to alt stack. A copy remains on the stack.
+                OP_5, OP_ROLL, OP_DUP, OP_TOALTSTACK, OP_CAT,              
+                // expand compact form of target and push to altstack. 
+                OP_2, OP_PICK, OP_TOALTSTACK, 
+                OP_5, OP_ROLL, OP_SIZE, OP_4, OP_EQUALVERIFY, OP_CAT,   // check size of extra_nonce_1
+                OP_5, OP_ROLL, OP_SIZE, OP_8, OP_EQUALVERIFY, OP_CAT,   // check size of extra_nonce_2
+                // create metadata document and hash it.
+                OP_SWAP, OP_CAT, OP_HASH256,    
+                OP_SWAP, OP_TOALTSTACK, OP_CAT, OP_CAT,                 // target to altstack. 
+                OP_SWAP, OP_SIZE, OP_4, OP_EQUALVERIFY, OP_CAT,         // check size of timestamp.
+                OP_FROMALTSTACK, OP_CAT,                                // attach target
+                // check size of nonce. Boost POW string is constructed. 
+                OP_SWAP, OP_SIZE, OP_4, OP_EQUALVERIFY, OP_CAT,
+                // Take hash of work string and ensure that it is positive and minimally encoded.
+                OP_HASH256, ensure_positive, 
+                // Get target, transform to expanded form, and ensure that it is positive and minimally encoded.
+                OP_FROMALTSTACK, expand_target, ensure_positive, 
+                // check that the hash of the Boost POW string is less than the target
+                OP_LESSTHAN, OP_VERIFY,
+                // check that the given address matches the pubkey and check signature.
+                OP_DUP, OP_HASH160, OP_FROMALTSTACK, OP_EQUALVERIFY, OP_CHECKSIG});
+            return Suffix;
+        }
+
+    }
+    
+    input_script input_script::read(bytes_view b) {
         using namespace Bitcoin;
+        // signature, pubkey, nonce, timestamp, extra nonce 2, 
+        // extra nonce 1 and, for bounty scripts, the miner address. 
+        bytes_view push[7];
+        uint32 count = 0;
+        
+        instructions script{b};
+        if (!script.valid()) return {};
+        for (const instruction_view& i : script) {
+            if (count == 7 || !is_push(i.Op)) return {};
+            push[count++] = i.data();
+        }
+        
+        if (count < 6 || 
+            (push[1].size() != 33 && push[1].size() != 65) || 
+            push[2].size() != 4 || 
+            push[3].size() != 4 || 
+            push[4].size() != 8 || 
+            push[5].size() != 4 || 
+            (count == 7 && push[6].size() != 20)) return {};
+        
         input_script x{};
-        bytes MinerPubkey;
-        bytes Timestamp;
-        bytes Nonce;
-        bytes ExtraNonce1;
-        bytes ExtraNonce2;
-        bytes MinerAddress;
-        
-        if (!pattern{
-            push{x.Signature.Data}, 
-            pubkey_pattern(MinerPubkey), 
-            push_size{4, Nonce}, 
-            push_size{4, Timestamp}, 
-            push_size{8, ExtraNonce2}, 
-            push_size{4, ExtraNonce1}, 
-            optional{push_size{20, MinerAddress}}}.match(b)) return {};
-        
-        x.Type = MinerAddress.size() == 0 ? Boost::contract : Boost::bounty;
-        
-        if (x.Type == Boost::bounty) std::copy(
-            MinerAddress.begin(), 
-            MinerAddress.end(), 
-            x.MinerAddress.begin());
-        
-        x.Pubkey.Value.resize(MinerPubkey.size());
-        std::copy(
-            MinerPubkey.begin(), 
-            MinerPubkey.end(), 
-            x.Pubkey.Value.begin());
-        
-        std::copy(
-            Timestamp.begin(), 
-            Timestamp.end(), 
-            x.Timestamp.data());
-        
-        std::copy(
-            Nonce.begin(), 
-            Nonce.end(), 
-            x.Nonce.data());
-        
-        std::copy(
-            ExtraNonce1.begin(), 
-            ExtraNonce1.end(), 
-            x.ExtraNonce1.data());
-        
-        std::copy(
-            ExtraNonce2.begin(), 
-            ExtraNonce2.end(), 
-            x.ExtraNonce2.data());
+        x.Type = count == 6 ? Boost::contract : Boost::bounty;
+        
+        x.Signature.Data = bytes(push[0]);
+        
+        x.Pubkey.Value.resize(push[1].size());
+        std::copy(push[1].begin(), push[1].end(), x.Pubkey.Value.begin());
+        
+        std::copy(push[2].begin(), push[2].end(), x.Nonce.data());
+        std::copy(push[3].begin(), push[3].end(), x.Timestamp.data());
+        std::copy(push[4].begin(), push[4].end(), x.ExtraNonce2.data());
+        std::copy(push[5].begin(), push[5].end(), x.ExtraNonce1.data());
+        
+        if (x.Type == Boost::bounty) std::copy(push[6].begin(), push[6].end(), x.MinerAddress.begin());
         
         return x;
     }
     
-    output_script output_script::read(bytes b) {
+    Bitcoin::pattern output_script::pattern(
+        bytes& miner_address, 
+        bytes& category, 
+        bytes& content, 
+        bytes& target, 
+        bytes& tag, 
+        bytes& user_nonce, 
+        bytes& data) {
         using namespace Bitcoin;
-        output_script x{};
-        bytes Category{};
-        bytes Content{};
-        bytes Target{};
-        bytes UserNonce{};
-        bytes MinerAddress{};
-        
-        pattern output_script_pattern = pattern{
+        return Bitcoin::pattern{
             push{bytes{0x62, 0x6F, 0x6F, 0x73, 0x74, 0x70, 0x6F, 0x77}}, OP_DROP, 
-            optional{push_size{20, MinerAddress}},
-            push_size{4, Category},
-            push_size{32, Content},
-            push_size{4, Target},
-            push{x.Tag}, 
-            push_size{4, UserNonce}, 
-            push{x.AdditionalData}, OP_CAT, OP_SWAP, 
+            optional{push_size{20, miner_address}},
+            push_size{4, category},
+            push_size{32, content},
+            push_size{4, target},
+            push{tag}, 
+            push_size{4, user_nonce}, 
+            push{data}, OP_CAT, OP_SWAP, 
             // copy mining pool’s pubkey hash to alt stack. A copy remains on the stack.
             push{5}, OP_ROLL, OP_DUP, OP_TOALTSTACK, OP_CAT,              
             // copy target and push to altstack. 
@@ -120,41 +139,106 @@ namespace Gigamonkey::Boost {
             OP_LESSTHAN, OP_VERIFY,
             // check that the given address matches the pubkey and check signature.
             OP_DUP, OP_HASH160, OP_FROMALTSTACK, OP_EQUALVERIFY, OP_CHECKSIG};
+    }
+    
+    const Bitcoin::matcher& output_script::compiled() {
+        static bytes MinerAddress{};
+        static bytes Category{};
+        static bytes Content{};
+        static bytes Target{};
+        static bytes Tag{};
+        static bytes UserNonce{};
+        static bytes AdditionalData{};
+        static const Bitcoin::matcher Matcher{pattern(MinerAddress, Category, Content, Target, Tag, UserNonce, AdditionalData)};
+        return Matcher;
+    }
+    
+    output_script output_script::from_captures(const bytes_view* x) {
+        bytes_view miner_address = x[0];
+        bytes_view category = x[1];
+        bytes_view content = x[2];
+        bytes_view target = x[3];
+        bytes_view tag = x[4];
+        bytes_view user_nonce = x[5];
+        bytes_view data = x[6];
+        
+        if (tag.size() > 20) return {};
         
-        if (!output_script_pattern.match(b)) return {};
+        output_script o{};
+        o.Type = miner_address.size() == 0 ? Boost::bounty : Boost::contract;
         
-        std::copy(
-            Category.begin(), 
-            Category.end(), 
-            x.Category.data());
+        if (o.Type == Boost::contract) std::copy(
+            miner_address.begin(), 
+            miner_address.end(), 
+            o.MinerAddress.begin());
         
-        if (x.Tag.size() > 20) return {};
+        std::copy(category.begin(), category.end(), o.Category.data());
+        std::copy(content.begin(), content.end(), o.Content.data());
+        std::copy(target.begin(), target.end(), o.Target.data());
+        std::copy(user_nonce.begin(), user_nonce.end(), o.UserNonce.data());
         
-        x.Type = MinerAddress.size() == 0 ? Boost::bounty : Boost::contract;
+        o.Tag = bytes(tag.size());
+        std::copy(tag.begin(), tag.end(), o.Tag.begin());
         
-        if (x.Type == Boost::contract) std::copy(
-            MinerAddress.begin(), 
-            MinerAddress.end(), 
-            x.MinerAddress.begin());
+        o.AdditionalData = bytes(data.size());
+        std::copy(data.begin(), data.end(), o.AdditionalData.begin());
         
-        std::copy(
-            Target.begin(), 
-            Target.end(), 
-            x.Target.data());
+        return o;
+    }
+    
+    output_script output_script::read(bytes_view b) {
+        return output_script(output_script_view::read(b));
+    }
+    
+    output_script_view output_script_view::read(bytes_view b) {
+        using namespace Bitcoin;
+        static const byte BoostPow[] = {0x08, 0x62, 0x6F, 0x6F, 0x73, 0x74, 0x70, 0x6F, 0x77, OP_DROP};
         
-        std::copy(
-            UserNonce.begin(), 
-            UserNonce.end(), 
-            x.UserNonce.data());
+        // the smallest script is a bounty with an empty tag and no additional data. 
+        const bytes& suffix = output_script_suffix();
+        if (b.size() < 10 + 5 + 33 + 5 + 1 + 5 + 1 + suffix.size() || 
+            std::memcmp(b.data(), BoostPow, 10) != 0) return {};
         
-        std::copy(
-            Content.begin(), 
-            Content.end(), 
-            x.Content.data());
+        output_script_view x{};
+        bytes_view rest = b.substr(10);
         
+        // a push of exactly some number of bytes.
+        auto fixed = [&rest](uint32 size, bytes_view& to) -> bool {
+            if (rest.size() < size + 1 || rest[0] != size) return false;
+            to = rest.substr(1, size);
+            rest = rest.substr(size + 1);
+            return true;
+        };
+        
+        // a push of any size. 
+        auto any = [&rest](bytes_view& to) -> bool {
+            instruction_view i = instruction_view::read(rest);
+            if (!i.valid() || !is_push_data(i.Op)) return false;
+            to = i.Data;
+            rest = rest.substr(i.Size);
+            return true;
+        };
+        
+        bool contract = rest[0] == 20;
+        if ((contract && !fixed(20, x.MinerAddress)) || 
+            !fixed(4, x.Category) || 
+            !fixed(32, x.Content) || 
+            !fixed(4, x.Target) || 
+            !any(x.Tag) || x.Tag.size() > 20 || 
+            !fixed(4, x.UserNonce) || 
+            !any(x.AdditionalData) || 
+            rest != bytes_view{suffix}) return {};
+        
+        x.Type = contract ? Boost::contract : Boost::bounty;
         return x;
     }
     
+    output_script_view::operator output_script() const {
+        if (Type == Boost::invalid) return {};
+        bytes_view x[7]{MinerAddress, Category, Content, Target, Tag, UserNonce, AdditionalData};
+        return output_script::from_captures(x);
+    }
+    
     Bitcoin::program input_script::program() const {
         using namespace Bitcoin;
         if (Type == Boost::invalid) return {};
@@ -169,45 +253,36 @@ namespace Gigamonkey::Boost {
         return p;
     }
     
+    // The pushes are written directly into a buffer of the right 
+    // size, which is then finished with output_script_suffix(). 
     script output_script::write() const {
         using namespace Bitcoin;
         if (Type == Boost::invalid) return {};
-        program boost_output_script = program{push_hex("626F6F7374706F77"), OP_DROP}; // "boostpow"
-        
-        if (Type == Boost::contract) 
-            boost_output_script = boost_output_script.append(push_data(MinerAddress));
-        
-        boost_output_script = boost_output_script.append(
-            push_data(Category),
-            push_data(Content), 
-            push_data(Target), 
-            push_data(Tag), 
-            push_data(UserNonce), 
-            push_data(bytes_view(AdditionalData)), 
-            OP_CAT, OP_SWAP, 
-            // copy mining pool’s pubkey hash to alt stack. A copy remains on the stack.
-            OP_5, OP_ROLL, OP_DUP, OP_TOALTSTACK, OP_CAT,              
-            // expand compact form of target and push to altstack. 
-            OP_2, OP_PICK, OP_TOALTSTACK, 
-            OP_5, OP_ROLL, OP_SIZE, OP_4, OP_EQUALVERIFY, OP_CAT,   // check size of extra_nonce_1
-            OP_5, OP_ROLL, OP_SIZE, OP_8, OP_EQUALVERIFY, OP_CAT,   // check size of extra_nonce_2
-            // create metadata document and hash it.
-            OP_SWAP, OP_CAT, OP_HASH256,    
-            OP_SWAP, OP_TOALTSTACK, OP_CAT, OP_CAT,                 // target to altstack. 
-            OP_SWAP, OP_SIZE, OP_4, OP_EQUALVERIFY, OP_CAT,         // check size of timestamp.
-            OP_FROMALTSTACK, OP_CAT,                                // attach target
-            // check size of nonce. Boost POW string is constructed. 
-            OP_SWAP, OP_SIZE, OP_4, OP_EQUALVERIFY, OP_CAT,
-            // Take hash of work string and ensure that it is positive and minimally encoded.
-            OP_HASH256, ensure_positive, 
-            // Get target, transform to expanded form, and ensure that it is positive and minimally encoded.
-            OP_FROMALTSTACK, expand_target, ensure_positive, 
-            // check that the hash of the Boost POW string is less than the target
-            OP_LESSTHAN, OP_VERIFY,
-            // check that the given address matches the pubkey and check signature.
-            OP_DUP, OP_HASH160, OP_FROMALTSTACK, OP_EQUALVERIFY, OP_CHECKSIG);
         
-        return compile(boost_output_script);
+        static const byte BoostPow[] = {0x62, 0x6F, 0x6F, 0x73, 0x74, 0x70, 0x6F, 0x77}; // "boostpow"
+        
+        bytes_view pushes[] = {
+            bytes_view{BoostPow, 8}, 
+            bytes_view(MinerAddress), 
+            bytes_view{Category.data(), 4}, 
+            bytes_view(Content), 
+            bytes_view{Target.data(), 4}, 
+            bytes_view(Tag), 
+            bytes_view{UserNonce.data(), 4}, 
+            bytes_view(AdditionalData)};
+        
+        const bytes& suffix = output_script_suffix();
+        
+        size_t size = 1 + suffix.size(); // OP_DROP
+        for (int i = 0; i < 8; i++) 
+            if (i != 1 || Type == Boost::contract) size += push_length(pushes[i].size());
+        
+        bytes b(size);
+        bytes_writer w{b.begin(), b.end()};
+        w = write_push(w, pushes[0]) << static_cast<byte>(OP_DROP);
+        for (int i = 1; i < 8; i++) if (i != 1 || Type == Boost::contract) w = write_push(w, pushes[i]);
+        w << bytes_view(suffix);
+        return b;
     }
     /*
     work::puzzle puzzle(Boost::output_script o, digest160 miner) { 
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/boost/job_index.hpp>
+
+namespace Gigamonkey::Boost {
+
+    namespace {
+
+        Bitcoin::outpoint previous(bytes_view input) {
+            Bitcoin::outpoint o{};
+            o.read(bytes_reader{input.data(), input.data() + 36});
+            return o;
+        }
+
+        satoshi value(bytes_view output) {
+            satoshi v{};
+            bytes_reader{output.data(), output.data() + 8} >> v;
+            return v;
+        }
+
+    }
+
+    bool job_index::add(const Boost::output& x) {
+        if (!x.valid() || Jobs.count(x.Reference) != 0) return false;
+        double difficulty = double(x.Script.Target.difficulty());
+        Jobs.emplace(x.Reference, entry{job{x, difficulty},
+            ByContent.emplace(x.Script.Content, x.Reference),
+            ByCategory.emplace(int64(x.Script.Category), x.Reference),
+            ByTag.emplace(x.Script.Tag, x.Reference),
+            ByDifficulty.emplace(difficulty, x.Reference)});
+        return true;
+    }
+
+    bool job_index::remove(const Bitcoin::outpoint& o) {
+        auto x = Jobs.find(o);
+        if (x == Jobs.end()) return false;
+        ByContent.erase(x->second.Content);
+        ByCategory.erase(x->second.Category);
+        ByTag.erase(x->second.Tag);
+        ByDifficulty.erase(x->second.Difficulty);
+        Jobs.erase(x);
+        return true;
+    }
+
+    uint32 job_index::add_transaction(bytes_view tx) {
+        cross<bytes_view> outputs = Gigamonkey::transaction::outputs(tx);
+        if (outputs.size() == 0) return 0;
+
+        if (Jobs.size() > 0) for (const bytes_view& i : Gigamonkey::transaction::inputs(tx)) remove(previous(i));
+
+        // most outputs are not Boost outputs, so the txid is
+        // only computed if one is found.
+        std::optional<Bitcoin::txid> id{};
+        uint32 added = 0;
+        for (uint32 i = 0; i < outputs.size(); i++) {
+            output_script_view v = output_script_view::read(Gigamonkey::output::script(outputs[i]));
+            if (!v.valid()) continue;
+            if (!id) id = Gigamonkey::transaction::txid(tx);
+            if (add(Boost::output{Bitcoin::outpoint{*id, index{i}}, output_script(v), value(outputs[i])})) added++;
+        }
+
+        return added;
+    }
+
+    bool job_index::add_block(bytes_view block) {
+        cross<bytes_view> txs = Gigamonkey::block::transactions(block);
+        if (txs.size() == 0) return false;
+        for (const bytes_view& tx : txs) add_transaction(tx);
+        return true;
+    }
+
+    std::vector<job_index::job> job_index::by_difficulty(double min, double max) const {
+        std::vector<job> jobs{};
+        for (auto i = ByDifficulty.lower_bound(min); i != ByDifficulty.end() && i->first <= max; i++)
+            jobs.push_back(Jobs.at(i->second).Job);
+        return jobs;
+    }
+
+}
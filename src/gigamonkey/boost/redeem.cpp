@@ -0,0 +1,140 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/boost/redeem.hpp>
+#include <cmath>
+
+namespace Gigamonkey::Boost {
+
+    namespace {
+
+        using Bitcoin::template_part;
+
+        // everything in a Boost input script after the signature.
+        template <size_t pubkey_size> struct input_script_template {
+            constexpr static template_part BountyParts[] = {template_part::push(pubkey_size),
+                template_part::push(4), template_part::push(4), template_part::push(8), template_part::push(4),
+                template_part::push(20)};
+
+            constexpr static template_part ContractParts[] = {template_part::push(pubkey_size),
+                template_part::push(4), template_part::push(4), template_part::push(8), template_part::push(4)};
+
+            constexpr static Bitcoin::script_template<
+                Bitcoin::template_length(BountyParts),
+                Bitcoin::template_holes(BountyParts)> Bounty{BountyParts};
+
+            constexpr static Bitcoin::script_template<
+                Bitcoin::template_length(ContractParts),
+                Bitcoin::template_holes(ContractParts)> Contract{ContractParts};
+        };
+
+        using compressed = input_script_template<33>;
+        using uncompressed = input_script_template<65>;
+
+        size_t tail_size(type t, bool compressed_pubkey) {
+            if (t == bounty) return compressed_pubkey ? compressed::Bounty.size() : uncompressed::Bounty.size();
+            return compressed_pubkey ? compressed::Contract.size() : uncompressed::Contract.size();
+        }
+
+        void write_tail(byte* out, type t, const Bitcoin::pubkey& p, uint32_little extra_nonce_1, const work::solution& x) {
+            bytes_view pubkey = p.Value;
+            bytes_view nonce{x.Nonce.data(), 4};
+            bytes_view timestamp = x.Timestamp;
+            bytes_view extra_nonce_2{x.ExtraNonce.data(), 8};
+            bytes_view extra_nonce{extra_nonce_1.data(), 4};
+            if (t == bounty) {
+                digest160 address = p.hash();
+                std::array<bytes_view, 6> pushes{pubkey, nonce, timestamp, extra_nonce_2, extra_nonce, bytes_view(address)};
+                if (pubkey.size() == 33) compressed::Bounty.write(out, pushes);
+                else uncompressed::Bounty.write(out, pushes);
+                return;
+            }
+
+            std::array<bytes_view, 5> pushes{pubkey, nonce, timestamp, extra_nonce_2, extra_nonce};
+            if (pubkey.size() == 33) compressed::Contract.write(out, pushes);
+            else uncompressed::Contract.write(out, pushes);
+        }
+
+    }
+
+    size_t input_script_size(type t, bool compressed_pubkey) {
+        if (t == invalid) return 0;
+        return Bitcoin::push_length(MaxSignatureSize) + tail_size(t, compressed_pubkey);
+    }
+
+    arena::span redeem(arena& a, const std::vector<solved_output>& solved, const Bitcoin::secret& key,
+        const digest160& pay_to, double fee_rate, int32_little locktime) {
+        arena::span nothing{a.size(), 0};
+        if (solved.size() == 0) return nothing;
+
+        Bitcoin::pubkey pubkey = key.to_public();
+        digest160 miner = pubkey.hash();
+        bool compressed_pubkey = pubkey.Value.size() == 33;
+
+        satoshi spent{0};
+        for (const solved_output& x : solved) {
+            if (!x.valid() || x.Proof.puzzle().miner_address() != miner) return nothing;
+            spent += x.Value;
+        }
+
+        int32_little version{2};
+        uint32_little sequence{0xffffffff};
+        uint32 inputs = solved.size();
+        size_t output_size = 8 + 1 + Bitcoin::pay_to_address::Template.size();
+
+        // input scripts are always shorter than 0xfd bytes, so their sizes take one byte.
+        size_t max_size = 4 + Bitcoin::var_int_size(inputs) + 1 + output_size + 4;
+        for (const solved_output& x : solved) max_size += 36 + 1 + input_script_size(x.Proof.Type, compressed_pubkey) + 4;
+
+        satoshi fee{static_cast<int64>(std::ceil(fee_rate * max_size))};
+        if (spent <= fee) return nothing;
+
+        // The transaction with empty input scripts, which is what
+        // the sighash cache is made from.
+        size_t inputs_size = 4 + Bitcoin::var_int_size(inputs) + 41 * inputs;
+        arena::span incomplete = a.allocate(inputs_size + 1 + output_size + 4);
+        bytes_writer w = Bitcoin::write_var_int(a.writer(incomplete) << version, inputs);
+        for (const solved_output& x : solved) w = w << x.Outpoint << byte{0} << sequence;
+        byte script[Bitcoin::pay_to_address::Template.size()];
+        Bitcoin::pay_to_address::write(script, pay_to);
+        w << byte{1} << (spent - fee) << byte(sizeof(script)) << bytes_view{script, sizeof(script)} << locktime;
+
+        Bitcoin::sighash_cache cache{a.view(incomplete)};
+        Bitcoin::sighash::directive directive = Bitcoin::directive(Bitcoin::sighash::all);
+
+        // sign every input and find the exact size.
+        std::vector<Bitcoin::signature> signatures{};
+        signatures.reserve(inputs);
+        size_t size = inputs_size + 1 + output_size + 4;
+        for (uint32 i = 0; i < inputs; i++) {
+            const solved_output& x = solved[i];
+            Bitcoin::output prev{x.Value, x.Proof.output_script().write()};
+            // sign gives only the DER signature, which is followed by the directive in the script.
+            signatures.push_back(Bitcoin::sign(cache.hash(index{i}, prev, directive), key.Secret));
+            signatures.back().Data.push_back(directive);
+            size += Bitcoin::push_length(signatures.back().Data.size()) + tail_size(x.Proof.Type, compressed_pubkey);
+        }
+
+        arena::span complete = a.allocate(size);
+        w = Bitcoin::write_var_int(a.writer(complete) << version, inputs);
+        std::array<byte, uncompressed::Bounty.size()> tail;
+        for (uint32 i = 0; i < inputs; i++) {
+            const solved_output& x = solved[i];
+            size_t tail_length = tail_size(x.Proof.Type, compressed_pubkey);
+            write_tail(tail.data(), x.Proof.Type, pubkey, x.Proof.Puzzle.ExtraNonce, x.Proof.Solution);
+            w = Bitcoin::write_push(w << x.Outpoint << byte(Bitcoin::push_length(signatures[i].Data.size()) + tail_length), signatures[i]);
+            w = w << bytes_view{tail.data(), tail_length} << sequence;
+        }
+
+        // the output and locktime are the same as in the incomplete transaction.
+        w << a.view(arena::span{incomplete.Offset + inputs_size, 1 + output_size + 4});
+        return complete;
+    }
+
+    bytes redeem(const std::vector<solved_output>& solved, const Bitcoin::secret& key,
+        const digest160& pay_to, double fee_rate, int32_little locktime) {
+        arena a{};
+        return bytes(a.view(redeem(a, solved, key, pay_to, fee_rate, locktime)));
+    }
+
+}
@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/boost/scheduler.hpp>
+#include <cstring>
+
+namespace Gigamonkey::Boost {
+
+    bool scheduler::rank::operator<(const rank& r) const {
+        if (Profitability != r.Profitability) return Profitability > r.Profitability;
+        int c = std::memcmp(Outpoint.Reference.Value.data(), r.Outpoint.Reference.Value.data(), 32);
+        if (c != 0) return c < 0;
+        return uint32(Outpoint.Index) < uint32(r.Outpoint.Index);
+    }
+
+    double scheduler::profitability(const Boost::output& o, double difficulty) const {
+        return double(o.Value - Fee) / difficulty;
+    }
+
+    void scheduler::add(const Boost::output& o) {
+        if (!o.valid()) return;
+        double difficulty = double(o.Script.Target.difficulty());
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (Jobs.count(o.Reference) != 0) return;
+        job j{o, difficulty, profitability(o, difficulty)};
+        Jobs.emplace(o.Reference, entry{j, false});
+        Open.insert(rank{j.Profitability, o.Reference});
+    }
+
+    bool scheduler::remove(const Bitcoin::outpoint& o) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        auto x = Jobs.find(o);
+        if (x == Jobs.end()) return false;
+        if (!x->second.Claimed) Open.erase(rank{x->second.Job.Profitability, o});
+        Jobs.erase(x);
+        return true;
+    }
+
+    void scheduler::set_fee(satoshi fee) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        Fee = fee;
+        Open.clear();
+        for (auto& x : Jobs) {
+            job& j = x.second.Job;
+            j.Profitability = profitability(j.Output, j.Difficulty);
+            if (!x.second.Claimed) Open.insert(rank{j.Profitability, x.first});
+        }
+    }
+
+    std::optional<scheduler::job> scheduler::claim(price minimum) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        if (Open.empty() || Open.begin()->Profitability < minimum) return {};
+        entry& e = Jobs.at(Open.begin()->Outpoint);
+        Open.erase(Open.begin());
+        e.Claimed = true;
+        return e.Job;
+    }
+
+    bool scheduler::release(const Bitcoin::outpoint& o) {
+        std::lock_guard<std::mutex> lock(Mutex);
+        auto x = Jobs.find(o);
+        if (x == Jobs.end() || !x->second.Claimed) return false;
+        x->second.Claimed = false;
+        Open.insert(rank{x->second.Job.Profitability, o});
+        return true;
+    }
+
+    std::vector<scheduler::job> scheduler::best(uint32 count) const {
+        std::lock_guard<std::mutex> lock(Mutex);
+        std::vector<job> jobs{};
+        for (auto i = Open.begin(); i != Open.end() && jobs.size() < count; i++) jobs.push_back(Jobs.at(i->Outpoint).Job);
+        return jobs;
+    }
+
+    size_t scheduler::size() const {
+        std::lock_guard<std::mutex> lock(Mutex);
+        return Jobs.size();
+    }
+
+    size_t scheduler::claimed() const {
+        std::lock_guard<std::mutex> lock(Mutex);
+        return Jobs.size() - Open.size();
+    }
+
+}
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/boost/solver.hpp>
+
+namespace Gigamonkey::Boost {
+
+    namespace {
+
+        // how many nonces are hashed together by solve.
+        constexpr uint32 batch = 1024;
+
+    }
+
+    solver::solver(const Boost::puzzle& p) :
+        Puzzle{p}, Target{p.Target.expand()},
+        Meta{write(p.Header.size() + 4, p.Header, p.ExtraNonce)} {}
+
+    digest256 solver::merkle_root(uint64_little extra_nonce_2) const {
+        return merkle_roots(extra_nonce_2, 1)[0];
+    }
+
+    std::vector<digest256> solver::merkle_roots(uint64 first, size_t count) const {
+        std::vector<uint64> extra_nonce_2(count);
+        for (size_t i = 0; i < count; i++) extra_nonce_2[i] = first + i;
+        return Gigamonkey::merkle_roots(Meta, Puzzle.Body, extra_nonce_2, Puzzle.Path);
+    }
+
+    std::optional<work::solution> solver::solve(const work::solution& initial, uint32 count) const {
+        if (!valid()) return {};
+
+        // the nonce is in the last 16 bytes of the work string, which
+        // are all that is hashed for each attempt.
+        uint<80> work_string = work::string{Puzzle.Category, Puzzle.Digest,
+            merkle_root(initial.ExtraNonce).Value, initial.Timestamp, Puzzle.Target, initial.Nonce}.write();
+        midstate front{bytes_view{work_string.data(), 64}};
+
+        byte tails[batch * 16];
+        digest256 hashes[batch];
+        uint32 next = initial.Nonce;
+        while (count > 0) {
+            uint32 n = std::min(count, batch);
+            for (uint32 i = 0; i < n; i++) {
+                std::copy(work_string.data() + 64, work_string.data() + 76, tails + 16 * i);
+                boost::endian::store_little_u32(tails + 16 * i + 12, next + i);
+            }
+
+            front.hash256(tails, 16, n, hashes);
+            for (uint32 i = 0; i < n; i++) if (hashes[i].Value < Target)
+                return work::solution{initial.Timestamp, nonce{next + i}, initial.ExtraNonce};
+
+            next += n;
+            count -= n;
+        }
+
+        return {};
+    }
+
+}
@@ -0,0 +1,56 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/classifier.hpp>
+#include <gigamonkey/boost/boost.hpp>
+
+namespace Gigamonkey::Bitcoin {
+
+    classifier::id classifier::add(const matcher& m) {
+        if (m.captures() > MaxCaptures) return none;
+        id i = Templates.size();
+        Templates.push_back(m);
+        std::bitset<256> starts = m.starts();
+        for (uint32 b = 0; b < 256; b++) if (starts[b]) First[b].push_back(i);
+        return i;
+    }
+
+    classifier::result classifier::classify(bytes_view script) const {
+        result r{};
+
+        // an empty script doesn't have a first byte, so we try everything.
+        if (script.size() == 0) {
+            for (id i = 0; i < Templates.size(); i++) if (Templates[i].match(script, r.Capture) == matcher::success) {
+                r.Template = i;
+                r.Captures = Templates[i].captures();
+                return r;
+            }
+            return r;
+        }
+
+        for (id i : First[script[0]]) {
+            const matcher& m = Templates[i];
+            bytes_view prefix = m.prefix();
+            if (script.size() < prefix.size() || !std::equal(prefix.begin(), prefix.end(), script.begin())) continue;
+            if (m.match_after_prefix(script, r.Capture) != matcher::success) continue;
+            r.Template = i;
+            r.Captures = m.captures();
+            return r;
+        }
+
+        return result{};
+    }
+
+    const classifier& classifier::standard() {
+        static const classifier Standard = []() -> classifier {
+            classifier c{};
+            c.add(Bitcoin::pay_to_address::compiled());
+            c.add(Bitcoin::pay_to_pubkey::compiled());
+            c.add(op_return_data::pattern());
+            c.add(Boost::output_script::compiled());
+            return c;
+        }();
+        return Standard;
+    }
+
+}
@@ -0,0 +1,295 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/headers.hpp>
+#include <algorithm>
+
+namespace Gigamonkey::Bitcoin {
+
+    std::optional<uint64> header_store::height(const digest256& d) const {
+        auto i = Index.find(d);
+        if (i == Index.end()) return {};
+        return i->second;
+    }
+
+    bool header_store::append(const slice<80> h) {
+        if (!empty() && Gigamonkey::header::previous(h) != Hashes.back()) return false;
+        digest256 d = Gigamonkey::header::hash(h);
+        if (Index.count(d) != 0) return false;
+        Headers.insert(Headers.end(), h.begin(), h.end());
+        Index[d] = Base + Hashes.size();
+        Hashes.push_back(d);
+        return true;
+    }
+
+    void header_store::truncate(uint64 height) {
+        while (!empty() && (height < Base || this->height() > height)) {
+            Index.erase(Hashes.back());
+            Hashes.pop_back();
+        }
+        Headers.resize(80 * Hashes.size());
+    }
+
+    header_range header_store::headers(uint64 from, uint64 to) const {
+        if (from < Base) from = Base;
+        if (to > Base + Hashes.size()) to = Base + Hashes.size();
+        if (from >= to) return {};
+        return header_range{from, bytes_view{Headers.data() + 80 * (from - Base), 80 * (to - from)}};
+    }
+
+    header_range header_store::headers(const locator& l, uint32 max) const {
+        uint64 from = Base;
+        locator x = l;
+        while (!x.empty()) {
+            auto h = height(x.first());
+            if (h) {
+                from = *h + 1;
+                break;
+            }
+            x = x.rest();
+        }
+        return headers(from, from + max);
+    }
+
+    header_range header_store::headers_to_tip(const digest256& d) const {
+        auto h = height(d);
+        if (!h) return {};
+        return headers(*h + 1, Base + Hashes.size());
+    }
+
+    locator header_store::locate() const {
+        locator l{};
+        if (empty()) return l;
+        for (uint64 h : locator_heights(height(), Base)) l = l << hash(h);
+        return l;
+    }
+
+    fork_tree::fork_tree(const slice<80> root, uint64 height, const uint256& work) :
+        Headers{}, Nodes{}, Index{}, Tip{0}, Best{height}, Listener{} {
+        digest256 d = Gigamonkey::header::hash(root);
+        Headers.insert(Headers.end(), root.begin(), root.end());
+        Nodes.push_back(node{d, none, height, work == 0 ? Gigamonkey::header::target(root).work() : work});
+        Index[d] = 0;
+        Best.append(root);
+    }
+
+    fork_tree::index fork_tree::attach(const slice<80> h) {
+        index parent = find(Gigamonkey::header::previous(h));
+        if (parent == none) return none;
+        digest256 d = Gigamonkey::header::hash(h);
+        if (Index.count(d) != 0) return none;
+        work::target target = Gigamonkey::header::target(h);
+        if (!(d.Value < target.expand())) return none;
+
+        index i = Nodes.size();
+        uint256 w = Nodes[parent].Work;
+        w += target.work();
+        Headers.insert(Headers.end(), h.begin(), h.end());
+        Nodes.push_back(node{d, parent, Nodes[parent].Height + 1, w});
+        Index[d] = i;
+
+        // most of the time a new header either extends the tip,
+        // which we can handle without looking at anything else,
+        // or has less work than the tip, which we ignore.
+        if (!(w > Nodes[Tip].Work)) return i;
+        reorg r = change_tip(i);
+        if (Listener) Listener(*this, r);
+        return i;
+    }
+
+    fork_tree::index fork_tree::ancestor(index a, index b) const {
+        while (Nodes[a].Height > Nodes[b].Height) a = Nodes[a].Parent;
+        while (Nodes[b].Height > Nodes[a].Height) b = Nodes[b].Parent;
+        while (a != b) {
+            if (a == none || b == none) return none;
+            a = Nodes[a].Parent;
+            b = Nodes[b].Parent;
+        }
+        return a;
+    }
+
+    fork_tree::reorg fork_tree::change_tip(index next) {
+        reorg r{};
+        if (Nodes[next].Parent == Tip) {
+            r.Ancestor = Tip;
+            r.Connected.push_back(next);
+            Best.append((*this)[next]);
+            Tip = next;
+            return r;
+        }
+
+        r.Ancestor = ancestor(Tip, next);
+
+        for (index i = Tip; i != r.Ancestor; i = Nodes[i].Parent) r.Disconnected.push_back(i);
+        for (index i = next; i != r.Ancestor; i = Nodes[i].Parent) r.Connected.push_back(i);
+        std::reverse(r.Connected.begin(), r.Connected.end());
+
+        Best.truncate(Nodes[r.Ancestor].Height);
+        for (index i : r.Connected) Best.append((*this)[i]);
+        Tip = next;
+        return r;
+    }
+
+}
+
+namespace Gigamonkey::Bitcoin {
+
+    namespace {
+
+        // targets only change every so often, so we remember the last one.
+        struct work_of {
+            work::target Target;
+            uint256 Work;
+
+            work_of() : Target{}, Work{} {}
+
+            const uint256& operator()(const slice<80> h) {
+                work::target t = Gigamonkey::header::target(h);
+                if (t != Target) {
+                    Target = t;
+                    Work = t.work();
+                }
+                return Work;
+            }
+        };
+
+    }
+
+    checkpoint checkpoint::make(const header_store& store) {
+        if (store.empty() || store.base() != 0) return {};
+        return make(store, 0, uint256{}, Merkle::frontier{});
+    }
+
+    checkpoint checkpoint::make(const checkpoint& previous, const header_store& store) {
+        if (!previous.valid() || !store.contains(previous.Height) ||
+            store.hash(previous.Height) != previous.Tip) return {};
+        return make(store, previous.Height + 1, previous.Work, previous.Frontier);
+    }
+
+    checkpoint checkpoint::make(const header_store& store, uint64 from, uint256 work, Merkle::frontier f) {
+        uint64 height = store.height();
+        uint64 first = height + 1 - std::min(uint64(Window), height + 1);
+        if (first < store.base()) first = store.base();
+
+        work_of w{};
+        for (uint64 h = from; h <= height; h++) {
+            f.add(store.hash(h));
+            work += w(store[h]);
+        }
+
+        checkpoint x{};
+        x.Height = height;
+        x.Tip = store.tip();
+        x.Work = work;
+        header_range window = store.headers(first, height + 1);
+        x.Headers = bytes(window.Headers.size());
+        std::copy(window.Headers.begin(), window.Headers.end(), x.Headers.begin());
+        x.WindowWork = work;
+        for (uint64 h = height; h > first; h--) x.WindowWork -= w(store[h]);
+        x.Commitment = f.root();
+        x.Frontier = f;
+        return x;
+    }
+
+    bool checkpoint::valid() const {
+        size_t size = window();
+        if (size == 0 || size > Window || Headers.size() != 80 * size || Height + 1 < size) return false;
+        if (Gigamonkey::header::hash((*this)[size - 1]) != Tip) return false;
+
+        work_of w{};
+        uint256 work = WindowWork;
+        for (size_t i = 1; i < size; i++) {
+            if (Gigamonkey::header::previous((*this)[i]) != Gigamonkey::header::hash((*this)[i - 1])) return false;
+            work += w((*this)[i]);
+        }
+
+        return work == Work && Frontier.Leaves == Height + 1 && Frontier.root() == Commitment;
+    }
+
+    timestamp checkpoint::median_time_past() const {
+        std::vector<uint32> times{};
+        for (size_t i = window() - std::min(size_t(11), window()); i < window(); i++)
+            times.push_back(uint32(Gigamonkey::header::timestamp((*this)[i]).Value));
+        if (times.size() == 0) return {};
+        std::sort(times.begin(), times.end());
+        return timestamp{uint32_little{times[times.size() / 2]}};
+    }
+
+    header_store checkpoint::load() const {
+        if (!valid()) return {};
+        header_store store{Height + 1 - window()};
+        store.reserve(window());
+        for (size_t i = 0; i < window(); i++) store.append((*this)[i]);
+        return store;
+    }
+
+    std::vector<uint256> checkpoint::window_work() const {
+        std::vector<uint256> works{};
+        if (window() == 0) return works;
+        works.reserve(window());
+        works.push_back(WindowWork);
+        work_of w{};
+        for (size_t i = 1; i < window(); i++) {
+            uint256 next = works.back();
+            next += w((*this)[i]);
+            works.push_back(next);
+        }
+        return works;
+    }
+
+    namespace {
+        const uint32 CheckpointVersion = 1;
+
+        // version, height, tip, work, window work, commitment, leaves.
+        const size_t CheckpointFixedSize = 4 + 8 + 32 + 32 + 32 + 32 + 8;
+    }
+
+    bytes checkpoint::write() const {
+        uint32 peaks = 0;
+        for (uint32 i = 0; i < Frontier.Peaks.size(); i++) if ((Frontier.Leaves >> i) & 1) peaks++;
+
+        bytes b(CheckpointFixedSize + 4 + 32 * peaks + 4 + Headers.size());
+        bytes_writer w{b.begin(), b.end()};
+        w = w << uint32_little{CheckpointVersion} << uint64_little{Height} << Tip << Work << WindowWork
+            << Commitment << uint64_little{Frontier.Leaves} << uint32_little{peaks};
+        for (uint32 i = 0; i < Frontier.Peaks.size(); i++) if ((Frontier.Leaves >> i) & 1) w = w << Frontier.Peaks[i];
+        w = w << uint32_little{static_cast<uint32>(window())} << bytes_view{Headers};
+        return b;
+    }
+
+    checkpoint checkpoint::read(bytes_view b) {
+        if (b.size() < CheckpointFixedSize + 4) return {};
+        checkpoint x{};
+        uint32_little version;
+        uint64_little height;
+        uint64_little leaves;
+        uint32_little peaks;
+        bytes_reader r{b.data(), b.data() + b.size()};
+        r = r >> version >> height >> x.Tip >> x.Work >> x.WindowWork >> x.Commitment >> leaves >> peaks;
+        if (version != CheckpointVersion) return {};
+        x.Height = height;
+
+        // we write the peaks that are in use, so there
+        // must be one for each bit that is set in leaves.
+        uint32 levels = 0;
+        uint32 expected = 0;
+        for (uint64 l = leaves; l != 0; l >>= 1) {
+            expected += l & 1;
+            levels++;
+        }
+        if (expected != peaks || b.size() < CheckpointFixedSize + 4 + 32 * peaks + 4) return {};
+        x.Frontier = Merkle::frontier{leaves, std::vector<digest256>(levels)};
+        for (uint32 i = 0; i < levels; i++) if ((uint64(leaves) >> i) & 1) r = r >> x.Frontier.Peaks[i];
+
+        uint32_little size;
+        r = r >> size;
+        // checked first so that 80 * size cannot overflow.
+        if (size > Window || b.size() != CheckpointFixedSize + 4 + 32 * peaks + 4 + 80 * uint64(size)) return {};
+        x.Headers = bytes(80 * size);
+        r = r >> x.Headers;
+
+        if (!x.valid()) return {};
+        return x;
+    }
+
+}
@@ -69,3 +69,40 @@ namespace Gigamonkey::Merkle {
     }
     
 }
+
+namespace Gigamonkey::Merkle {
+
+    void frontier::add(const digest256& leaf) {
+        digest256 next = leaf;
+        uint32 level = 0;
+        while ((Leaves >> level) & 1) {
+            next = hash_concatinated(Peaks[level], next);
+            Peaks[level] = digest256{};
+            level++;
+        }
+        if (Peaks.size() <= level) Peaks.resize(level + 1);
+        Peaks[level] = next;
+        Leaves++;
+    }
+
+    digest256 frontier::root() const {
+        if (Leaves == 0) return digest256{};
+        // the node on the right edge of the tree at each level
+        // that is built from leaves that don't fill a subtree.
+        bool carrying = false;
+        digest256 carry{};
+        uint32 level = 0;
+        while (true) {
+            uint64 remaining = Leaves >> level;
+            if (remaining == 1 && !carrying) return Peaks[level];
+            if (remaining == 0 && carrying) return carry;
+            if (remaining & 1) carry = carrying ?
+                hash_concatinated(Peaks[level], carry) :
+                hash_concatinated(Peaks[level], Peaks[level]);
+            else if (carrying) carry = hash_concatinated(carry, carry);
+            carrying = carrying || (remaining & 1);
+            level++;
+        }
+    }
+
+}
@@ -0,0 +1,216 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/midstate.hpp>
+
+namespace Gigamonkey {
+
+    namespace {
+
+        constexpr uint32 K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+        constexpr std::array<uint32, 8> Initial{
+            0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+        inline uint32 rotate(uint32 x, int n) {
+            return (x >> n) | (x << (32 - n));
+        }
+
+        inline uint32 read_big(const byte* b) {
+            return (uint32(b[0]) << 24) | (uint32(b[1]) << 16) | (uint32(b[2]) << 8) | uint32(b[3]);
+        }
+
+        inline void write_big(byte* b, uint32 x) {
+            b[0] = byte(x >> 24);
+            b[1] = byte(x >> 16);
+            b[2] = byte(x >> 8);
+            b[3] = byte(x);
+        }
+
+        // the SHA-256 state of n messages at once. Every step is a loop
+        // over the messages with no branches, so that it can be vectorized.
+        template <size_t n> struct state {
+            uint32 Words[8][n];
+
+            explicit state(const std::array<uint32, 8>& s) {
+                for (int j = 0; j < 8; j++) for (size_t i = 0; i < n; i++) Words[j][i] = s[j];
+            }
+
+            // compress one block of each message.
+            void compress(const byte* const* blocks) {
+                uint32 w[64][n];
+                for (int t = 0; t < 16; t++) for (size_t i = 0; i < n; i++) w[t][i] = read_big(blocks[i] + 4 * t);
+                for (int t = 16; t < 64; t++) for (size_t i = 0; i < n; i++) {
+                    uint32 s0 = rotate(w[t - 15][i], 7) ^ rotate(w[t - 15][i], 18) ^ (w[t - 15][i] >> 3);
+                    uint32 s1 = rotate(w[t - 2][i], 17) ^ rotate(w[t - 2][i], 19) ^ (w[t - 2][i] >> 10);
+                    w[t][i] = w[t - 16][i] + s0 + w[t - 7][i] + s1;
+                }
+
+                uint32 a[n], b[n], c[n], d[n], e[n], f[n], g[n], h[n];
+                for (size_t i = 0; i < n; i++) {
+                    a[i] = Words[0][i]; b[i] = Words[1][i]; c[i] = Words[2][i]; d[i] = Words[3][i];
+                    e[i] = Words[4][i]; f[i] = Words[5][i]; g[i] = Words[6][i]; h[i] = Words[7][i];
+                }
+
+                for (int t = 0; t < 64; t++) for (size_t i = 0; i < n; i++) {
+                    uint32 t1 = h[i] + (rotate(e[i], 6) ^ rotate(e[i], 11) ^ rotate(e[i], 25)) +
+                        ((e[i] & f[i]) ^ (~e[i] & g[i])) + K[t] + w[t][i];
+                    uint32 t2 = (rotate(a[i], 2) ^ rotate(a[i], 13) ^ rotate(a[i], 22)) +
+                        ((a[i] & b[i]) ^ (a[i] & c[i]) ^ (b[i] & c[i]));
+                    h[i] = g[i]; g[i] = f[i]; f[i] = e[i]; e[i] = d[i] + t1;
+                    d[i] = c[i]; c[i] = b[i]; b[i] = a[i]; a[i] = t1 + t2;
+                }
+
+                for (size_t i = 0; i < n; i++) {
+                    Words[0][i] += a[i]; Words[1][i] += b[i]; Words[2][i] += c[i]; Words[3][i] += d[i];
+                    Words[4][i] += e[i]; Words[5][i] += f[i]; Words[6][i] += g[i]; Words[7][i] += h[i];
+                }
+            }
+
+            void write(byte* out, size_t i) const {
+                for (int j = 0; j < 8; j++) write_big(out + 4 * j, Words[j][i]);
+            }
+        };
+
+        // the size of what is left to hash after the midstate, with padding.
+        inline size_t padded(size_t size) {
+            return (size + 9 + 63) / 64 * 64;
+        }
+
+        // the rest of the prefix, then the suffix, then the padding.
+        void pad(byte* out, const byte* rest, size_t rest_size, const byte* suffix, size_t suffix_size, uint64 length) {
+            size_t size = padded(rest_size + suffix_size);
+            std::copy(rest, rest + rest_size, out);
+            std::copy(suffix, suffix + suffix_size, out + rest_size);
+            out[rest_size + suffix_size] = 0x80;
+            std::fill(out + rest_size + suffix_size + 1, out + size - 8, 0);
+            uint64 bits = length * 8;
+            for (int k = 0; k < 8; k++) out[size - 1 - k] = byte(bits >> (8 * k));
+        }
+
+        // hash256 of up to n messages. The first hash is finished from
+        // the midstate and the second takes one block.
+        template <size_t n>
+        void finish(const std::array<uint32, 8>& midstate, const byte* tails, size_t tail_size, size_t count, digest256* out) {
+            state<n> first{midstate};
+            const byte* blocks[n];
+            for (size_t k = 0; k < tail_size; k += 64) {
+                for (size_t i = 0; i < n; i++) blocks[i] = tails + std::min(i, count - 1) * tail_size + k;
+                first.compress(blocks);
+            }
+
+            byte second[n][64];
+            byte digest[32];
+            for (size_t i = 0; i < n; i++) {
+                first.write(digest, i);
+                pad(second[i], digest, 32, nullptr, 0, 32);
+                blocks[i] = second[i];
+            }
+
+            state<n> last{Initial};
+            last.compress(blocks);
+            for (size_t i = 0; i < count; i++) last.write(out[i].begin(), i);
+        }
+
+    }
+
+    midstate::midstate() : State{Initial}, Rest{}, RestSize{0}, Length{0} {}
+
+    midstate::midstate(bytes_view prefix) : midstate{} {
+        state<1> s{State};
+        while (prefix.size() - Length >= 64) {
+            const byte* block = prefix.data() + Length;
+            s.compress(&block);
+            Length += 64;
+        }
+        for (int j = 0; j < 8; j++) State[j] = s.Words[j][0];
+        RestSize = prefix.size() - Length;
+        std::copy(prefix.begin() + Length, prefix.end(), Rest.begin());
+    }
+
+    digest256 midstate::sha256(bytes_view suffix) const {
+        bytes tail(padded(RestSize + suffix.size()));
+        pad(tail.data(), Rest.data(), RestSize, suffix.data(), suffix.size(), size() + suffix.size());
+        state<1> s{State};
+        for (size_t k = 0; k < tail.size(); k += 64) {
+            const byte* block = tail.data() + k;
+            s.compress(&block);
+        }
+        digest256 d;
+        s.write(d.begin(), 0);
+        return d;
+    }
+
+    digest256 midstate::hash256(bytes_view suffix) const {
+        digest256 d;
+        hash256(suffix.data(), suffix.size(), 1, &d);
+        return d;
+    }
+
+    void midstate::hash256(const byte* suffixes, size_t suffix_size, size_t count, digest256* out) const {
+        size_t tail_size = padded(RestSize + suffix_size);
+        uint64 length = size() + suffix_size;
+        bytes tails(tail_size * std::min(count, lanes));
+        for (size_t done = 0; done < count; done += lanes) {
+            size_t n = std::min(lanes, count - done);
+            for (size_t i = 0; i < n; i++)
+                pad(tails.data() + i * tail_size, Rest.data(), RestSize, suffixes + (done + i) * suffix_size, suffix_size, length);
+            if (n == 1) finish<1>(State, tails.data(), tail_size, 1, out + done);
+            else finish<lanes>(State, tails.data(), tail_size, n, out + done);
+        }
+    }
+
+    std::vector<digest256> merkle_roots(const midstate& coinbase, bytes_view rest,
+        const std::vector<uint64>& extra_nonce_2, const Merkle::path& path) {
+        size_t count = extra_nonce_2.size();
+        size_t tail_size = 8 + rest.size();
+        bytes tails(tail_size * count);
+        for (size_t i = 0; i < count; i++) {
+            byte* tail = tails.data() + i * tail_size;
+            boost::endian::store_little_u64(tail, extra_nonce_2[i]);
+            std::copy(rest.begin(), rest.end(), tail + 8);
+        }
+
+        std::vector<digest256> roots(count);
+        coinbase.hash256(tails.data(), tail_size, count, roots.data());
+
+        // As in Merkle::path::derive_root, bit i of the index
+        // says whether the root is on the right at level i.
+        bytes pairs(64 * count);
+        uint32 index = path.Index;
+        for (list<digest256> hashes = path.Hashes; !hashes.empty(); hashes = hashes.rest(), index >>= 1) {
+            const digest256& h = hashes.first();
+            size_t root = (index & 1) ? 32 : 0;
+            size_t sibling = 32 - root;
+            for (size_t i = 0; i < count; i++) {
+                byte* pair = pairs.data() + 64 * i;
+                std::copy(roots[i].Value.data(), roots[i].Value.data() + 32, pair + root);
+                std::copy(h.Value.data(), h.Value.data() + 32, pair + sibling);
+            }
+            midstate{}.hash256(pairs.data(), 64, count, roots.data());
+        }
+
+        return roots;
+    }
+
+    std::vector<digest256> hash256(const std::vector<work::string>& x) {
+        bytes strings(80 * x.size());
+        for (size_t i = 0; i < x.size(); i++) {
+            uint<80> w = x[i].write();
+            std::copy(w.data(), w.data() + 80, strings.begin() + 80 * i);
+        }
+
+        std::vector<digest256> hashes(x.size());
+        midstate{}.hash256(strings.data(), 80, x.size(), hashes.data());
+        return hashes;
+    }
+
+}
@@ -2,18 +2,16 @@
 
 namespace Gigamonkey::Bitcoin::redemption {
     
+    // the parts of the script are written one after another. 
+    arena::span redeem(incomplete x, const input_index& tx, arena& a, bool dummy_signature) {
+        arena::span script{a.size(), 0};
+        for (; !x.empty(); x = x.rest()) script = arena::join(script, x.first().redeem(a, tx, dummy_signature));
+        return script;
+    }
+    
     bytes redeem(incomplete x, const input_index& tx, bool dummy_signature) {
-        list<bytes> parts{};
-        uint32 size = 0;
-        while(!x.empty()) {
-            bytes b = x.first().redeem(tx, dummy_signature);
-            size += b.size();
-            parts = parts << b;
-        }
-        bytes b(size);
-        bytes_writer w{b.begin(), b.end()};
-        write(w, parts);
-        return b;
+        arena a{expected_size(x)};
+        return bytes(a.view(redeem(x, tx, a, dummy_signature)));
     }
     
     uint32 expected_size(incomplete x) {
@@ -31,30 +29,63 @@ namespace Gigamonkey::Bitcoin::redemption {
 
 namespace Gigamonkey::Bitcoin {
     
-    vertex redeem(list<data::entry<spendable, sighash::directive>> prev, list<output> out, int32_little locktime) {
-        satoshi spent = fold([](satoshi s, data::entry<spendable, sighash::directive> v) -> satoshi {
+    arena::span redeem(arena& a, list<data::entry<spendable, sighash::directive>> prev, list<output> out, int32_little locktime) {
+        satoshi spent = fold([](satoshi s, const data::entry<spendable, sighash::directive>& v) -> satoshi {
             return s + v.Key.Prevout.Output.Value;
-        }, 0, prev);
-        satoshi redeemed = fold([](satoshi s, output o) -> satoshi {
+        }, satoshi{0}, prev);
+        satoshi redeemed = fold([](satoshi s, const output& o) -> satoshi {
             return s + o.Value;
-        }, 0, out);
-        if (spent > redeemed) return {};
-        bytes incomplete = transaction{data::for_each([](data::entry<spendable, sighash::directive> s) -> input {
-                    return input{s.Key.Prevout.Outpoint, {}, s.Key.Sequence};
-                }, prev), out, locktime}.write();
-        uint32 ind{0};
-        list<input> in;
-        list<prevout> prevouts;
-        list<data::entry<spendable, sighash::directive>> p = prev;
-        while (!p.empty()) {
-            data::entry<spendable, sighash::directive> entry = p.first();
-            in = in << input{entry.Key.Prevout.Outpoint, 
-                redemption::redeem(entry.Key.Redeemer->redeem(entry.Value), 
-                    input_index{entry.Key.Prevout.Output, incomplete, ind++}), 
-                entry.Key.Sequence};
-            prevouts = prevouts << entry.Key.Prevout;
+        }, satoshi{0}, out);
+        if (spent < redeemed) return arena::span{a.size(), 0};
+        
+        int32_little version{2};
+        uint32 inputs = prev.size();
+        
+        // The transaction with empty input scripts, which is what is signed. 
+        // Each input is an outpoint, an empty script and a sequence number. 
+        size_t inputs_size = 4 + var_int_size(inputs) + 41 * inputs;
+        size_t outputs_size = fold([](size_t size, const output& o) -> size_t {
+            return size + o.serialized_size();
+        }, var_int_size(out.size()), out) + 4; // including locktime. 
+        
+        arena::span incomplete = a.allocate(inputs_size + outputs_size);
+        bytes_writer w = write_var_int(a.writer(incomplete) << version, inputs);
+        for (auto p = prev; !p.empty(); p = p.rest()) 
+            w = w << p.first().Key.Prevout.Outpoint << byte{0} << p.first().Key.Sequence;
+        write_sequence(w, out) << locktime;
+        
+        input_index tx{output{}, bytes(a.view(incomplete)), index{0}};
+        
+        std::vector<arena::span> scripts{};
+        scripts.reserve(inputs);
+        size_t size = 4 + var_int_size(inputs) + outputs_size;
+        uint32 i = 0;
+        for (auto p = prev; !p.empty(); p = p.rest()) {
+            const data::entry<spendable, sighash::directive>& entry = p.first();
+            tx.Output = entry.Key.Prevout.Output;
+            tx.Index = index{i++};
+            arena::span script = redemption::redeem(entry.Key.Redeemer->redeem(entry.Value), tx, a);
+            size += 40 + var_int_size(script.Size) + script.Size;
+            scripts.push_back(script);
         }
-        return {prevouts, transaction{in, out, locktime}};
+        
+        arena::span complete = a.allocate(size);
+        w = write_var_int(a.writer(complete) << version, inputs);
+        i = 0;
+        for (auto p = prev; !p.empty(); p = p.rest()) 
+            w = write_data(w << p.first().Key.Prevout.Outpoint, a.view(scripts[i++])) << p.first().Key.Sequence;
+        // outputs and locktime are the same as in the incomplete transaction. 
+        w << a.view(arena::span{incomplete.Offset + inputs_size, outputs_size});
+        return complete;
+    }
+    
+    vertex redeem(list<data::entry<spendable, sighash::directive>> prev, list<output> out, int32_little locktime) {
+        arena a{};
+        arena::span x = redeem(a, prev, out, locktime);
+        if (x.Size == 0) return {};
+        return {data::for_each([](const data::entry<spendable, sighash::directive>& s) -> prevout {
+            return s.Key.Prevout;
+        }, prev), transaction::read(a.view(x))};
     }
     
     satoshi vertex::spent() const {
@@ -64,19 +95,27 @@ namespace Gigamonkey::Bitcoin {
     }
     
     bool vertex::valid() const {
-        if (!transaction().valid()) return false; 
+        if (!Transaction.valid()) return false; 
         list<prevout> p = Previous;
         while(!p.empty()) {
             if(!p.first().valid()) return false;
             p = p.rest();
         }
-        if (spent() > sent()) return false;
-        // TODO run scripts
-        return true;
+        if (spent() < sent()) return false;
+        list<output> redeemed{};
+        for (list<prevout> x = Previous; !x.empty(); x = x.rest()) redeemed = redeemed << x.first().Output;
+        return evaluation_context{Transaction.write(), redeemed}.verify();
     }
     
+    // The scripts that are run are the input scripts and 
+    // the output scripts of the transactions they redeem. 
     uint32 vertex::sigops() const {
-        throw method::unimplemented{"vertex::sigops"};
+        script_metrics m = fold([](script_metrics m, const prevout& p) -> script_metrics {
+            return m + script_metrics{p.Output.Script};
+        }, script_metrics{}, Previous);
+        return fold([](script_metrics m, const input& i) -> script_metrics {
+            return m + script_metrics{i.Script};
+        }, m, Transaction.Inputs).AccurateSigops;
     }
     
 }
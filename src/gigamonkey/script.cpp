@@ -6,24 +6,126 @@
 
 namespace Gigamonkey::Bitcoin {
     
-    // We already know that o has size at least 1 
-    // when we call this function. 
     uint32 next_instruction_size(bytes_view o) {
-        opcodetype op = opcodetype(o[0]);
-        if (op == OP_INVALIDOPCODE) return 0;
-        if (!is_push_data(opcodetype(op))) return 1;
-        if (op <= OP_PUSHSIZE75) return (op + 1);
-        if (op == OP_PUSHDATA1) {
+        if (o.size() == 0) return 0;
+        op x = op(o[0]);
+        uint64 size;
+        if (!is_push_data(x)) size = 1;
+        else if (x <= OP_PUSHSIZE75) size = x + 1;
+        else if (x == OP_PUSHDATA1) {
             if (o.size() < 2) return 0;
-            return o[1] + 2;
-        }
-        if (op == OP_PUSHDATA2) {
+            size = o[1] + 2;
+        } else if (x == OP_PUSHDATA2) {
             if (o.size() < 3) return 0;
-            return boost::endian::load_little_u16(&o[1]) + 3;
+            size = boost::endian::load_little_u16(&o[1]) + 3;
+        } else {
+            if (o.size() < 5) return 0;
+            size = uint64(boost::endian::load_little_u32(&o[1])) + 5;
+        }
+        return size > o.size() ? 0 : uint32(size);
+    }
+    
+    namespace {
+        
+        // the values pushed by OP_1NEGATE and OP_1 through OP_16, 
+        // as they are given by instruction::data. 
+        const byte SmallValues[17]{OP_1NEGATE, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+        
+        // whether a pushed value equals a given number. Numbers in
+        // scripts are little endian with a sign bit. 
+        bool equals(op o, bytes_view d, int64 v) {
+            if (o == OP_1NEGATE) return v == -1;
+            if (o >= OP_1 && o <= OP_16) return v == o - OP_1 + 1;
+            if (d.size() == 0) return v == 0;
+            bool negative = (d[d.size() - 1] & 0x80) != 0;
+            uint64 magnitude = 0;
+            for (size_t i = d.size(); i > 0; i--) {
+                byte b = i == d.size() ? d[i - 1] & 0x7f : d[i - 1];
+                if (i > 8) {
+                    if (b != 0) return false;
+                    continue;
+                }
+                magnitude = (magnitude << 8) | b;
+            }
+            if (magnitude == 0) return v == 0;
+            if (negative) return v < 0 && magnitude == uint64(0) - uint64(v);
+            return v > 0 && magnitude == uint64(v);
         }
-        // otherwise it's OP_PUSHDATA4
-        if (o.size() < 5) return 0;
-        return boost::endian::load_little_u32(&o[1]) + 5;
+    }
+    
+    instruction_view instruction_view::read(bytes_view script, uint32 offset) {
+        if (offset >= script.size()) return {};
+        bytes_view rest = script.substr(offset);
+        uint32 size = next_instruction_size(rest);
+        if (size == 0) return {};
+        op o = op(rest[0]);
+        if (!is_push_data(o)) return instruction_view{o, bytes_view{}, offset, 1};
+        uint32 header = o <= OP_PUSHSIZE75 ? 1 : o == OP_PUSHDATA1 ? 2 : o == OP_PUSHDATA2 ? 3 : 5;
+        return instruction_view{o, rest.substr(header, size - header), offset, size};
+    }
+    
+    bytes_view instruction_view::data() const {
+        if (!is_push(Op)) return {};
+        if (is_push_data(Op)) return Data;
+        if (Op == OP_1NEGATE) return bytes_view{SmallValues, 1};
+        return bytes_view{SmallValues + (Op - OP_1 + 1), 1};
+    }
+    
+    uint32 instructions::size() const {
+        uint32 count = 0;
+        for (auto i = begin(); i != end(); ++i) count++;
+        return count;
+    }
+    
+    bool instructions::valid() const {
+        uint32 offset = 0;
+        while (offset < Script.size()) {
+            uint32 size = next_instruction_size(Script.substr(offset));
+            if (size == 0) return false;
+            offset += size;
+        }
+        return true;
+    }
+    
+    script_metrics::script_metrics(bytes_view script) : script_metrics{} {
+        op last = OP_INVALIDOPCODE;
+        uint32 offset = 0;
+        for (const instruction_view& i : instructions{script}) {
+            Instructions++;
+            offset = i.Offset + i.Size;
+            if (i.Op > OP_16) PushOnly = false;
+            else if (is_push_data(i.Op) && i.Data.size() > MaxPush) MaxPush = i.Data.size();
+            switch (i.Op) {
+                case OP_RETURN: 
+                    if (Instructions == 1 || (Instructions == 2 && last == OP_FALSE)) DataCarrier = true;
+                    break;
+                case OP_CHECKSIG: 
+                case OP_CHECKSIGVERIFY: 
+                    Sigops++;
+                    AccurateSigops++;
+                    break;
+                case OP_CHECKMULTISIG: 
+                case OP_CHECKMULTISIGVERIFY: 
+                    Sigops += 20;
+                    AccurateSigops += last >= OP_1 && last <= OP_16 ? last - OP_1 + 1 : 20;
+                    break;
+                default: break;
+            }
+            last = i.Op;
+        }
+        Valid = offset == script.size();
+    }
+    
+    script_metrics script_metrics::operator+(const script_metrics& m) const {
+        script_metrics x{};
+        x.Instructions = Instructions + m.Instructions;
+        x.Sigops = Sigops + m.Sigops;
+        x.AccurateSigops = AccurateSigops + m.AccurateSigops;
+        x.MaxPush = std::max(MaxPush, m.MaxPush);
+        x.PushOnly = PushOnly && m.PushOnly;
+        x.DataCarrier = DataCarrier || m.DataCarrier;
+        x.Valid = Valid && m.Valid;
+        return x;
     }
     
     // Inefficient: extra copying. 
@@ -48,101 +150,66 @@ namespace Gigamonkey::Bitcoin {
         return instruction{x};
     }
     
-    struct script_writer {
-        bytes_writer Writer;
-        script_writer operator<<(instruction o) const {
-            return script_writer{write(Writer, o)};
-        }
-        
-        script_writer operator<<(program p) const {
-            return p.size() == 0 ? script_writer{Writer} : (script_writer{Writer} << p.first() << p.rest());
-        }
-        
-        script_writer(bytes_writer w) : Writer{w} {}
-    };
-    
-    bytes_reader read_push(bytes_reader r, instruction& rest) {
-        uint32 size;
-        if (rest.Op <= OP_PUSHSIZE75) size = rest.Op;
-        if (rest.Op == OP_PUSHDATA1) {
-            byte x;
-            r = r >> x;
-            size = x;
-        }
-        if (rest.Op == OP_PUSHDATA2) {
-            uint16_little x;
-            r = r >> x;
-            size = x;
-        }
-        if (rest.Op == OP_PUSHDATA4) {
-            uint32_little x;
-            r = r >> x;
-            size = x;
-        }
-        
-        // TODO inefficient because I copy data here for
-        // no reason other than not wanting to re-write
-        // some old types. 
-        rest.Data = bytes(size);
-        data::bytes bx(size);
-        r = r >> bx;
-        std::copy(bx.begin(), bx.end(), rest.Data.begin());
-        return r;
-    }
-    
-    struct script_reader {
-        bytes_reader Reader;
-        script_reader operator>>(instruction& i) const {
-            byte next;
-            bytes_reader r = Reader >> next;
-            i.Op = static_cast<op>(next);
-            if (is_push_data(i.Op)) return read_push(r, i);
-            return r;
+    namespace {
+        // a loop rather than a recursion, so that 
+        // long programs do not use up the stack. 
+        bytes_writer write_program(bytes_writer w, program p) {
+            for (; !p.empty(); p = p.rest()) w = p.first().write(w);
+            return w;
         }
-        
-        bool empty() const {
-            return Reader.empty();
-        }
-        
-        script_reader(bytes_reader r) : Reader{r} {}
-        script_reader(bytes_view b) : Reader{b.data(), b.data() + b.size()} {}
-    };
+    }
     
     instruction instruction::read(bytes_view b) {
-        instruction i;
-        script_reader{b} >> i;
-        return i;
+        instruction_view i = instruction_view::read(b);
+        if (!i.valid()) return instruction{};
+        return instruction(i);
     }
     
     bytes compile(program p) {
         bytes compiled(length(p));
-        script_writer{bytes_writer{compiled.begin(), compiled.end()}} << p;
+        write_program(bytes_writer{compiled.begin(), compiled.end()}, p);
         return compiled;
     }
     
+    void compile(program p, bytes& script) {
+        size_t size = script.size();
+        script.resize(size + length(p));
+        write_program(bytes_writer{script.begin() + size, script.end()}, p);
+    }
+    
+    arena::span compile(program p, arena& a) {
+        arena::span x = a.allocate(length(p));
+        write_program(a.writer(x), p);
+        return x;
+    }
+    
+    bytes_writer write_push(bytes_writer w, bytes_view x) {
+        template_part p = template_part::push(x.size());
+        w = w << static_cast<byte>(p.Op);
+        if (p.Op == OP_PUSHDATA1) w = w << static_cast<byte>(x.size());
+        else if (p.Op == OP_PUSHDATA2) w = w << static_cast<uint16_little>(x.size());
+        else if (p.Op == OP_PUSHDATA4) w = w << static_cast<uint32_little>(x.size());
+        return w << x;
+    }
+    
     bytes compile(instruction i) {
         bytes compiled(length(i));
-        script_writer{bytes_writer{compiled.begin(), compiled.end()}} << i;
+        i.write(bytes_writer{compiled.begin(), compiled.end()});
         return compiled;
     }
     
     program decompile(bytes_view b) {
+        instructions x{b};
+        if (!x.valid()) return {};
         program p{};
-        script_reader r{bytes_reader{b.data(), b.data() + b.size()}};
-        while(!r.empty()) {
-            instruction i{};
-            r = r >> i;
-            p = p << i;
-        }
+        for (const instruction_view& i : x) p = p << instruction(i);
         return p;
     }
     
     bytes_view pattern::atom::scan(bytes_view p) const {
-        if (p.size() == 0) throw fail{};
-        if (p[0] != Instruction.Op) throw fail{};
-        uint32 size = next_instruction_size(p);
-        if (p.size() < size || Instruction != instruction::read(p.substr(0, size))) throw fail{};
-        return p.substr(size);
+        instruction_view i = instruction_view::read(p);
+        if (!i.valid() || i.Op != Instruction.Op || i.Data != bytes_view{Instruction.Data}) throw fail{};
+        return p.substr(i.Size);
     }
     
     bytes_view pattern::string::scan(bytes_view p) const {
@@ -152,23 +219,22 @@ namespace Gigamonkey::Bitcoin {
     }
     
     bytes_view any::scan(bytes_view p) const {
-        if (p.size() == 0) throw fail{};
         uint32 size = next_instruction_size(p);
-        if (p.size() < size) throw fail{};
+        if (size == 0) throw fail{};
         return p.substr(size);
     }
     
-    bool push::match(const instruction& i) const {
+    bool push::match(const instruction_view& i) const {
+        if (!is_push(i.Op)) return false;
         switch (Type) {
             case any : 
-                return is_push(i.Op);
+                return true;
             case value : 
-                return is_push(i.Op) && Value == Z{data::math::number::Z_bytes<data::endian::little>{i.data()}};
+                return equals(i.Op, i.data(), Number);
             case data : 
-                return is_push(i.Op) && Data == i.data();
+                return i.data() == bytes_view{Data};
             case read : 
-                if (!is_push(i.Op)) return false;
-                Read = i.data();
+                Read = bytes(i.data());
                 return true;
             default: 
                 return false;
@@ -176,25 +242,22 @@ namespace Gigamonkey::Bitcoin {
     }
     
     bytes_view push::scan(bytes_view p) const {
-        if (p.size() == 0) throw fail{};
-        uint32 size = next_instruction_size(p);
-        if (size == 0) throw fail{};
-        if (!match(instruction::read(p.substr(0, size)))) throw fail{};
-        return p.substr(size);
+        instruction_view i = instruction_view::read(p);
+        if (!i.valid() || !match(i)) throw fail{};
+        return p.substr(i.Size);
     }
     
-    bool push_size::match(const instruction& i) const {
-        bytes Data = i.data();
+    bool push_size::match(const instruction_view& i) const {
+        bytes_view Data = i.data();
         if (Data.size() != Size) return false;
-        if (Reader) Read = Data;
+        if (Reader) Read = bytes(Data);
         return true;
     }
     
     bytes_view push_size::scan(bytes_view p) const {
-        if (p.size() == 0) throw fail{};
-        uint32 size = next_instruction_size(p);
-        if (!match(instruction::read(p.substr(0, size)))) throw fail{};
-        return p.substr(size);
+        instruction_view i = instruction_view::read(p);
+        if (!i.valid() || !match(i)) throw fail{};
+        return p.substr(i.Size);
     }
     
     bytes_view pattern::sequence::scan(bytes_view p) const {
@@ -243,6 +306,373 @@ namespace Gigamonkey::Bitcoin {
         throw fail{};
     };
     
+    struct pattern_compiler {
+        matcher& Matcher;
+        std::vector<const bytes*> Targets;
+        uint32 Depth;
+        
+        pattern_compiler(matcher& m) : Matcher{m}, Targets{}, Depth{0} {}
+        
+        uint32 next() const {
+            return Matcher.Steps.size();
+        }
+        
+        uint32 emit(matcher::code c, uint32 a = 0, uint32 b = 0) {
+            Matcher.Steps.push_back(matcher::step{c, a, b});
+            return Matcher.Steps.size() - 1;
+        }
+        
+        // set the destination of an earlier step. 
+        void to(uint32 step, uint32 destination) {
+            Matcher.Steps[step].A = destination;
+        }
+        
+        uint32 choice() {
+            Depth++;
+            if (Depth > Matcher.Depth) Matcher.Depth = Depth;
+            return emit(matcher::choice);
+        }
+        
+        uint32 commit(matcher::code c = matcher::commit) {
+            Depth--;
+            return emit(c);
+        }
+        
+        void literal(bytes_view b) {
+            uint32 at = Matcher.Literals.size();
+            Matcher.Literals.insert(Matcher.Literals.end(), b.begin(), b.end());
+            // adjacent literals can be merged. 
+            if (Matcher.Steps.size() > 0 && Matcher.Steps.back().Code == matcher::literal && 
+                Matcher.Steps.back().A + Matcher.Steps.back().B == at) Matcher.Steps.back().B += b.size();
+            else emit(matcher::literal, at, b.size());
+        }
+        
+        uint32 capture(const bytes& target) {
+            for (uint32 i = 0; i < Targets.size(); i++) if (Targets[i] == &target) return i;
+            Targets.push_back(&target);
+            Matcher.Captures = Targets.size();
+            return Targets.size() - 1;
+        }
+        
+        void push_data(bytes_view b) {
+            uint32 at = Matcher.Literals.size();
+            Matcher.Literals.insert(Matcher.Literals.end(), b.begin(), b.end());
+            emit(matcher::push_data, at, b.size());
+        }
+        
+        void push_value(int64 v) {
+            Matcher.Values.push_back(v);
+            emit(matcher::push_value, Matcher.Values.size() - 1);
+        }
+    };
+    
+    void pattern::compile(pattern_compiler& c) const {
+        if (Pattern != nullptr) Pattern->compile(c);
+    }
+    
+    void any::compile(pattern_compiler& c) const {
+        c.emit(matcher::any);
+    }
+    
+    void pattern::atom::compile(pattern_compiler& c) const {
+        c.literal(Bitcoin::compile(Instruction));
+    }
+    
+    void pattern::string::compile(pattern_compiler& c) const {
+        c.literal(Program);
+    }
+    
+    void push::compile(pattern_compiler& c) const {
+        switch (Type) {
+            case any : 
+                c.emit(matcher::push_any, matcher::none);
+                return;
+            case value : 
+                c.push_value(Number);
+                return;
+            case data : 
+                c.push_data(Data);
+                return;
+            case read : 
+                c.emit(matcher::push_any, c.capture(Read));
+                return;
+        }
+    }
+    
+    void push_size::compile(pattern_compiler& c) const {
+        c.emit(matcher::push_size, Size, Reader ? c.capture(Read) : matcher::none);
+    }
+    
+    void pattern::sequence::compile(pattern_compiler& c) const {
+        list<ptr<pattern>> patt = Patterns;
+        while (!data::empty(patt)) {
+            patt.first()->compile(c);
+            patt = patt.rest();
+        }
+    }
+    
+    void optional::compile(pattern_compiler& c) const {
+        uint32 choice = c.choice();
+        pattern::compile(c);
+        uint32 commit = c.commit();
+        c.to(choice, c.next());
+        c.to(commit, c.next());
+    }
+    
+    void repeated::compile(pattern_compiler& c) const {
+        uint32 min = Second == -1 && Directive == or_less ? 0 : First;
+        int64 max = Second != -1 ? Second : Directive == or_more ? -1 : First;
+        
+        for (uint32 i = 0; i < min; i++) pattern::compile(c);
+        
+        if (max == -1) {
+            uint32 choice = c.choice();
+            pattern::compile(c);
+            c.to(c.commit(matcher::loop), choice);
+            c.to(choice, c.next());
+            return;
+        }
+        
+        // as soon as one fails, we skip the rest. 
+        std::vector<uint32> choices{};
+        for (int64 i = min; i < max; i++) {
+            choices.push_back(c.choice());
+            pattern::compile(c);
+            c.to(c.commit(), c.next());
+        }
+        for (uint32 choice : choices) c.to(choice, c.next());
+    }
+    
+    void alternatives::compile(pattern_compiler& c) const {
+        list<ptr<pattern>> patt = Patterns;
+        if (data::empty(patt)) {
+            c.emit(matcher::fail);
+            return;
+        }
+        
+        std::vector<uint32> commits{};
+        while (patt.size() > 1) {
+            uint32 choice = c.choice();
+            patt.first()->compile(c);
+            commits.push_back(c.commit());
+            c.to(choice, c.next());
+            patt = patt.rest();
+        }
+        patt.first()->compile(c);
+        for (uint32 commit : commits) c.to(commit, c.next());
+    }
+    
+    matcher::matcher(const pattern& p) : Steps{}, Literals{}, Values{}, Captures{0}, Depth{0} {
+        pattern_compiler c{*this};
+        p.compile(c);
+        c.emit(end);
+    }
+    
+    namespace {
+        
+        // the data pushed by the instruction at the front of a script, 
+        // which must be a push and must have been checked to be complete. 
+        bytes_view pushed(bytes_view p, uint32 size) {
+            return instruction_view::read(p.substr(0, size)).data();
+        }
+        
+        struct frame {
+            uint32 Alternative;
+            uint32 Position;
+        };
+        
+        // storage that doesn't need to be allocated if it's small. 
+        template <typename X, size_t n> struct scratch {
+            X Inline[n];
+            std::vector<X> Heap;
+            X* Data;
+            
+            scratch(size_t size) : Heap{}, Data{Inline} {
+                if (size > n) {
+                    Heap.resize(size);
+                    Data = Heap.data();
+                }
+            }
+        };
+    }
+    
+    matcher::result matcher::run(bytes_view script, bytes_view* captures, uint32 pc, uint32 position) const {
+        scratch<frame, 16> frames{Depth};
+        // captures saved when a choice is made, so that they can be restored. 
+        scratch<bytes_view, 32> saved{Depth * Captures};
+        scratch<bytes_view, 8> own{captures == nullptr ? Captures : 0};
+        if (captures == nullptr) captures = own.Data;
+        for (uint32 i = 0; i < Captures; i++) captures[i] = bytes_view{};
+        
+        uint32 depth = 0;
+        bool invalid = false;
+        
+        while (true) {
+            const step& x = Steps[pc];
+            bool ok = true;
+            
+            // the instruction at the current position.
+            bytes_view rest = script.substr(position);
+            uint32 size = 0;
+            switch (x.Code) {
+                case any: 
+                case push_any: 
+                case push_value: 
+                case push_data: 
+                case push_size: 
+                    if (rest.size() == 0) {
+                        ok = false;
+                        break;
+                    }
+                    size = next_instruction_size(rest);
+                    if (size == 0 || size > rest.size()) {
+                        invalid = true;
+                        ok = false;
+                        break;
+                    }
+                    if (x.Code != any && !is_push(static_cast<op>(rest[0]))) ok = false;
+                    break;
+                default: break;
+            }
+            
+            if (ok) switch (x.Code) {
+                case end: 
+                    if (position == script.size()) return success;
+                    ok = false;
+                    break;
+                case literal: 
+                    if (rest.size() < x.B || !std::equal(Literals.begin() + x.A, Literals.begin() + x.A + x.B, rest.begin())) {
+                        ok = false;
+                        break;
+                    }
+                    position += x.B;
+                    pc++;
+                    break;
+                case any: 
+                    position += size;
+                    pc++;
+                    break;
+                case push_any: 
+                    if (x.A != none) captures[x.A] = pushed(rest, size);
+                    position += size;
+                    pc++;
+                    break;
+                case push_value: 
+                    if (!equals(static_cast<op>(rest[0]), pushed(rest, size), Values[x.A])) {
+                        ok = false;
+                        break;
+                    }
+                    position += size;
+                    pc++;
+                    break;
+                case push_data: {
+                    bytes_view d = pushed(rest, size);
+                    if (d.size() != x.B || !std::equal(d.begin(), d.end(), Literals.begin() + x.A)) {
+                        ok = false;
+                        break;
+                    }
+                    position += size;
+                    pc++;
+                    break;
+                }
+                case push_size: {
+                    bytes_view d = pushed(rest, size);
+                    if (d.size() != x.A) {
+                        ok = false;
+                        break;
+                    }
+                    if (x.B != none) captures[x.B] = d;
+                    position += size;
+                    pc++;
+                    break;
+                }
+                case choice: 
+                    frames.Data[depth] = frame{x.A, position};
+                    std::copy(captures, captures + Captures, saved.Data + depth * Captures);
+                    depth++;
+                    pc++;
+                    break;
+                case commit: 
+                    depth--;
+                    pc = x.A;
+                    break;
+                case loop: 
+                    depth--;
+                    pc = position == frames.Data[depth].Position ? frames.Data[depth].Alternative : x.A;
+                    break;
+                default: 
+                    ok = false;
+            }
+            
+            if (ok) continue;
+            if (depth == 0) return invalid ? matcher::invalid : mismatch;
+            
+            // go back to the last choice. 
+            depth--;
+            position = frames.Data[depth].Position;
+            pc = frames.Data[depth].Alternative;
+            std::copy(saved.Data + depth * Captures, saved.Data + (depth + 1) * Captures, captures);
+        }
+    }
+    
+    namespace {
+        
+        // the op codes that could push data of a given size. 
+        std::bitset<256> push_ops(uint32 size) {
+            std::bitset<256> x{};
+            if (size <= OP_PUSHSIZE75) x.set(size);
+            x.set(OP_PUSHDATA1);
+            x.set(OP_PUSHDATA2);
+            x.set(OP_PUSHDATA4);
+            if (size == 1) {
+                x.set(OP_1NEGATE);
+                for (int o = OP_1; o <= OP_16; o++) x.set(o);
+            }
+            return x;
+        }
+    }
+    
+    std::bitset<256> matcher::starts(uint32 pc) const {
+        const step& x = Steps[pc];
+        std::bitset<256> all{};
+        switch (x.Code) {
+            case literal: 
+                if (x.B == 0) return starts(pc + 1);
+                all.set(Literals[x.A]);
+                return all;
+            case push_any: 
+            case push_value: 
+                for (int o = 0; o <= OP_16; o++) if (is_push(static_cast<op>(o))) all.set(o);
+                return all;
+            case push_data: 
+                return push_ops(x.B);
+            case push_size: 
+                return push_ops(x.A);
+            case choice: 
+                return starts(pc + 1) | starts(x.A);
+            case commit: 
+                return starts(x.A);
+            case end: 
+            case fail: 
+                return all;
+            default: 
+                // any, or a loop that matched nothing. 
+                return all.set();
+        }
+    }
+    
+    const matcher& pay_to_pubkey::compiled() {
+        static bytes Pubkey{};
+        static const matcher Matcher{pattern(Pubkey)};
+        return Matcher;
+    }
+    
+    const matcher& pay_to_address::compiled() {
+        static bytes Address{};
+        static const matcher Matcher{pattern(Address)};
+        return Matcher;
+    }
+    
 }
 
 std::ostream& write_op_code(std::ostream& o, Gigamonkey::Bitcoin::op x) {
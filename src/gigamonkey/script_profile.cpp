@@ -0,0 +1,77 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/script_profile.hpp>
+#include <sstream>
+
+namespace Gigamonkey::Bitcoin {
+
+    script_profile::op_class script_profile::classify(op o) {
+        if (is_push(o)) return push;
+        if (o == OP_NOP || o == OP_VER || (o >= OP_IF && o <= OP_RETURN) || (o >= OP_NOP1 && o <= OP_NOP10)) return flow;
+        if (o >= OP_TOALTSTACK && o <= OP_TUCK) return stack;
+        if (o >= OP_CAT && o <= OP_SIZE) return splice;
+        if ((o >= OP_INVERT && o <= OP_EQUALVERIFY) || o == OP_LSHIFT || o == OP_RSHIFT) return bitwise;
+        if (o >= OP_1ADD && o <= OP_WITHIN) return arithmetic;
+        if (o >= OP_RIPEMD160 && o <= OP_CODESEPARATOR) return crypto;
+        if (o >= OP_CHECKSIG && o <= OP_CHECKMULTISIGVERIFY) return signature;
+        return other;
+    }
+
+    const char* script_profile::name(op_class c) {
+        switch (c) {
+            case push: return "push";
+            case flow: return "flow";
+            case stack: return "stack";
+            case splice: return "splice";
+            case bitwise: return "bitwise";
+            case arithmetic: return "arithmetic";
+            case crypto: return "crypto";
+            case signature: return "signature";
+            default: return "other";
+        }
+    }
+
+    uint64 script_profile::instructions() const {
+        uint64 total = 0;
+        for (uint64 n : Executed) total += n;
+        return total;
+    }
+
+    uint64 script_profile::executed(op_class c) const {
+        uint64 total = 0;
+        for (uint32 o = 0; o < 256; o++) if (classify(op(o)) == c) total += Executed[o];
+        return total;
+    }
+
+    void to_json(json& j, const script_profile& p) {
+        json ops = json::object();
+        for (uint32 o = 0; o < 256; o++) if (p.Executed[o] != 0) {
+            std::stringstream name;
+            write_op_code(name, op(o));
+            // not every op code has a name. 
+            if (name.str()[0] == '*') {
+                name = std::stringstream{};
+                name << "op_" << o;
+            }
+            ops[name.str()] = p.Executed[o];
+        }
+
+        json classes = json::object();
+        for (uint32 c = 0; c < script_profile::Classes; c++) {
+            script_profile::op_class x = script_profile::op_class(c);
+            classes[script_profile::name(x)] = json{
+                {"executed", p.executed(x)},
+                {"nanoseconds", p.Time[c].count()}};
+        }
+
+        j = json{
+            {"evaluations", p.Evaluations},
+            {"instructions", p.instructions()},
+            {"bytes_pushed", p.BytesPushed},
+            {"max_stack", p.MaxStack},
+            {"ops", ops},
+            {"classes", classes}};
+    }
+
+}
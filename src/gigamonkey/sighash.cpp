@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/signature.hpp>
+
+namespace Gigamonkey::Bitcoin {
+
+    sighash_cache::sighash_cache(bytes_view tx) :
+        Version{}, Inputs{}, Outputs{}, Offsets{}, Locktime{}, Prevouts{}, Sequences{}, AllOutputs{} {
+        cross<bytes_view> inputs = Gigamonkey::transaction::inputs(tx);
+        cross<bytes_view> outputs = Gigamonkey::transaction::outputs(tx);
+        if (inputs.size() == 0 || outputs.size() == 0) return;
+
+        bytes_reader{tx.data(), tx.data() + 4} >> Version;
+        bytes_reader{tx.data() + tx.size() - 4, tx.data() + tx.size()} >> Locktime;
+
+        size_t n = inputs.size();
+        Inputs = bytes(40 * n);
+        bytes prevouts(36 * n);
+        bytes sequences(4 * n);
+        for (size_t i = 0; i < n; i++) {
+            const bytes_view& in = inputs[i];
+            std::copy(in.begin(), in.begin() + 36, Inputs.begin() + 40 * i);
+            std::copy(in.end() - 4, in.end(), Inputs.begin() + 40 * i + 36);
+            std::copy(in.begin(), in.begin() + 36, prevouts.begin() + 36 * i);
+            std::copy(in.end() - 4, in.end(), sequences.begin() + 4 * i);
+        }
+
+        // the outputs are next to each other in the transaction.
+        const byte* first = outputs[0].data();
+        const bytes_view& last = outputs[outputs.size() - 1];
+        Outputs = bytes(bytes_view{first, static_cast<size_t>(last.data() + last.size() - first)});
+        for (size_t i = 0; i < outputs.size(); i++) Offsets.push_back(outputs[i].data() - first);
+        Offsets.push_back(Outputs.size());
+
+        Prevouts = hash256(prevouts);
+        Sequences = hash256(sequences);
+        AllOutputs = hash256(Outputs);
+    }
+
+    digest256 sighash_cache::hash(index i, const output& prev, sighash::directive d) const {
+        size_t n = Inputs.size() / 40;
+        if (!valid() || !sighash::has_fork_id(d) || uint32(i) >= n) return {};
+
+        sighash::type base = sighash::base(d);
+        bool anyone_can_pay = sighash::is_anyone_can_pay(d);
+        bool single = base == sighash::single;
+        bool none = base == sighash::none;
+
+        digest256 outputs = !single && !none ? AllOutputs :
+            single && uint32(i) + 1 < Offsets.size() ?
+                hash256(bytes_view{Outputs.data() + Offsets[i], Offsets[i + 1] - Offsets[i]}) : digest256{};
+
+        const byte* input = Inputs.data() + 40 * uint32(i);
+        bytes preimage(4 + 32 + 32 + 36 + var_int_size(prev.Script.size()) + prev.Script.size() + 8 + 4 + 32 + 4 + 4);
+        bytes_writer w{preimage.begin(), preimage.end()};
+        w = w << Version << (anyone_can_pay ? digest256{} : Prevouts) <<
+            (anyone_can_pay || single || none ? digest256{} : Sequences) << bytes_view{input, 36};
+        write_data(w, prev.Script) << prev.Value << bytes_view{input + 36, 4} << outputs << Locktime << uint32_little{d};
+        return hash256(preimage);
+    }
+
+}
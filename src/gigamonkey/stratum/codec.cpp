@@ -0,0 +1,628 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/codec.hpp>
+#include "hex.hpp"
+#include <algorithm>
+#include <limits>
+
+namespace Gigamonkey::Stratum::codec {
+
+    namespace {
+
+        constexpr std::string_view NotifyPrefix{"{\"id\":null,\"method\":\"mining.notify\",\"params\":["};
+        constexpr std::string_view SubmitMethod{",\"method\":\"mining.submit\",\"params\":["};
+
+        bool read_hex(std::string_view s, byte* b, size_t size) {
+            if (s.size() != 2 * size) return false;
+            for (size_t i = 0; i < size; i++) {
+                int high = hex::digit(s[2 * i]);
+                int low = hex::digit(s[2 * i + 1]);
+                if (high < 0 || low < 0) return false;
+                b[i] = static_cast<byte>(high * 16 + low);
+            }
+            return true;
+        }
+
+        char* write(char* o, std::string_view x) {
+            return std::copy(x.begin(), x.end(), o);
+        }
+
+        // hex strings are written with quotes.
+        char* write_hex(char* o, bytes_view b) {
+            *o++ = '"';
+            o = hex::write(o, b);
+            *o++ = '"';
+            return o;
+        }
+
+        char* write_uint32(char* o, uint32 x) {
+            *o++ = '"';
+            o = hex::write_uint32(o, x);
+            *o++ = '"';
+            return o;
+        }
+
+        char* write_previous(char* o, const uint256& d) {
+            *o++ = '"';
+            o = hex::write_previous(o, d);
+            *o++ = '"';
+            return o;
+        }
+
+        size_t number_size(uint64 x) {
+            size_t n = 1;
+            while (x >= 10) {
+                x /= 10;
+                n++;
+            }
+            return n;
+        }
+
+        char* write_number(char* o, uint64 x) {
+            size_t n = number_size(x);
+            for (size_t i = n; i > 0; i--) {
+                o[i - 1] = static_cast<char>('0' + x % 10);
+                x /= 10;
+            }
+            return o + n;
+        }
+
+        // strings are escaped the same way as by nlohmann::json.
+        size_t escaped_size(char c) {
+            switch (c) {
+                case '"' :
+                case '\\' :
+                case '\b' :
+                case '\f' :
+                case '\n' :
+                case '\r' :
+                case '\t' :
+                    return 2;
+                default :
+                    return static_cast<unsigned char>(c) < 0x20 ? 6 : 1;
+            }
+        }
+
+        size_t string_size(std::string_view x) {
+            size_t n = 2;
+            for (char c : x) n += escaped_size(c);
+            return n;
+        }
+
+        char* write_string(char* o, std::string_view x) {
+            *o++ = '"';
+            for (char c : x) switch (c) {
+                case '"' :
+                    o = write(o, "\\\"");
+                    break;
+                case '\\' :
+                    o = write(o, "\\\\");
+                    break;
+                case '\b' :
+                    o = write(o, "\\b");
+                    break;
+                case '\f' :
+                    o = write(o, "\\f");
+                    break;
+                case '\n' :
+                    o = write(o, "\\n");
+                    break;
+                case '\r' :
+                    o = write(o, "\\r");
+                    break;
+                case '\t' :
+                    o = write(o, "\\t");
+                    break;
+                default :
+                    if (static_cast<unsigned char>(c) >= 0x20) *o++ = c;
+                    else {
+                        o = write(o, "\\u00");
+                        *o++ = hex::Digits[c >> 4];
+                        *o++ = hex::Digits[c & 0x0f];
+                    }
+            }
+            *o++ = '"';
+            return o;
+        }
+
+        // error messages are looked up once so that they can be written without allocating.
+        const std::string& error_message(error_code c) {
+            static const std::string Messages[] = {
+                error_message_from_code(unknown),
+                error_message_from_code(job_not_found),
+                error_message_from_code(duplicate_share),
+                error_message_from_code(low_difficulty_share),
+                error_message_from_code(unauthorized_worker),
+                error_message_from_code(not_subscribed)};
+            static const std::string Unknown{};
+            if (c < unknown || c > not_subscribed) return Unknown;
+            return Messages[c - unknown];
+        }
+
+        struct reader {
+            const char* At;
+            const char* End;
+
+            explicit reader(std::string_view x) : At{x.data()}, End{x.data() + x.size()} {}
+
+            void space() {
+                while (At != End && (*At == ' ' || *At == '\t' || *At == '\n' || *At == '\r')) At++;
+            }
+
+            bool peek(char c) {
+                space();
+                return At != End && *At == c;
+            }
+
+            bool next(char c) {
+                if (!peek(c)) return false;
+                At++;
+                return true;
+            }
+
+            bool literal(std::string_view x) {
+                space();
+                if (static_cast<size_t>(End - At) < x.size() || std::string_view{At, x.size()} != x) return false;
+                At += x.size();
+                return true;
+            }
+
+            bool end() {
+                space();
+                return At == End;
+            }
+
+            // A string without escapes, which is what keys, methods and hex strings are.
+            bool raw(std::string_view& x) {
+                if (!next('"')) return false;
+                const char* begin = At;
+                while (At != End && *At != '"') {
+                    if (*At == '\\' || static_cast<unsigned char>(*At) < 0x20) return false;
+                    At++;
+                }
+                if (At == End) return false;
+                x = std::string_view{begin, static_cast<size_t>(At - begin)};
+                At++;
+                return true;
+            }
+
+            bool code_unit(uint32& u) {
+                if (End - At < 4) return false;
+                u = 0;
+                for (int i = 0; i < 4; i++) {
+                    int d = hex::digit(At[i]);
+                    if (d < 0) return false;
+                    u = 16 * u + d;
+                }
+                At += 4;
+                return true;
+            }
+
+            static void write_utf8(std::string& x, uint32 u) {
+                if (u < 0x80) x.push_back(static_cast<char>(u));
+                else if (u < 0x800) {
+                    x.push_back(static_cast<char>(0xc0 | (u >> 6)));
+                    x.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+                } else if (u < 0x10000) {
+                    x.push_back(static_cast<char>(0xe0 | (u >> 12)));
+                    x.push_back(static_cast<char>(0x80 | ((u >> 6) & 0x3f)));
+                    x.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+                } else {
+                    x.push_back(static_cast<char>(0xf0 | (u >> 18)));
+                    x.push_back(static_cast<char>(0x80 | ((u >> 12) & 0x3f)));
+                    x.push_back(static_cast<char>(0x80 | ((u >> 6) & 0x3f)));
+                    x.push_back(static_cast<char>(0x80 | (u & 0x3f)));
+                }
+            }
+
+            // A string that may contain escapes.
+            bool string(std::string& x) {
+                if (!next('"')) return false;
+                x.clear();
+                while (true) {
+                    const char* begin = At;
+                    while (At != End && *At != '"' && *At != '\\' && static_cast<unsigned char>(*At) >= 0x20) At++;
+                    x.append(begin, At - begin);
+                    if (At == End || static_cast<unsigned char>(*At) < 0x20) return false;
+                    if (*At++ == '"') return true;
+
+                    if (At == End) return false;
+                    switch (*At++) {
+                        case '"' :
+                            x.push_back('"');
+                            break;
+                        case '\\' :
+                            x.push_back('\\');
+                            break;
+                        case '/' :
+                            x.push_back('/');
+                            break;
+                        case 'b' :
+                            x.push_back('\b');
+                            break;
+                        case 'f' :
+                            x.push_back('\f');
+                            break;
+                        case 'n' :
+                            x.push_back('\n');
+                            break;
+                        case 'r' :
+                            x.push_back('\r');
+                            break;
+                        case 't' :
+                            x.push_back('\t');
+                            break;
+                        case 'u' : {
+                            uint32 u;
+                            if (!code_unit(u) || (u >= 0xdc00 && u < 0xe000)) return false;
+                            // a surrogate pair.
+                            if (u >= 0xd800 && u < 0xdc00) {
+                                uint32 low;
+                                if (End - At < 2 || At[0] != '\\' || At[1] != 'u') return false;
+                                At += 2;
+                                if (!code_unit(low) || low < 0xdc00 || low >= 0xe000) return false;
+                                u = 0x10000 + ((u - 0xd800) << 10) + (low - 0xdc00);
+                            }
+                            write_utf8(x, u);
+                            break;
+                        }
+                        default :
+                            return false;
+                    }
+                }
+            }
+
+            bool skip_string() {
+                if (!next('"')) return false;
+                while (At != End && *At != '"') {
+                    if (*At == '\\' && ++At == End) return false;
+                    At++;
+                }
+                if (At == End) return false;
+                At++;
+                return true;
+            }
+
+            bool number(uint64& x) {
+                space();
+                if (At == End || *At < '0' || *At > '9') return false;
+                // json does not allow leading zeros.
+                if (*At == '0' && At + 1 != End && At[1] >= '0' && At[1] <= '9') return false;
+                x = 0;
+                while (At != End && *At >= '0' && *At <= '9') {
+                    uint64 d = *At - '0';
+                    if (x > (std::numeric_limits<uint64>::max() - d) / 10) return false;
+                    x = 10 * x + d;
+                    At++;
+                }
+                // not an unsigned integer if there is a fraction or exponent.
+                return At == End || (*At != '.' && *At != 'e' && *At != 'E');
+            }
+
+            bool boolean(bool& x) {
+                if (literal("true")) x = true;
+                else if (literal("false")) x = false;
+                else return false;
+                return true;
+            }
+
+            // skip any value.
+            bool skip(int depth = 0) {
+                space();
+                if (At == End || depth > 32) return false;
+                switch (*At) {
+                    case '"' :
+                        return skip_string();
+                    case '{' : {
+                        At++;
+                        if (next('}')) return true;
+                        do if (!skip_string() || !next(':') || !skip(depth + 1)) return false;
+                        while (next(','));
+                        return next('}');
+                    }
+                    case '[' : {
+                        At++;
+                        if (next(']')) return true;
+                        do if (!skip(depth + 1)) return false;
+                        while (next(','));
+                        return next(']');
+                    }
+                    case 't' :
+                        return literal("true");
+                    case 'f' :
+                        return literal("false");
+                    case 'n' :
+                        return literal("null");
+                    default : {
+                        const char* begin = At;
+                        while (At != End && ((*At >= '0' && *At <= '9') ||
+                            *At == '-' || *At == '+' || *At == '.' || *At == 'e' || *At == 'E')) At++;
+                        return At != begin;
+                    }
+                }
+            }
+
+            // Read an object and call f with the reader just after
+            // each key. f reads the value and returns false on failure.
+            template <typename F> bool object(F f) {
+                if (!next('{')) return false;
+                if (next('}')) return true;
+                do {
+                    std::string_view key;
+                    if (!raw(key) || !next(':') || !f(key)) return false;
+                } while (next(','));
+                return next('}');
+            }
+
+            bool hex(byte* b, size_t size) {
+                std::string_view x;
+                return raw(x) && read_hex(x, b, size);
+            }
+
+            bool hex(bytes& b) {
+                std::string_view x;
+                if (!raw(x) || x.size() % 2 != 0) return false;
+                b = bytes(x.size() / 2);
+                return read_hex(x, b.data(), b.size());
+            }
+
+            bool uint32_big(uint32& x) {
+                byte b[4];
+                if (!hex(b, 4)) return false;
+                x = (uint32(b[0]) << 24) | (uint32(b[1]) << 16) | (uint32(b[2]) << 8) | uint32(b[3]);
+                return true;
+            }
+
+            // Job ids are usually strings, but some pools use numbers.
+            bool job(job_id& x) {
+                if (peek('"')) return uint32_big(x);
+                uint64 n;
+                if (!number(n) || n > std::numeric_limits<uint32>::max()) return false;
+                x = static_cast<job_id>(n);
+                return true;
+            }
+
+            bool previous(uint256& d) {
+                byte b[32];
+                if (!hex(b, 32)) return false;
+                for (int i = 0; i < 32; i++) d.data()[(i & ~3) + 3 - (i & 3)] = b[i];
+                return true;
+            }
+        };
+
+    }
+
+    size_t size(const notify& n) {
+        if (!n.valid()) return 0;
+        size_t paths = n.Path.size();
+        return NotifyPrefix.size() + 11 + 67 +
+            2 * n.GenerationTx1.size() + 3 + 2 * n.GenerationTx2.size() + 3 +
+            3 + 66 * paths + (paths > 0 ? paths - 1 : 0) +
+            33 + (n.Clean ? 4 : 5) + 3;
+    }
+
+    size_t size(const share& x) {
+        if (!x.valid()) return 0;
+        return 6 + number_size(x.ID) + SubmitMethod.size() + string_size(x.Name) + 1 + 11 + 19 + 11 + 10 + 3;
+    }
+
+    size_t size(const response& r) {
+        if (!r.Result.is_boolean() && !r.Result.is_null()) return 0;
+        return 9 + (r.ErrorCode == none ? 4 :
+                3 + number_size(uint32(r.ErrorCode)) + string_size(error_message(r.ErrorCode))) +
+            6 + number_size(r.ID) + 10 + (r.Result.is_boolean() && !r.Result.get<bool>() ? 5 : 4) + 2;
+    }
+
+    char* write(char* o, const notify& n) {
+        if (!n.valid()) return o;
+        o = write(o, NotifyPrefix);
+        o = write_uint32(o, n.ID);
+        *o++ = ',';
+        o = write_previous(o, n.Digest);
+        *o++ = ',';
+        o = write_hex(o, n.GenerationTx1);
+        *o++ = ',';
+        o = write_hex(o, n.GenerationTx2);
+        *o++ = ',';
+        *o++ = '[';
+        for (list<digest256> p = n.Path; !p.empty(); p = p.rest()) {
+            o = write_hex(o, p.first());
+            if (p.size() > 1) *o++ = ',';
+        }
+        *o++ = ']';
+        *o++ = ',';
+        o = write_uint32(o, uint32(int32(n.Version)));
+        *o++ = ',';
+        o = write_uint32(o, uint32(static_cast<uint32_little>(n.Target)));
+        *o++ = ',';
+        o = write_uint32(o, uint32(n.Now.Value));
+        *o++ = ',';
+        o = write(o, n.Clean ? "true" : "false");
+        return write(o, "]}\n");
+    }
+
+    char* write(char* o, const share& x) {
+        if (!x.valid()) return o;
+        o = write_number(write(o, "{\"id\":"), x.ID);
+        o = write_string(write(o, SubmitMethod), x.Name);
+        *o++ = ',';
+        o = write_uint32(o, x.JobID);
+        *o++ = ',';
+        o = write_hex(o, bytes_view{x.ExtraNonce2.data(), 8});
+        *o++ = ',';
+        o = write_uint32(o, uint32(x.nTime.Value));
+        *o++ = ',';
+        o = write_uint32(o, uint32(x.nOnce));
+        return write(o, "]}\n");
+    }
+
+    char* write(char* o, const response& r) {
+        if (!r.Result.is_boolean() && !r.Result.is_null()) return o;
+        o = write(o, "{\"error\":");
+        if (r.ErrorCode == none) o = write(o, "null");
+        else {
+            *o++ = '[';
+            o = write_number(o, uint32(r.ErrorCode));
+            *o++ = ',';
+            o = write_string(o, error_message(r.ErrorCode));
+            *o++ = ']';
+        }
+        o = write_number(write(o, ",\"id\":"), r.ID);
+        o = write(o, ",\"result\":");
+        o = write(o, r.Result.is_null() ? "null" : r.Result.get<bool>() ? "true" : "false");
+        return write(o, "}\n");
+    }
+
+    std::string write(const notify& n) {
+        std::string x(size(n), '\0');
+        write(x.data(), n);
+        return x;
+    }
+
+    std::string write(const share& s) {
+        std::string x(size(s), '\0');
+        write(x.data(), s);
+        return x;
+    }
+
+    std::string write(const response& r) {
+        std::string x(size(r), '\0');
+        write(x.data(), r);
+        return x;
+    }
+
+    size_t generation_tx1_end(const notify& n) {
+        return NotifyPrefix.size() + 11 + 67 + 1 + 2 * n.GenerationTx1.size();
+    }
+
+    bool read(std::string_view line, notify& n) {
+        reader r{line};
+        bool id = false;
+        bool method = false;
+        bool params = false;
+
+        job_id job;
+        uint256 previous;
+        bytes coinbase_1;
+        bytes coinbase_2;
+        list<digest256> path{};
+        uint32 version;
+        uint32 target;
+        uint32 now;
+        bool clean;
+
+        auto read_params = [&]() -> bool {
+            if (!r.next('[') || !r.job(job) || !r.next(',') ||
+                !r.previous(previous) || !r.next(',') ||
+                !r.hex(coinbase_1) || !r.next(',') ||
+                !r.hex(coinbase_2) || !r.next(',') || !r.next('[')) return false;
+
+            if (!r.next(']')) {
+                do {
+                    digest256 d;
+                    if (!r.hex(d.Value.data(), 32)) return false;
+                    path = path << d;
+                } while (r.next(','));
+                if (!r.next(']')) return false;
+            }
+
+            return r.next(',') && r.uint32_big(version) && r.next(',') &&
+                r.uint32_big(target) && r.next(',') && r.uint32_big(now) && r.next(',') &&
+                r.boolean(clean) && r.next(']');
+        };
+
+        if (!r.object([&](std::string_view key) -> bool {
+            if (key == "id") return id = r.literal("null");
+            if (key == "method") {
+                std::string_view m;
+                return method = r.raw(m) && m == "mining.notify";
+            }
+            if (key == "params") return params = read_params();
+            return r.skip();
+        }) || !r.end() || !id || !method || !params) {
+            n = {};
+            return false;
+        }
+
+        n = notify{job, previous, coinbase_1, coinbase_2, path, int32_little{int32(version)},
+            work::target{target}, timestamp{uint32_little{now}}, clean};
+        return n.valid();
+    }
+
+    bool read(std::string_view line, share& x) {
+        reader r{line};
+        bool id = false;
+        bool method = false;
+        bool params = false;
+        uint32 time;
+        uint32 nonce;
+
+        // the name is read into x so that its buffer can be reused.
+        auto read_params = [&]() -> bool {
+            if (!r.next('[') || !r.string(x.Name) || !r.next(',') ||
+                !r.job(x.JobID) || !r.next(',') ||
+                !r.hex(x.ExtraNonce2.data(), 8) || !r.next(',') ||
+                !r.uint32_big(time) || !r.next(',') || !r.uint32_big(nonce)) return false;
+            // later parameters, such as version bits, are ignored.
+            while (r.next(',')) if (!r.skip()) return false;
+            return r.next(']');
+        };
+
+        if (!r.object([&](std::string_view key) -> bool {
+            if (key == "id") return id = r.number(x.ID);
+            if (key == "method") {
+                std::string_view m;
+                return method = r.raw(m) && m == "mining.submit";
+            }
+            if (key == "params") return params = read_params();
+            return r.skip();
+        }) || !r.end() || !id || !method || !params || !x.valid()) {
+            x = {};
+            return false;
+        }
+
+        x.nTime = timestamp{uint32_little{time}};
+        x.nOnce = Gigamonkey::nonce{nonce};
+        return true;
+    }
+
+    bool read(std::string_view line, response& p) {
+        reader r{line};
+        bool has_id = false;
+        bool has_result = false;
+        bool has_error = false;
+
+        request_id id;
+        json result{};
+        uint64 code = none;
+
+        auto read_error = [&]() -> bool {
+            if (r.literal("null")) return true;
+            if (!r.next('[') || !r.number(code) || code == none || code > std::numeric_limits<uint32>::max()) return false;
+            // the message is determined by the code.
+            while (r.next(',')) if (!r.skip()) return false;
+            return r.next(']');
+        };
+
+        if (!r.object([&](std::string_view key) -> bool {
+            if (key == "id") return has_id = r.number(id);
+            if (key == "result") {
+                bool b;
+                if (r.literal("null")) result = nullptr;
+                else if (r.boolean(b)) result = b;
+                else return false;
+                return has_result = true;
+            }
+            if (key == "error") return has_error = read_error();
+            return r.skip();
+        }) || !r.end() || !has_id || !has_result || !has_error) {
+            p = {};
+            return false;
+        }
+
+        p = code == none ? response{id, result} : response{id, result, static_cast<error_code>(code)};
+        return true;
+    }
+
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_STRATUM_HEX
+#define GIGAMONKEY_STRATUM_HEX
+
+#include <gigamonkey/hash.hpp>
+#include <string>
+
+// Hex strings as they appear in Stratum messages, for
+// stratum.cpp, codec.cpp and notify_cache.cpp.
+namespace Gigamonkey::Stratum::hex {
+
+    constexpr char Digits[] = "0123456789abcdef";
+
+    inline int digit(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    // without quotes.
+    inline char* write(char* o, bytes_view b) {
+        for (byte x : b) {
+            *o++ = Digits[x >> 4];
+            *o++ = Digits[x & 0x0f];
+        }
+        return o;
+    }
+
+    // Numbers such as times and targets are written big-endian.
+    inline char* write_uint32(char* o, uint32 x) {
+        byte b[4]{byte(x >> 24), byte(x >> 16), byte(x >> 8), byte(x)};
+        return write(o, bytes_view{b, 4});
+    }
+
+    // The previous hash is written with the bytes of each 4-byte word reversed.
+    inline char* write_previous(char* o, const uint256& d) {
+        byte b[32];
+        for (int i = 0; i < 32; i++) b[i] = d.data()[(i & ~3) + 3 - (i & 3)];
+        return write(o, bytes_view{b, 32});
+    }
+
+    inline std::string write(bytes_view b) {
+        std::string s(2 * b.size(), '0');
+        write(s.data(), b);
+        return s;
+    }
+
+    inline std::string write_uint32(uint32 x) {
+        std::string s(8, '0');
+        write_uint32(s.data(), x);
+        return s;
+    }
+
+    inline std::string write_previous(const uint256& d) {
+        std::string s(64, '0');
+        write_previous(s.data(), d);
+        return s;
+    }
+
+}
+
+#endif
@@ -0,0 +1,24 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/notify_cache.hpp>
+#include <gigamonkey/stratum/codec.hpp>
+#include "hex.hpp"
+
+namespace Gigamonkey::Stratum {
+
+    notify_cache::fragment notify_cache::write_fragment(uint32_little n) {
+        fragment f;
+        hex::write(f.data(), bytes_view{n.data(), 4});
+        return f;
+    }
+
+    notify_cache::notify_cache(const notify& n) : notify_cache{} {
+        if (!n.valid()) return;
+        Line = std::make_shared<const std::string>(codec::write(n));
+        size_t end = codec::generation_tx1_end(n);
+        Head = std::make_shared<const std::string>(Line->substr(0, end));
+        Tail = std::make_shared<const std::string>(Line->substr(end));
+    }
+
+}
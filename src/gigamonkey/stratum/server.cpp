@@ -0,0 +1,441 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/server.hpp>
+#include <gigamonkey/stratum/codec.hpp>
+#include <gigamonkey/stratum/notify_cache.hpp>
+#include <algorithm>
+#include <cerrno>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// before Linux 4.5 every thread wakes for a new connection.
+#ifndef EPOLLEXCLUSIVE
+#define EPOLLEXCLUSIVE 0
+#endif
+
+namespace Gigamonkey::Stratum {
+
+    namespace {
+
+        // a line longer than this is not a Stratum message.
+        constexpr size_t MaxLineSize = 16384;
+
+        // a miner that lets this many pieces of messages pile up is disconnected.
+        constexpr size_t MaxQueueSize = 1024;
+
+        // the most pieces that are written at once.
+        constexpr size_t MaxWrite = 64;
+
+        using message = std::shared_ptr<const std::string>;
+
+        message serialize(const json& j) {
+            return std::make_shared<const std::string>(j.dump() + "\n");
+        }
+
+        // Part of a message that has not been sent yet. If there is no
+        // buffer, the data belongs to the connection.
+        struct piece {
+            message Buffer;
+            const char* Data;
+            size_t Size;
+
+            explicit piece(const message& m) : Buffer{m}, Data{m->data()}, Size{m->size()} {}
+            piece(const char* d, size_t z) : Buffer{}, Data{d}, Size{z} {}
+        };
+
+        struct connection {
+            int Socket;
+            connection_id ID;
+            std::string In;
+            std::deque<piece> Out;
+            bool Writable;  // whether we are waiting for the socket to be writable.
+            bool Closed;
+            bool Subscribed;
+            bool Authorized;
+
+            // what goes in a personalized notify.
+            notify_cache::fragment ExtraNonce1;
+
+            connection(int s, connection_id id) : Socket{s}, ID{id}, In{}, Out{},
+                Writable{false}, Closed{false}, Subscribed{false}, Authorized{false}, ExtraNonce1{} {}
+        };
+
+    }
+
+    struct server::worker {
+        server& Server;
+        int Epoll;
+        int Wake;
+
+        std::mutex Mutex;
+        std::vector<std::shared_ptr<const notify_cache>> Broadcasts; // to go to every subscribed connection.
+
+        // only touched by the thread of this worker.
+        std::unordered_map<int, std::unique_ptr<connection>> Connections;
+
+        // reused for every share that is read.
+        share Share;
+
+        explicit worker(server&);
+        ~worker();
+
+        bool valid() const {
+            return Epoll >= 0 && Wake >= 0;
+        }
+
+        void run();
+        void wake();
+
+        void accept();
+        void broadcast();
+        void read(connection&);
+        void handle(connection&, std::string line);
+        void submit(connection&, const share&);
+        void respond(connection&, const response&);
+        void send(connection&, message);
+        void flush(connection&);
+        void watch(connection&, bool writable);
+        void close(connection&);
+    };
+
+    server::worker::worker(server& s) : Server{s},
+        Epoll{epoll_create1(EPOLL_CLOEXEC)}, Wake{eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)},
+        Mutex{}, Broadcasts{}, Connections{}, Share{} {
+        if (!valid()) return;
+
+        epoll_event e{};
+        e.events = EPOLLIN;
+        e.data.fd = Wake;
+        epoll_ctl(Epoll, EPOLL_CTL_ADD, Wake, &e);
+
+        e.events = EPOLLIN | EPOLLEXCLUSIVE;
+        e.data.fd = Server.Listener;
+        epoll_ctl(Epoll, EPOLL_CTL_ADD, Server.Listener, &e);
+    }
+
+    server::worker::~worker() {
+        while (!Connections.empty()) close(*Connections.begin()->second);
+        if (Epoll >= 0) ::close(Epoll);
+        if (Wake >= 0) ::close(Wake);
+    }
+
+    void server::worker::run() {
+        epoll_event events[256];
+        while (!Server.Stop) {
+            int n = epoll_wait(Epoll, events, 256, -1);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                return;
+            }
+
+            for (int i = 0; i < n; i++) {
+                int fd = events[i].data.fd;
+                if (fd == Server.Listener) accept();
+                else if (fd == Wake) broadcast();
+                else {
+                    auto x = Connections.find(fd);
+                    if (x == Connections.end()) continue;
+                    connection& c = *x->second;
+                    if (events[i].events & (EPOLLERR | EPOLLHUP)) c.Closed = true;
+                    if (!c.Closed && (events[i].events & EPOLLIN)) read(c);
+                    if (!c.Closed && (events[i].events & EPOLLOUT)) flush(c);
+                    if (c.Closed) close(c);
+                }
+            }
+        }
+    }
+
+    void server::worker::wake() {
+        uint64 one = 1;
+        ssize_t written = ::write(Wake, &one, sizeof(one));
+        (void)written;
+    }
+
+    void server::worker::accept() {
+        while (true) {
+            int s = accept4(Server.Listener, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            // another thread may have taken the connection.
+            if (s < 0) return;
+
+            int one = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+            epoll_event e{};
+            e.events = EPOLLIN;
+            e.data.fd = s;
+            if (epoll_ctl(Epoll, EPOLL_CTL_ADD, s, &e) < 0) {
+                ::close(s);
+                continue;
+            }
+
+            Connections.emplace(s, std::make_unique<connection>(s, Server.Next++));
+            Server.Connections++;
+        }
+    }
+
+    void server::worker::broadcast() {
+        uint64 count;
+        ssize_t r = ::read(Wake, &count, sizeof(count));
+        (void)r;
+
+        std::vector<std::shared_ptr<const notify_cache>> notifies{};
+        {
+            std::lock_guard<std::mutex> lock(Mutex);
+            notifies.swap(Broadcasts);
+        }
+        if (notifies.empty()) return;
+
+        // Every connection gets the same buffers and only the
+        // ExtraNonce1 of a personalized notify is its own.
+        bool personal = Server.Pool.personal();
+        std::vector<connection*> closed{};
+        for (auto& x : Connections) {
+            connection& c = *x.second;
+            if (!c.Subscribed) continue;
+            for (const std::shared_ptr<const notify_cache>& n : notifies) {
+                if (!personal) c.Out.emplace_back(n->line());
+                else {
+                    c.Out.emplace_back(n->head());
+                    c.Out.emplace_back(c.ExtraNonce1.data(), c.ExtraNonce1.size());
+                    c.Out.emplace_back(n->tail());
+                }
+            }
+            if (c.Out.size() > MaxQueueSize) c.Closed = true;
+            else flush(c);
+            if (c.Closed) closed.push_back(&c);
+        }
+
+        for (connection* c : closed) close(*c);
+    }
+
+    void server::worker::read(connection& c) {
+        char buffer[4096];
+        while (true) {
+            ssize_t n = ::recv(c.Socket, buffer, sizeof(buffer), 0);
+            if (n == 0) {
+                c.Closed = true;
+                return;
+            }
+
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno != EAGAIN && errno != EWOULDBLOCK) c.Closed = true;
+                return;
+            }
+
+            c.In.append(buffer, n);
+            size_t start = 0;
+            size_t end;
+            while ((end = c.In.find('\n', start)) != std::string::npos) {
+                handle(c, c.In.substr(start, end - start));
+                if (c.Closed) return;
+                start = end + 1;
+            }
+
+            c.In.erase(0, start);
+            if (c.In.size() > MaxLineSize) {
+                c.Closed = true;
+                return;
+            }
+        }
+    }
+
+    void server::worker::handle(connection& c, std::string line) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) return;
+
+        // shares are most of what miners send, so they are read without json.
+        if (codec::read(line, Share)) return submit(c, Share);
+
+        json j = json::parse(line, nullptr, false);
+        if (j.is_discarded()) {
+            c.Closed = true;
+            return;
+        }
+
+        // Anything that isn't a request doesn't get a response.
+        if (!j.is_object() || !j.contains("id") || !j["id"].is_number_unsigned()) return;
+
+        request r{};
+        from_json(j, r);
+        request_id id = j["id"];
+
+        switch (r.Method) {
+            case mining_subscribe : {
+                // queued notifies point to ExtraNonce1, so it cannot change.
+                if (c.Subscribed) return respond(c, response{id, json{}, unknown});
+                c.ExtraNonce1 = notify_cache::write_fragment(Server.Pool.subscribe(c.ID));
+                c.Subscribed = true;
+                // if notifies are personalized, the miner's part of ExtraNonce1 is empty.
+                respond(c, response{id, json::array({
+                    json::array({json::array({"mining.notify", std::to_string(c.ID)})}),
+                    Server.Pool.personal() ? std::string{} : std::string{c.ExtraNonce1.data(), c.ExtraNonce1.size()},
+                    Stratum::worker::ExtraNonce2_size})});
+                return;
+            }
+
+            case mining_authorize : {
+                if (!c.Subscribed) return respond(c, response{id, json{}, not_subscribed});
+                if (r.Params.size() < 1 || !r.Params[0].is_string()) return respond(c, response{id, json{}, unknown});
+                std::string password = r.Params.size() > 1 && r.Params[1].is_string() ? r.Params[1].get<std::string>() : "";
+                bool authorized = Server.Pool.authorize(c.ID, r.Params[0].get<std::string>(), password);
+                if (authorized) c.Authorized = true;
+                return respond(c, response{id, authorized});
+            }
+
+            case mining_submit : {
+                share x{r};
+                if (!x.valid()) return respond(c, response{id, json{}, c.Authorized ? unknown : unauthorized_worker});
+                return submit(c, x);
+            }
+
+            default :
+                return respond(c, response{id, json{}, unknown});
+        }
+    }
+
+    void server::worker::submit(connection& c, const share& x) {
+        if (!c.Authorized) return respond(c, response{x.ID, json{}, unauthorized_worker});
+        respond(c, response{x.ID, Server.Pool.submit(c.ID, x)});
+    }
+
+    void server::worker::respond(connection& c, const response& r) {
+        if (codec::size(r) != 0) return send(c, std::make_shared<const std::string>(codec::write(r)));
+        json j;
+        to_json(j, r);
+        send(c, serialize(j));
+    }
+
+    void server::worker::send(connection& c, message m) {
+        c.Out.emplace_back(m);
+        if (c.Out.size() > MaxQueueSize) c.Closed = true;
+        else flush(c);
+    }
+
+    void server::worker::flush(connection& c) {
+        iovec pieces[MaxWrite];
+        while (!c.Out.empty()) {
+            size_t count = 0;
+            for (auto p = c.Out.begin(); p != c.Out.end() && count < MaxWrite; p++, count++)
+                pieces[count] = iovec{const_cast<char*>(p->Data), p->Size};
+
+            // sendmsg rather than writev so as not to raise SIGPIPE.
+            msghdr header{};
+            header.msg_iov = pieces;
+            header.msg_iovlen = count;
+            ssize_t n = ::sendmsg(c.Socket, &header, MSG_NOSIGNAL);
+            if (n < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) watch(c, true);
+                else c.Closed = true;
+                return;
+            }
+
+            size_t sent = n;
+            while (sent > 0) {
+                piece& front = c.Out.front();
+                if (sent < front.Size) {
+                    front.Data += sent;
+                    front.Size -= sent;
+                    break;
+                }
+                sent -= front.Size;
+                c.Out.pop_front();
+            }
+        }
+
+        watch(c, false);
+    }
+
+    void server::worker::watch(connection& c, bool writable) {
+        if (c.Writable == writable) return;
+        epoll_event e{};
+        e.events = writable ? EPOLLIN | EPOLLOUT : EPOLLIN;
+        e.data.fd = c.Socket;
+        epoll_ctl(Epoll, EPOLL_CTL_MOD, c.Socket, &e);
+        c.Writable = writable;
+    }
+
+    void server::worker::close(connection& c) {
+        int s = c.Socket;
+        connection_id id = c.ID;
+        epoll_ctl(Epoll, EPOLL_CTL_DEL, s, nullptr);
+        ::close(s);
+        Connections.erase(s);
+        Server.Connections--;
+        Server.Pool.disconnected(id);
+    }
+
+    server::server(Stratum::pool& p, uint16 port, uint32 threads) :
+        Pool{p}, Listener{-1}, Port{0}, Stop{false}, Next{1}, Connections{0}, Workers{}, Threads{} {
+        Listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (Listener < 0) return;
+
+        int one = 1;
+        setsockopt(Listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        socklen_t size = sizeof(address);
+        if (bind(Listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+            listen(Listener, SOMAXCONN) < 0 ||
+            getsockname(Listener, reinterpret_cast<sockaddr*>(&address), &size) < 0) {
+            ::close(Listener);
+            Listener = -1;
+            return;
+        }
+        Port = ntohs(address.sin_port);
+
+        for (uint32 i = 0; i < std::max(threads, uint32{1}); i++) {
+            Workers.push_back(std::make_unique<worker>(*this));
+            if (Workers.back()->valid()) continue;
+            Workers.clear();
+            ::close(Listener);
+            Listener = -1;
+            return;
+        }
+
+        for (std::unique_ptr<worker>& w : Workers) Threads.emplace_back([x = w.get()]() {
+            x->run();
+        });
+    }
+
+    server::~server() {
+        stop();
+    }
+
+    void server::notify(const Stratum::notify& n) {
+        if (!n.valid()) return;
+        std::shared_ptr<const notify_cache> cache = std::make_shared<const notify_cache>(n);
+        for (std::unique_ptr<worker>& w : Workers) {
+            {
+                std::lock_guard<std::mutex> lock(w->Mutex);
+                w->Broadcasts.push_back(cache);
+            }
+            w->wake();
+        }
+    }
+
+    void server::stop() {
+        Stop = true;
+        for (std::unique_ptr<worker>& w : Workers) w->wake();
+        for (std::thread& t : Threads) t.join();
+        Threads.clear();
+        Workers.clear();
+        if (Listener >= 0) ::close(Listener);
+        Listener = -1;
+    }
+
+}
@@ -1,26 +1,101 @@
 #include <gigamonkey/stratum/stratum.hpp>
+#include "hex.hpp"
 
 namespace Gigamonkey::Stratum {
     
     std::string method_to_string(method m) {
         switch (m) {
+            case mining_authorize : 
+                return "mining.authorize";
+            case mining_configure : 
+                return "mining.configure";
+            case mining_subscribe : 
+                return "mining.subscribe";
             case mining_notify :
                 return "mining.notify";
+            case mining_set_target : 
+                return "mining.set_target";
             case mining_submit :
                 return "mining.submit";
+            case client_get_version : 
+                return "client.get_version";
+            case client_reconnect : 
+                return "client.reconnect";
             default: 
                 return "";
         }
     }
     
     method method_from_string(std::string st) {
+        if (st == "mining.authorize") return mining_authorize;
+        if (st == "mining.configure") return mining_configure;
+        if (st == "mining.subscribe") return mining_subscribe;
         if (st == "mining.notify") return mining_notify;
+        if (st == "mining.set_target") return mining_set_target;
         if (st == "mining.submit") return mining_submit;
+        if (st == "client.get_version") return client_get_version;
+        if (st == "client.reconnect") return client_reconnect;
         return unset;
     }
     
-    std::string error_message_from_code(error_code) {
-        return "";
+    std::string error_message_from_code(error_code c) {
+        switch (c) {
+            case unknown : 
+                return "Other/Unknown";
+            case job_not_found : 
+                return "Job not found";
+            case duplicate_share : 
+                return "Duplicate share";
+            case low_difficulty_share : 
+                return "Low difficulty share";
+            case unauthorized_worker : 
+                return "Unauthorized worker";
+            case not_subscribed : 
+                return "Not subscribed";
+            default: 
+                return "";
+        }
+    }
+    
+    namespace {
+        
+        bool read_hex(const json& j, bytes& b) {
+            if (!j.is_string()) return false;
+            const std::string& s = j.get_ref<const std::string&>();
+            if (s.size() % 2 != 0) return false;
+            b = bytes(s.size() / 2);
+            for (size_t i = 0; i < b.size(); i++) {
+                int high = hex::digit(s[2 * i]);
+                int low = hex::digit(s[2 * i + 1]);
+                if (high < 0 || low < 0) return false;
+                b[i] = static_cast<byte>(high * 16 + low);
+            }
+            return true;
+        }
+        
+        bool read_uint32(const json& j, uint32& x) {
+            bytes b;
+            if (!read_hex(j, b) || b.size() != 4) return false;
+            x = (uint32(b[0]) << 24) | (uint32(b[1]) << 16) | (uint32(b[2]) << 8) | uint32(b[3]);
+            return true;
+        }
+        
+        // Job ids are usually strings, but some pools use numbers. 
+        bool read_job_id(const json& j, job_id& x) {
+            if (j.is_number_unsigned()) {
+                x = j.get<job_id>();
+                return true;
+            }
+            return read_uint32(j, x);
+        }
+        
+        bool read_previous(const json& j, uint256& d) {
+            bytes b;
+            if (!read_hex(j, b) || b.size() != 32) return false;
+            for (int i = 0; i < 32; i++) d.data()[(i & ~3) + 3 - (i & 3)] = b[i];
+            return true;
+        }
+        
     }
     
     void to_json(json& j, const request& p) {
@@ -90,7 +165,21 @@ namespace Gigamonkey::Stratum {
     }
     
     notify::operator notification() const {
-        throw data::method::unimplemented{""};
+        if (!valid()) return {};
+        
+        json path = json::array();
+        for (list<digest256> p = Path; !p.empty(); p = p.rest()) path.push_back(hex::write(p.first()));
+        
+        return notification{mining_notify, {
+            hex::write_uint32(ID), 
+            hex::write_previous(Digest), 
+            hex::write(GenerationTx1), 
+            hex::write(GenerationTx2), 
+            path, 
+            hex::write_uint32(uint32(int32(Version))), 
+            hex::write_uint32(uint32(static_cast<uint32_little>(Target))), 
+            hex::write_uint32(uint32(Now.Value)), 
+            Clean}};
     }
     
     void to_json(json& j, const notify& p) {
@@ -102,56 +191,40 @@ namespace Gigamonkey::Stratum {
         to_json(j, notification(p));
     }
     
-    notify::notify(const notification& n) {/*
-        if (!n.valid()) return;
-        
-        if (n.Method != mining_notify) return;
-        
-        if (n.Params.size() < 9) return;
-        
-        if (!(n.Params[0].is_number_unsigned())) return;
-        
-        if (!(n.Params[1].is_string())) return;
-        encoding::hex::string previous{n.Params[1].get<string>()};
-        if (!previous.valid()) return;
-        bytes previous_bytes = bytes_view(previous);
+    notify::notify(const notification& n) : notify{} {
+        if (n.Method != mining_notify || n.Params.size() < 9) return;
         
-        // the two parts of the coinbase. 
-        if (!(n.Params[2].is_string())) return; 
-        encoding::hex::string coinbase_1{n.Params[2].get<string>()};
-        if (!coinbase_1.valid()) return;
+        job_id id;
+        uint256 previous;
+        bytes coinbase_1;
+        bytes coinbase_2;
+        uint32 version;
+        uint32 target;
+        uint32 now;
         
-        if (!(n.Params[3].is_string())) return;
-        encoding::hex::string coinbase_2{n.Params[3].get<string>()};
-        if (!coinbase_2.valid()) return;
+        if (!read_job_id(n.Params[0], id) || 
+            !read_previous(n.Params[1], previous) || 
+            !read_hex(n.Params[2], coinbase_1) || 
+            !read_hex(n.Params[3], coinbase_2) || 
+            !n.Params[4].is_array() || 
+            !read_uint32(n.Params[5], version) || 
+            !read_uint32(n.Params[6], target) || 
+            !read_uint32(n.Params[7], now) || 
+            !n.Params[8].is_boolean()) return;
         
-        // merkle path
-        if (!(n.Params[4].is_array())) return;
-        cross<std::string> merkle(n.Params[4].size(), "");
-        int i = 0;
-        for (auto it = n.Params[4].begin(); it != n.Params[4].end(); it ++) {
-            if (!it->is_string()) return;
-            merkle[i] = it->get<string>();
-            if (merkle[i].size() != 64) return;
+        list<digest256> path{};
+        for (const json& x : n.Params[4]) {
+            bytes b;
+            if (!read_hex(x, b) || b.size() != 32) return;
+            digest256 d;
+            std::copy(b.begin(), b.end(), d.begin());
+            path = path << d;
         }
         
-        if (!(n.Params[5].is_string())) return;
-        
-        
-        if (!(n.Params[6].is_string())) return;
-        
-        
-        if (!(n.Params[7].is_string())) return;  
-        
-        
-        if (!(n.Params[8].is_boolean())) return; 
-        
-        ID = n.Params[0].get<uint32>();
-        std::copy(previous_bytes.begin(), previous_bytes.end(), Digest.begin()); */
-        
-        throw data::method::unimplemented{""};
+        *this = notify{id, previous, coinbase_1, coinbase_2, path, int32_little{int32(version)}, 
+            work::target{target}, timestamp{uint32_little{now}}, n.Params[8].get<bool>()};
     }
-
+    
     void from_json(const json& j, notify& p) {
         p = {};
         notification x;
@@ -160,15 +233,41 @@ namespace Gigamonkey::Stratum {
     }
     
     void to_json(json& j, const share& p) {
-        j = {};
+        if (!p.valid()) {
+            j = {};
+            return;
+        }
+        
+        to_json(j, request(p));
     }
     
-    share::share(const request& n) {
-        if (!n.valid()) return;
+    share::share(const request& n) : share{} {
+        if (n.Method != mining_submit || n.Params.size() < 5 || !n.Params[0].is_string()) return;
         
-        if (n.Method != mining_submit) return;
+        job_id id;
+        bytes extra_nonce_2;
+        uint32 time;
+        uint32 nonce;
         
-        throw data::method::unimplemented{""};
+        if (!read_job_id(n.Params[1], id) || 
+            !read_hex(n.Params[2], extra_nonce_2) || extra_nonce_2.size() != 8 || 
+            !read_uint32(n.Params[3], time) || 
+            !read_uint32(n.Params[4], nonce)) return;
+        
+        uint64_little n2;
+        std::copy(extra_nonce_2.begin(), extra_nonce_2.end(), n2.data());
+        
+        *this = share{n.ID, n.Params[0].get<std::string>(), id, n2, timestamp{uint32_little{time}}, Gigamonkey::nonce{nonce}};
+    }
+    
+    share::operator request() const {
+        if (!valid()) return {};
+        return request{ID, mining_submit, {
+            Name, 
+            hex::write_uint32(JobID), 
+            hex::write(bytes_view{ExtraNonce2.data(), 8}), 
+            hex::write_uint32(uint32(nTime.Value)), 
+            hex::write_uint32(uint32(nOnce))}};
     }
     
     void from_json(const json& j, share& p) {
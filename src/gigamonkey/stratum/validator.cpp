@@ -0,0 +1,197 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/validator.hpp>
+#include <gigamonkey/midstate.hpp>
+
+namespace Gigamonkey::Stratum {
+
+    error_code error(share_result r) {
+        switch (r) {
+            case stale :
+                return job_not_found;
+            case duplicate :
+                return duplicate_share;
+            case low_difficulty :
+                return low_difficulty_share;
+            default :
+                return none;
+        }
+    }
+
+    namespace {
+
+        // The shares that have been submitted for one job, in an open-addressed
+        // table with linear probing which is never more than half full. A record
+        // of zeros marks an empty slot, so the share that would be all zeros is
+        // kept apart.
+        class submissions {
+            struct record {
+                uint64 ExtraNonce2;
+                uint32 Time;
+                uint32 Nonce;
+
+                bool empty() const {
+                    return ExtraNonce2 == 0 && Time == 0 && Nonce == 0;
+                }
+
+                bool operator==(const record& r) const {
+                    return ExtraNonce2 == r.ExtraNonce2 && Time == r.Time && Nonce == r.Nonce;
+                }
+            };
+
+            std::vector<record> Table;
+            size_t Size;
+            bool Zero;
+
+            // the finalizer of splitmix64.
+            static size_t hash(const record& r) {
+                uint64 x = r.ExtraNonce2 ^ (((uint64(r.Time) << 32) | r.Nonce) * 0x9e3779b97f4a7c15);
+                x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9;
+                x = (x ^ (x >> 27)) * 0x94d049bb133111eb;
+                return static_cast<size_t>(x ^ (x >> 31));
+            }
+
+            void place(const record& r) {
+                size_t mask = Table.size() - 1;
+                size_t i = hash(r) & mask;
+                while (!Table[i].empty()) i = (i + 1) & mask;
+                Table[i] = r;
+            }
+
+        public:
+            submissions() : Table(16), Size{0}, Zero{false} {}
+
+            // false if the share has been submitted before.
+            bool insert(const share& x) {
+                record r{uint64(x.ExtraNonce2), uint32(x.nTime.Value), uint32(x.nOnce)};
+                if (r.empty()) {
+                    if (Zero) return false;
+                    return Zero = true;
+                }
+
+                size_t mask = Table.size() - 1;
+                for (size_t i = hash(r) & mask; !Table[i].empty(); i = (i + 1) & mask) if (Table[i] == r) return false;
+
+                if (2 * (Size + 1) > Table.size()) {
+                    std::vector<record> old(2 * Table.size());
+                    old.swap(Table);
+                    for (const record& o : old) if (!o.empty()) place(o);
+                }
+
+                place(r);
+                Size++;
+                return true;
+            }
+        };
+
+    }
+
+    // everything about a job that is the same for all of its shares.
+    struct validator::entry {
+        int32_little Version;
+        uint256 Digest;
+        work::target Target;
+        uint256 JobTarget;
+        uint256 ShareTarget;
+
+        // the state after GenerationTx1 and ExtraNonce1.
+        midstate Coinbase;
+        bytes GenerationTx2;
+        // the coinbase is always first in the block.
+        Merkle::path Path;
+
+        submissions Submitted;
+
+        entry(const job& j, work::target share_target) :
+            Version{j.Version}, Digest{j.Notify.Digest}, Target{j.Notify.Target},
+            JobTarget{j.Notify.Target.expand()}, ShareTarget{share_target.expand()},
+            Coinbase{write(j.Notify.GenerationTx1.size() + 4, j.Notify.GenerationTx1, j.Worker.ExtraNonce1)},
+            GenerationTx2{j.Notify.GenerationTx2}, Path{j.Notify.Path, 0}, Submitted{} {}
+    };
+
+    validator::validator() : Workers{} {}
+
+    validator::~validator() {}
+
+    bool validator::add(const job& j, work::target share_target) {
+        if (!j.valid()) return false;
+        std::unordered_map<job_id, std::unique_ptr<entry>>& jobs = Workers[j.Worker.Name];
+        if (j.Notify.Clean) jobs.clear();
+        jobs[j.Notify.ID] = std::make_unique<entry>(j, share_target);
+        return true;
+    }
+
+    void validator::remove(const worker_name& name, job_id id) {
+        auto w = Workers.find(name);
+        if (w == Workers.end()) return;
+        w->second.erase(id);
+        if (w->second.empty()) Workers.erase(w);
+    }
+
+    void validator::remove(const worker_name& name) {
+        Workers.erase(name);
+    }
+
+    size_t validator::size() const {
+        size_t n = 0;
+        for (const auto& w : Workers) n += w.second.size();
+        return n;
+    }
+
+    share_result validator::check(const share& x) {
+        return check(std::vector<share>{x})[0];
+    }
+
+    std::vector<share_result> validator::check(const std::vector<share>& shares) {
+        std::vector<share_result> results(shares.size(), stale);
+
+        // the shares that are neither stale nor duplicates, by job.
+        std::unordered_map<const entry*, std::vector<size_t>> groups{};
+        size_t count = 0;
+        for (size_t n = 0; n < shares.size(); n++) {
+            const share& x = shares[n];
+            auto w = Workers.find(x.Name);
+            if (w == Workers.end()) continue;
+            auto j = w->second.find(x.JobID);
+            if (j == w->second.end()) continue;
+            if (!j->second->Submitted.insert(x)) {
+                results[n] = duplicate;
+                continue;
+            }
+            groups[j->second.get()].push_back(n);
+            count++;
+        }
+
+        // Every share is hashed at once.
+        std::vector<work::string> strings{};
+        std::vector<std::pair<size_t, const entry*>> written{};
+        strings.reserve(count);
+        written.reserve(count);
+        for (const auto& g : groups) {
+            const entry& e = *g.first;
+            const std::vector<size_t>& group = g.second;
+
+            std::vector<uint64> extra_nonce_2(group.size());
+            for (size_t i = 0; i < group.size(); i++) extra_nonce_2[i] = shares[group[i]].ExtraNonce2;
+            std::vector<digest256> roots = merkle_roots(e.Coinbase, e.GenerationTx2, extra_nonce_2, e.Path);
+
+            for (size_t i = 0; i < group.size(); i++) {
+                const share& x = shares[group[i]];
+                strings.emplace_back(e.Version, e.Digest, roots[i].Value, x.nTime, e.Target, x.nOnce);
+                written.emplace_back(group[i], &e);
+            }
+        }
+
+        std::vector<digest256> hashes = hash256(strings);
+
+        for (size_t k = 0; k < count; k++) {
+            const entry& e = *written[k].second;
+            const uint256& h = hashes[k].Value;
+            results[written[k].first] = h < e.JobTarget ? block : h < e.ShareTarget ? valid : low_difficulty;
+        }
+
+        return results;
+    }
+
+}
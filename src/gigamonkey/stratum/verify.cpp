@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/verify.hpp>
+#include <gigamonkey/midstate.hpp>
+#include <unordered_map>
+
+namespace Gigamonkey::Stratum {
+
+    namespace {
+
+        // the shares of one job.
+        struct group {
+            const job* Job;
+            std::vector<size_t> Shares; // positions in the input.
+        };
+
+        std::vector<verdict> verify(const std::vector<group>& groups, const std::vector<const share*>& shares) {
+            size_t count = shares.size();
+            std::vector<work::string> strings(count);
+            std::vector<uint256> targets(count, uint256{0});
+
+            for (const group& g : groups) {
+                // nothing meets the target of an invalid job.
+                if (!g.Job->valid()) continue;
+
+                work::puzzle p = g.Job->puzzle();
+                uint256 target = p.Target.expand();
+                midstate meta{write(p.Header.size() + 4, p.Header, p.ExtraNonce)};
+
+                std::vector<uint64> extra_nonce_2(g.Shares.size());
+                for (size_t i = 0; i < g.Shares.size(); i++) extra_nonce_2[i] = shares[g.Shares[i]]->ExtraNonce2;
+                std::vector<digest256> roots = merkle_roots(meta, p.Body, extra_nonce_2, p.Path);
+
+                for (size_t i = 0; i < g.Shares.size(); i++) {
+                    size_t n = g.Shares[i];
+                    const share& x = *shares[n];
+                    strings[n] = work::string{p.Category, p.Digest, roots[i].Value, x.nTime, p.Target, x.nOnce};
+                    targets[n] = target;
+                }
+            }
+
+            std::vector<digest256> hashes = hash256(strings);
+
+            std::vector<verdict> verdicts(count);
+            for (size_t n = 0; n < count; n++) verdicts[n] = targets[n] == 0 ? verdict{false, 0} :
+                verdict{hashes[n].Value < targets[n], work::hash_difficulty(hashes[n].Value)};
+            return verdicts;
+        }
+
+    }
+
+    std::vector<verdict> verify(const std::vector<solved>& x) {
+        std::vector<group> groups{};
+        std::vector<const share*> shares(x.size());
+
+        // jobs are looked up by id and extra nonce 1, which should be
+        // enough, but jobs are compared anyway in case they are not.
+        std::unordered_multimap<uint64, size_t> by_id{};
+        for (size_t n = 0; n < x.size(); n++) {
+            const job& j = x[n].Job;
+            shares[n] = &x[n].Share;
+            uint64 key = (uint64(j.Notify.ID) << 32) + uint32(j.Worker.ExtraNonce1);
+
+            auto range = by_id.equal_range(key);
+            auto found = range.first;
+            while (found != range.second && *groups[found->second].Job != j) found++;
+            if (found != range.second) {
+                groups[found->second].Shares.push_back(n);
+                continue;
+            }
+
+            by_id.emplace(key, groups.size());
+            groups.push_back(group{&j, {n}});
+        }
+
+        return verify(groups, shares);
+    }
+
+    std::vector<verdict> verify(const job& j, const std::vector<share>& x) {
+        std::vector<const share*> shares(x.size());
+        group g{&j, std::vector<size_t>(x.size())};
+        for (size_t n = 0; n < x.size(); n++) {
+            shares[n] = &x[n];
+            g.Shares[n] = n;
+        }
+
+        return verify(std::vector<group>{g}, shares);
+    }
+
+}
@@ -0,0 +1,109 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/thread_pool.hpp>
+#include <algorithm>
+
+namespace Gigamonkey {
+
+    thread_pool::thread_pool(uint32 threads) : Queues{}, Threads{}, Next{0}, Pending{0}, Stop{false}, Sleep{}, Wake{} {
+        for (uint32 i = 0; i < threads; i++) Queues.push_back(std::make_unique<queue>());
+        for (uint32 i = 0; i < threads; i++) Threads.emplace_back([this, i]() {
+            work(i);
+        });
+    }
+
+    thread_pool::~thread_pool() {
+        {
+            std::lock_guard<std::mutex> lock(Sleep);
+            Stop = true;
+        }
+        Wake.notify_all();
+        for (std::thread& t : Threads) t.join();
+    }
+
+    void thread_pool::submit(task t) {
+        if (Queues.size() == 0) {
+            t();
+            return;
+        }
+
+        // Pending is counted before the task can be taken
+        // so that it never counts fewer tasks than are queued.
+        {
+            std::lock_guard<std::mutex> lock(Sleep);
+            Pending++;
+        }
+        queue& q = *Queues[Next++ % Queues.size()];
+        {
+            std::lock_guard<std::mutex> lock(q.Mutex);
+            q.Tasks.push_back(std::move(t));
+        }
+        Wake.notify_one();
+    }
+
+    bool thread_pool::take(uint32 first, task& t) {
+        if (Pending == 0) return false;
+        for (uint32 i = 0; i < Queues.size(); i++) {
+            queue& q = *Queues[(first + i) % Queues.size()];
+            std::lock_guard<std::mutex> lock(q.Mutex);
+            if (q.Tasks.empty()) continue;
+            // our own tasks come from the front and stolen tasks from the back.
+            if (i == 0) {
+                t = std::move(q.Tasks.front());
+                q.Tasks.pop_front();
+            } else {
+                t = std::move(q.Tasks.back());
+                q.Tasks.pop_back();
+            }
+            Pending--;
+            return true;
+        }
+        return false;
+    }
+
+    void thread_pool::work(uint32 self) {
+        task t;
+        while (true) {
+            if (take(self, t)) {
+                t();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(Sleep);
+            Wake.wait(lock, [this]() -> bool {
+                return Stop || Pending > 0;
+            });
+            if (Stop && Pending == 0) return;
+        }
+    }
+
+    void thread_pool::run(uint32 n, const std::function<void(uint32)>& f) {
+        if (n == 0) return;
+        if (Queues.size() == 0) {
+            for (uint32 i = 0; i < n; i++) f(i);
+            return;
+        }
+
+        // enough pieces that they can be balanced between threads
+        // but not so many that we spend our time in the queues.
+        uint32 pieces = std::min(n, 8 * uint32(Queues.size()));
+        std::atomic<uint32> remaining{pieces};
+        for (uint32 p = 0; p < pieces; p++) {
+            uint32 begin = uint64(n) * p / pieces;
+            uint32 end = uint64(n) * (p + 1) / pieces;
+            submit([begin, end, &f, &remaining]() {
+                for (uint32 i = begin; i < end; i++) f(i);
+                remaining--;
+            });
+        }
+
+        task t;
+        uint32 start = Next % Queues.size();
+        while (remaining > 0) {
+            if (take(start, t)) t();
+            else std::this_thread::yield();
+        }
+    }
+
+}
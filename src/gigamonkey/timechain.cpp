@@ -49,15 +49,131 @@ namespace Gigamonkey::header {
     
 }
 
+namespace Gigamonkey {
+    namespace {
+        // read a var int from the front of b. Returns the
+        // number of bytes read or 0 if there are not enough.
+        size_t var_int_at(bytes_view b, uint64& x) {
+            if (b.size() == 0) return 0;
+            size_t size = b[0] < 0xfd ? 1 : b[0] == 0xfd ? 3 : b[0] == 0xfe ? 5 : 9;
+            if (b.size() < size) return 0;
+            if (size == 1) {
+                x = b[0];
+                return 1;
+            }
+            x = 0;
+            for (size_t i = size - 1; i > 0; i--) x = (x << 8) + b[i];
+            return size;
+        }
+
+        // skip over a var int and that many bytes.
+        size_t data_at(bytes_view b) {
+            uint64 size;
+            size_t n = var_int_at(b, size);
+            if (n == 0 || b.size() - n < size) return 0;
+            return n + size;
+        }
+
+        // positions of the inputs and outputs of a transaction.
+        struct transaction_parts {
+            cross<bytes_view> Inputs;
+            cross<bytes_view> Outputs;
+            size_t Size;
+        };
+
+        // read the transaction at the front of b, whose size
+        // may be less than that of b. Size is 0 if invalid.
+        transaction_parts transaction_at(bytes_view b) {
+            transaction_parts t{{}, {}, 0};
+            size_t i = 4;
+            if (b.size() < i) return {};
+
+            uint64 inputs;
+            size_t n = var_int_at(b.substr(i), inputs);
+            // every input is at least 41 bytes.
+            if (n == 0 || inputs > b.size() / 41) return {};
+            i += n;
+            t.Inputs = cross<bytes_view>(inputs);
+            for (uint64 x = 0; x < inputs; x++) {
+                if (b.size() - i < 36) return {};
+                n = data_at(b.substr(i + 36));
+                if (n == 0 || b.size() - i - 36 - n < 4) return {};
+                t.Inputs[x] = b.substr(i, 40 + n);
+                i += 40 + n;
+            }
+
+            uint64 outputs;
+            n = var_int_at(b.substr(i), outputs);
+            // every output is at least 9 bytes.
+            if (n == 0 || outputs > b.size() / 9) return {};
+            i += n;
+            t.Outputs = cross<bytes_view>(outputs);
+            for (uint64 x = 0; x < outputs; x++) {
+                if (b.size() - i < 8) return {};
+                n = data_at(b.substr(i + 8));
+                if (n == 0) return {};
+                t.Outputs[x] = b.substr(i, 8 + n);
+                i += 8 + n;
+            }
+
+            if (b.size() - i < 4) return {};
+            t.Size = i + 4;
+            return t;
+        }
+    }
+}
+
 namespace Gigamonkey::transaction {
     bool valid(bytes_view) {
         throw data::method::unimplemented{"transaction::valid"};
     }
     
+    cross<bytes_view> outputs(bytes_view b) {
+        transaction_parts t = transaction_at(b);
+        if (t.Size != b.size()) return {};
+        return t.Outputs;
+    }
+    
+    cross<bytes_view> inputs(bytes_view b) {
+        transaction_parts t = transaction_at(b);
+        if (t.Size != b.size()) return {};
+        return t.Inputs;
+    }
+    
     // Whether this is a coinbase transaction. 
     bool coinbase(bytes_view) {
         throw data::method::unimplemented{"transaction::coinbase"};
     }
+    
+    Bitcoin::transaction_metrics metrics(bytes_view b) {
+        transaction_parts t = transaction_at(b);
+        if (t.Size == 0 || t.Size != b.size()) return {};
+        Bitcoin::script_metrics in{};
+        Bitcoin::script_metrics out{};
+        for (const bytes_view& i : t.Inputs) in = in + Bitcoin::script_metrics{input::script(i)};
+        for (const bytes_view& o : t.Outputs) out = out + Bitcoin::script_metrics{output::script(o)};
+        return {in, out};
+    }
+}
+
+namespace Gigamonkey::input {
+    bytes_view script(bytes_view b) {
+        uint64 size;
+        if (b.size() < 36) return {};
+        size_t n = var_int_at(b.substr(36), size);
+        if (n == 0 || b.size() - 36 - n < size) return {};
+        return b.substr(36 + n, size);
+    }
+}
+
+namespace Gigamonkey::output {
+    bytes_view script(bytes_view b) {
+        uint64 size;
+        if (b.size() < 8) return {};
+        size_t n = var_int_at(b.substr(8), size);
+        if (n == 0 || b.size() - 8 - n < size) return {};
+        return b.substr(8 + n, size);
+    }
 }
 
 namespace Gigamonkey::block {
@@ -68,9 +184,27 @@ namespace Gigamonkey::block {
         bool valid() const;
     };
     
+    const slice<80> header(bytes_view b) {
+        return slice<80>(const_cast<byte*>(b.data()));
+    }
+    
+    // views of every transaction in a block, or nothing if it doesn't parse.
     cross<bytes_view> transactions(bytes_view b) {
+        if (b.size() < 80) return {};
         bytes_view after_header{b.substr(80)};
-        throw method::unimplemented{"block::transactions"};
+        uint64 count;
+        size_t n = var_int_at(after_header, count);
+        if (n == 0 || count > after_header.size()) return {};
+        cross<bytes_view> txs(count);
+        size_t i = n;
+        for (uint64 x = 0; x < count; x++) {
+            size_t size = transaction_at(after_header.substr(i)).Size;
+            if (size == 0) return {};
+            txs[x] = after_header.substr(i, size);
+            i += size;
+        }
+        if (i != after_header.size()) return {};
+        return txs;
     }
     
     tx_reader read_next_tx(bytes_reader);
@@ -98,15 +232,24 @@ namespace Gigamonkey::block {
         return header::merkle_root(h) == merkle_root(txs);
     }*/
     
-    /* TODO
-    const slice<80> header(bytes_view b) {
-        return data::slice<byte>{b}.range<8, 88>();
-    }*/
-    
 }
 
 namespace Gigamonkey::Bitcoin {
-    
+
+    std::vector<uint64> locator_heights(uint64 tip, uint64 base) {
+        std::vector<uint64> heights{};
+        if (tip < base) return heights;
+        uint64 step = 1;
+        uint64 height = tip;
+        while (height > base) {
+            heights.push_back(height);
+            if (heights.size() >= 10) step *= 2;
+            height = height - base > step ? height - step : base;
+        }
+        heights.push_back(base);
+        return heights;
+    }
+
     Gigamonkey::uint256 satoshi_uint256_to_uint256(::uint256 x) {
         Gigamonkey::uint256 y;
         std::copy(x.begin(), x.end(), y.begin());
@@ -132,16 +275,39 @@ namespace Gigamonkey::Bitcoin {
         return h;
     }
     
-    bytes_writer write_var_int(bytes_writer, uint64) {
-        throw data::method::unimplemented{"write_var_int"};
+    bytes_writer write_var_int(bytes_writer w, uint64 x) {
+        if (x < 0xfd) return w << static_cast<byte>(x);
+        if (x <= 0xffff) return w << byte{0xfd} << static_cast<uint16_little>(x);
+        if (x <= 0xffffffff) return w << byte{0xfe} << uint32_little{static_cast<uint32>(x)};
+        return w << byte{0xff} << uint64_little{x};
     }
     
-    bytes_reader read_var_int(bytes_reader, uint64&) {
-        throw data::method::unimplemented{"read_var_int"};
+    bytes_reader read_var_int(bytes_reader r, uint64& x) {
+        byte b;
+        r = r >> b;
+        if (b < 0xfd) {
+            x = b;
+            return r;
+        }
+        
+        if (b == 0xfd) {
+            uint16_little n;
+            r = r >> n;
+            x = n;
+        } else if (b == 0xfe) {
+            uint32_little n;
+            r = r >> n;
+            x = n;
+        } else {
+            uint64_little n;
+            r = r >> n;
+            x = n;
+        }
+        return r;
     }
     
-    size_t var_int_size(uint64) {
-        throw data::method::unimplemented{"var_int_size"};
+    size_t var_int_size(uint64 x) {
+        return x < 0xfd ? 1 : x <= 0xffff ? 3 : x <= 0xffffffff ? 5 : 9;
     }
         
     bool header::valid() const {
@@ -157,7 +323,7 @@ namespace Gigamonkey::Bitcoin {
     }
     
     size_t transaction::serialized_size() const {
-        return 8 + var_int_size(Inputs.size()) + var_int_size(Inputs.size()) + 
+        return 8 + var_int_size(Inputs.size()) + var_int_size(Outputs.size()) + 
             data::fold([](size_t size, const input& i)->size_t{
                 return size + i.serialized_size();
             }, 0, Inputs) + 
@@ -166,6 +332,15 @@ namespace Gigamonkey::Bitcoin {
             }, 0, Outputs);
     }
     
+    uint32 transaction::sigops() const {
+        return data::fold([](uint32 x, const input& i) -> uint32 {
+                return x + script_metrics{i.Script}.Sigops;
+            }, uint32{0}, Inputs) + 
+            data::fold([](uint32 x, const output& o) -> uint32 {
+                return x + script_metrics{o.Script}.Sigops;
+            }, uint32{0}, Outputs);
+    }
+    
     size_t block::serialized_size() const {
         return 80 + var_int_size(Transactions.size()) + 
         data::fold([](size_t size, transaction x)->size_t{
@@ -0,0 +1,239 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/txid_index.hpp>
+#include <algorithm>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Gigamonkey::Bitcoin {
+
+    namespace {
+
+        const byte RunMagic[4]{'G', 'M', 'T', 'X'};
+
+        // magic, bits, count, through and 8 unused bytes.
+        const uint64 RunHeaderSize = 32;
+
+        uint64 read_little(const byte* b, size_t size) {
+            uint64 x = 0;
+            for (size_t i = size; i > 0; i--) x = (x << 8) | b[i - 1];
+            return x;
+        }
+
+        void write_little(byte* b, uint64 x, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                b[i] = static_cast<byte>(x);
+                x >>= 8;
+            }
+        }
+
+        // about 16 entries per bucket, but no more than 2^16 buckets.
+        uint32 bucket_bits(uint64 count) {
+            uint32 bits = 0;
+            while (bits < 16 && (count >> (bits + 5)) != 0) bits++;
+            return bits;
+        }
+
+        uint64 bucket(uint64 prefix, uint32 bits) {
+            return bits == 0 ? 0 : prefix >> (64 - bits);
+        }
+
+        using sorted_entries = std::vector<std::pair<uint64, txid_index::entry>>;
+
+        bool earlier(const std::pair<uint64, txid_index::entry>& a, const std::pair<uint64, txid_index::entry>& b) {
+            return a.first < b.first;
+        }
+
+    }
+
+    uint64 txid_index::prefix(const txid& id) {
+        return read_little(id.Value.data(), 8);
+    }
+
+    uint64 txid_index::run::size() const {
+        return RunHeaderSize + 4 * ((uint64(1) << Bits) + 1) + EntrySize * Count;
+    }
+
+    txid_index::txid_index(const std::string& path) :
+        Path{path}, File{-1}, Map{nullptr}, MapSize{0}, End{0}, Runs{}, Pending{}, Through{0} {
+        File = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (File < 0) return;
+
+        struct stat s;
+        if (::fstat(File, &s) != 0) {
+            ::close(File);
+            File = -1;
+            return;
+        }
+
+        End = s.st_size;
+        remap();
+
+        // a run that was not completely written is discarded.
+        uint64 at = 0;
+        while (true) {
+            std::optional<run> r = read(at);
+            if (!r) break;
+            Runs.push_back(*r);
+            at += r->size();
+        }
+
+        if (at != End) {
+            if (::ftruncate(File, at) != 0) throw std::runtime_error{"could not truncate txid index " + Path};
+            End = at;
+            remap();
+        }
+
+        Through = through();
+    }
+
+    txid_index::~txid_index() {
+        if (File < 0) return;
+        flush();
+        if (Map != nullptr) ::munmap(Map, MapSize);
+        ::close(File);
+    }
+
+    void txid_index::remap() {
+        if (Map != nullptr) ::munmap(Map, MapSize);
+        Map = nullptr;
+        MapSize = End;
+        if (End == 0) return;
+        void* m = ::mmap(nullptr, End, PROT_READ, MAP_SHARED, File, 0);
+        if (m == MAP_FAILED) throw std::runtime_error{"could not map txid index " + Path};
+        Map = static_cast<byte*>(m);
+    }
+
+    std::optional<txid_index::run> txid_index::read(uint64 at) const {
+        if (End < at + RunHeaderSize) return {};
+        const byte* h = Map + at;
+        if (!std::equal(RunMagic, RunMagic + 4, h)) return {};
+        run r{at, read_little(h + 8, 8), static_cast<uint32>(read_little(h + 4, 4)), read_little(h + 16, 8)};
+        if (r.Bits > 16 || End - at < r.size()) return {};
+        return r;
+    }
+
+    txid_index::run txid_index::write(const sorted_entries& x, uint64 through, uint64 at) {
+        run r{at, x.size(), bucket_bits(x.size()), through};
+        bytes b(r.size());
+        std::fill(b.begin(), b.end(), 0);
+
+        std::copy(RunMagic, RunMagic + 4, b.data());
+        write_little(b.data() + 4, r.Bits, 4);
+        write_little(b.data() + 8, r.Count, 8);
+        write_little(b.data() + 16, r.Through, 8);
+
+        // bucket i contains the entries from Buckets[i] to Buckets[i + 1].
+        byte* buckets = b.data() + RunHeaderSize;
+        byte* entries = buckets + 4 * ((uint64(1) << r.Bits) + 1);
+        uint64 next = 0;
+        for (uint64 i = 0; i < x.size(); i++) {
+            uint64 k = bucket(x[i].first, r.Bits);
+            while (next <= k) write_little(buckets + 4 * next++, i, 4);
+            byte* e = entries + EntrySize * i;
+            write_little(e, x[i].first, 8);
+            write_little(e + 8, x[i].second.Offset, 6);
+            write_little(e + 14, x[i].second.Size, 4);
+        }
+        while (next <= (uint64(1) << r.Bits)) write_little(buckets + 4 * next++, x.size(), 4);
+
+        const byte* p = b.data();
+        size_t size = b.size();
+        uint64 offset = at;
+        while (size > 0) {
+            ssize_t n = ::pwrite(File, p, size, offset);
+            if (n <= 0) throw std::runtime_error{"could not write to txid index " + Path};
+            p += n;
+            size -= n;
+            offset += n;
+        }
+
+        End = at + r.size();
+        if (::ftruncate(File, End) != 0) throw std::runtime_error{"could not truncate txid index " + Path};
+        remap();
+        return r;
+    }
+
+    sorted_entries txid_index::entries(const run& r) const {
+        sorted_entries x(r.Count);
+        const byte* e = Map + r.Start + RunHeaderSize + 4 * ((uint64(1) << r.Bits) + 1);
+        for (uint64 i = 0; i < r.Count; i++, e += EntrySize)
+            x[i] = {read_little(e, 8), entry{read_little(e + 8, 6), static_cast<uint32>(read_little(e + 14, 4))}};
+        return x;
+    }
+
+    // Like a binary counter, the runs get smaller towards the end of the file.
+    void txid_index::merge() {
+        while (Runs.size() >= 2 && Runs[Runs.size() - 2].Count <= 2 * Runs.back().Count) {
+            run a = Runs[Runs.size() - 2];
+            run b = Runs.back();
+            sorted_entries x = entries(a);
+            sorted_entries y = entries(b);
+            sorted_entries merged(x.size() + y.size());
+            std::merge(x.begin(), x.end(), y.begin(), y.end(), merged.begin(), earlier);
+            Runs.pop_back();
+            Runs.pop_back();
+            Runs.push_back(write(merged, b.Through, a.Start));
+        }
+    }
+
+    uint64 txid_index::size() const {
+        uint64 n = Pending.size();
+        for (const run& r : Runs) n += r.Count;
+        return n;
+    }
+
+    void txid_index::add(const txid& id, entry e) {
+        Pending.insert({prefix(id), e});
+    }
+
+    void txid_index::commit(uint64 through) {
+        Through = through;
+        if (Pending.size() >= RunSize) flush();
+    }
+
+    void txid_index::flush() {
+        if (Pending.size() == 0 || !valid()) return;
+        sorted_entries x(Pending.begin(), Pending.end());
+        std::stable_sort(x.begin(), x.end(), earlier);
+        Runs.push_back(write(x, Through, End));
+        Pending.clear();
+        merge();
+    }
+
+    std::optional<txid_index::entry> txid_index::find(const txid& id, std::function<bool(const entry&)> verify) const {
+        uint64 p = prefix(id);
+
+        auto pending = Pending.equal_range(p);
+        for (auto i = pending.first; i != pending.second; i++) if (verify(i->second)) return i->second;
+
+        // newest first.
+        for (auto r = Runs.rbegin(); r != Runs.rend(); r++) {
+            const byte* buckets = Map + r->Start + RunHeaderSize;
+            const byte* entries = buckets + 4 * ((uint64(1) << r->Bits) + 1);
+            uint64 k = bucket(p, r->Bits);
+            uint64 low = read_little(buckets + 4 * k, 4);
+            uint64 high = read_little(buckets + 4 * (k + 1), 4);
+
+            while (low < high) {
+                uint64 mid = low + (high - low) / 2;
+                if (read_little(entries + EntrySize * mid, 8) < p) low = mid + 1;
+                else high = mid;
+            }
+
+            for (uint64 i = low; i < r->Count; i++) {
+                const byte* e = entries + EntrySize * i;
+                if (read_little(e, 8) != p) break;
+                entry x{read_little(e + 8, 6), static_cast<uint32>(read_little(e + 14, 4))};
+                if (verify(x)) return x;
+            }
+        }
+
+        return {};
+    }
+
+}
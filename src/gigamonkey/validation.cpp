@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/validation.hpp>
+#include <unordered_map>
+
+namespace Gigamonkey::Bitcoin {
+
+    namespace {
+
+        // a transaction together with the outputs that its inputs redeem.
+        struct spend {
+            bytes_view Transaction;
+            list<output> Redeemed;
+        };
+
+        outpoint previous(bytes_view input) {
+            outpoint o{};
+            o.read(bytes_reader{input.data(), input.data() + 36});
+            return o;
+        }
+
+        output read_output(bytes_view b) {
+            output o{};
+            o.read(bytes_reader{b.data(), b.data() + b.size()});
+            return o;
+        }
+
+        script_validation fail(script_validation::status s, uint32 tx, uint32 in) {
+            script_validation v{};
+            v.Status = s;
+            v.Transaction = tx;
+            v.Input = in;
+            return v;
+        }
+
+        script_validation run(const std::vector<spend>& spends, thread_pool& pool) {
+            std::vector<ptr<evaluation_context>> contexts(spends.size());
+            pool.run(spends.size(), [&spends, &contexts](uint32 t) {
+                contexts[t] = std::make_shared<evaluation_context>(spends[t].Transaction, spends[t].Redeemed);
+            });
+
+            script_validation v{};
+            v.Errors.resize(spends.size());
+            std::vector<std::pair<uint32, uint32>> inputs{};
+            for (uint32 t = 0; t < spends.size(); t++) {
+                if (!contexts[t]->valid()) return fail(script_validation::invalid_transaction, t, 0);
+                v.Errors[t] = std::vector<ScriptError>(contexts[t]->inputs(), SCRIPT_ERR_UNKNOWN_ERROR);
+                for (uint32 i = 0; i < contexts[t]->inputs(); i++) inputs.emplace_back(t, i);
+            }
+
+            std::atomic<bool> failed{false};
+            std::mutex first;
+            pool.run(inputs.size(), [&](uint32 j) {
+                if (failed) return;
+                uint32 t = inputs[j].first;
+                uint32 i = inputs[j].second;
+                evaluated e = contexts[t]->evaluate(index{i});
+                // evaluations that were cancelled return nothing.
+                if (e.valid() && !e.Return) return;
+                v.Errors[t][i] = e.Error;
+                if (e.valid()) return;
+
+                std::lock_guard<std::mutex> lock(first);
+                if (failed) return;
+                failed = true;
+                v.Status = script_validation::invalid_script;
+                v.Transaction = t;
+                v.Input = i;
+                for (ptr<evaluation_context>& c : contexts) c->cancel();
+            });
+
+            return v;
+        }
+
+    }
+
+    script_validation validate(const vertex& v, thread_pool& pool) {
+        list<output> redeemed{};
+        for (list<prevout> p = v.Previous; !p.empty(); p = p.rest()) redeemed = redeemed << p.first().Output;
+        bytes tx = v.Transaction.write();
+        return run(std::vector<spend>{spend{tx, redeemed}}, pool);
+    }
+
+    script_validation validate_transaction(bytes_view tx, const prevout_provider& find, thread_pool& pool) {
+        cross<bytes_view> inputs = Gigamonkey::transaction::inputs(tx);
+        if (inputs.size() == 0) return fail(script_validation::invalid_transaction, 0, 0);
+
+        list<output> redeemed{};
+        for (uint32 i = 0; i < inputs.size(); i++) {
+            std::optional<output> o = find(previous(inputs[i]));
+            if (!o) return fail(script_validation::missing_prevout, 0, i);
+            redeemed = redeemed << *o;
+        }
+
+        return run(std::vector<spend>{spend{tx, redeemed}}, pool);
+    }
+
+    script_validation validate_block(bytes_view block, const prevout_provider& find, thread_pool& pool) {
+        cross<bytes_view> txs = Gigamonkey::block::transactions(block);
+        if (txs.size() == 0) return fail(script_validation::invalid_transaction, 0, 0);
+
+        std::vector<txid> ids(txs.size());
+        std::vector<cross<bytes_view>> inputs(txs.size());
+        std::vector<cross<bytes_view>> outputs(txs.size());
+        pool.run(txs.size(), [&](uint32 t) {
+            ids[t] = Gigamonkey::transaction::txid(txs[t]);
+            inputs[t] = Gigamonkey::transaction::inputs(txs[t]);
+            outputs[t] = Gigamonkey::transaction::outputs(txs[t]);
+        });
+
+        std::unordered_map<txid, uint32> positions{};
+        for (uint32 t = 0; t < txs.size(); t++) positions[ids[t]] = t;
+
+        std::vector<spend> spends{};
+        spends.reserve(txs.size() - 1);
+        for (uint32 t = 1; t < txs.size(); t++) {
+            list<output> redeemed{};
+            for (uint32 i = 0; i < inputs[t].size(); i++) {
+                outpoint o = previous(inputs[t][i]);
+                auto p = positions.find(o.Reference);
+                if (p != positions.end() && p->second < t) {
+                    if (uint32(o.Index) >= outputs[p->second].size()) return fail(script_validation::missing_prevout, t, i);
+                    redeemed = redeemed << read_output(outputs[p->second][uint32(o.Index)]);
+                    continue;
+                }
+
+                std::optional<output> x = find(o);
+                if (!x) return fail(script_validation::missing_prevout, t, i);
+                redeemed = redeemed << *x;
+            }
+            spends.push_back(spend{txs[t], redeemed});
+        }
+
+        script_validation v = run(spends, pool);
+        // put back the coinbase.
+        if (!v.valid()) v.Transaction++;
+        v.Errors.insert(v.Errors.begin(), std::vector<ScriptError>(inputs[0].size(), SCRIPT_ERR_OK));
+        return v;
+    }
+
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#ifndef GIGAMONKEY_BENCH
+#define GIGAMONKEY_BENCH
+
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace Gigamonkey::bench {
+
+    struct benchmark {
+        std::string Name;
+        std::function<void()> Run;
+    };
+
+    inline std::vector<benchmark>& benchmarks() {
+        static std::vector<benchmark> Benchmarks{};
+        return Benchmarks;
+    }
+
+    struct registrar {
+        registrar(std::string name, std::function<void()> run) {
+            benchmarks().push_back(benchmark{name, run});
+        }
+    };
+
+    // run f and print how long it took.
+    template <typename F>
+    auto time(const std::string& what, F f) -> decltype(f()) {
+        auto start = std::chrono::steady_clock::now();
+        struct report {
+            const std::string& What;
+            std::chrono::steady_clock::time_point Start;
+            ~report() {
+                auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - Start).count();
+                std::cout << "    " << What << ": " << elapsed / 1000.0 << " ms" << std::endl;
+            }
+        } r{what, start};
+        return f();
+    }
+
+}
+
+#define GIGAMONKEY_BENCHMARK(name) \
+    static void bench_##name(); \
+    static Gigamonkey::bench::registrar bench_registrar_##name{#name, bench_##name}; \
+    static void bench_##name()
+
+#endif
@@ -0,0 +1,69 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/boost/boost.hpp>
+#include <gigamonkey/boost/solver.hpp>
+#include "bench.hpp"
+
+GIGAMONKEY_BENCHMARK(boost_scan) {
+    using namespace Gigamonkey;
+    using namespace Gigamonkey::Bitcoin;
+
+    // the outputs of a block, one in ten of which are Boost scripts.
+    const uint32 size = 100000;
+    std::vector<bytes> scripts = bench::time("make 100k output scripts", [size]() {
+        std::vector<bytes> scripts{};
+        scripts.reserve(size);
+        for (uint32 i = 0; i < size; i++) {
+            if (i % 10 == 0) scripts.push_back(Boost::output_script::bounty(int32_little{1}, uint256{i}, 
+                work::target{32, 0x0080ff}, bytes(i % 21), uint32_little{i}, bytes(i % 200)).write());
+            else scripts.push_back(pay_to_address::script(hash160(bytes(i % 40))));
+        }
+        return scripts;
+    });
+
+    uint32 matched = bench::time("match with the pattern matcher", [&scripts]() {
+        uint32 n = 0;
+        bytes_view x[7];
+        for (const bytes& b : scripts)
+            if (Boost::output_script::compiled().match(b, x) == matcher::success &&
+                Boost::output_script::from_captures(x).valid()) n++;
+        return n;
+    });
+
+    uint32 viewed = bench::time("read with output_script_view", [&scripts]() {
+        uint32 n = 0;
+        for (const bytes& b : scripts) if (Boost::output_script_view::read(b).valid()) n++;
+        return n;
+    });
+
+    uint32 read = bench::time("output_script::read", [&scripts]() {
+        uint32 n = 0;
+        for (const bytes& b : scripts) if (Boost::output_script::read(b).valid()) n++;
+        return n;
+    });
+
+    if (matched != size / 10 || viewed != matched || read != matched)
+        std::cout << "    found the wrong number of Boost scripts!" << std::endl;
+}
+
+GIGAMONKEY_BENCHMARK(boost_merkle_roots) {
+    using namespace Gigamonkey;
+
+    const uint32 size = 100000;
+    Boost::puzzle puzzle{Boost::bounty, int32_little{1}, uint256{1}, work::target{32, 0x0080ff},
+        bytes(20), uint32_little{0}, bytes(100), digest160{}, uint32_little{0}};
+
+    digest256 slow = bench::time("100k roots with proof::merkle_root", [&puzzle, size]() {
+        digest256 d{};
+        for (uint32 i = 0; i < size; i++) d = work::proof{puzzle, work::solution{timestamp{1}, 0, uint64_little{i}}}.merkle_root();
+        return d;
+    });
+
+    Boost::solver solver{puzzle};
+    std::vector<digest256> fast = bench::time("100k roots with solver::merkle_roots", [&solver, size]() {
+        return solver.merkle_roots(0, size);
+    });
+
+    if (fast.back() != slow) std::cout << "    the Merkle roots do not match!" << std::endl;
+}
@@ -0,0 +1,54 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/headers.hpp>
+#include <gigamonkey/work/string.hpp>
+#include "bench.hpp"
+
+namespace Gigamonkey::Bitcoin {
+
+    // a chain of headers at the lowest possible difficulty.
+    header_store synthetic_store(uint32 size) {
+        header_store store{};
+        store.reserve(size);
+        digest256 p{};
+        for (uint32 i = 0; i < size; i++) {
+            header h{int32_little{1}, p, digest256{uint256{uint64(i) + 1}},
+                timestamp{uint32_little{1231006505 + 600 * i}}, work::target{0x207fffff}, uint32_little{0}};
+            while (!work::string::valid(h.write())) h.Nonce++;
+            p = h.hash();
+            store.append(h.write());
+        }
+        return store;
+    }
+
+}
+
+GIGAMONKEY_BENCHMARK(checkpoint) {
+    using namespace Gigamonkey;
+    using namespace Gigamonkey::Bitcoin;
+
+    const uint32 size = 1000000;
+    header_store store = bench::time("build synthetic chain of 1M headers", [size]() {
+        return synthetic_store(size);
+    });
+
+    checkpoint c = bench::time("make checkpoint", [&store]() {
+        return checkpoint::make(store);
+    });
+
+    bytes b = bench::time("write checkpoint", [&c]() {
+        return c.write();
+    });
+    std::cout << "    checkpoint size: " << b.size() << " bytes" << std::endl;
+
+    checkpoint d = bench::time("read checkpoint", [&b]() {
+        return checkpoint::read(b);
+    });
+
+    header_store loaded = bench::time("load store from checkpoint", [&d]() {
+        return d.load();
+    });
+
+    if (d != c || loaded.tip() != store.tip()) std::cout << "    checkpoint did not round trip!" << std::endl;
+}
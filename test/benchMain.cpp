@@ -0,0 +1,16 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include "bench.hpp"
+
+// run every benchmark, or only those named on the command line.
+int main(int argc, char** argv) {
+    for (const auto& b : Gigamonkey::bench::benchmarks()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++) if (b.Name == argv[i]) selected = true;
+        if (!selected) continue;
+        std::cout << b.Name << std::endl;
+        b.Run();
+    }
+    return 0;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/script.hpp>
+#include "bench.hpp"
+
+namespace Gigamonkey::Bitcoin {
+
+    // a program of the given number of instructions, 
+    // a third of which are pushes of various sizes.
+    program synthetic_program(uint32 size) {
+        program p{};
+        for (uint32 i = 0; i < size; i++) {
+            if (i % 3 != 0) p = p << instruction{i % 3 == 1 ? OP_DUP : OP_DROP};
+            else {
+                bytes data(i % 2 == 0 ? 20 : 300);
+                std::fill(data.begin(), data.end(), static_cast<byte>(i));
+                p = p << instruction{data};
+            }
+        }
+        return p;
+    }
+
+}
+
+GIGAMONKEY_BENCHMARK(compile) {
+    using namespace Gigamonkey;
+    using namespace Gigamonkey::Bitcoin;
+
+    const uint32 size = 10000;
+    program p = bench::time("build program of 10k instructions", [size]() {
+        return synthetic_program(size);
+    });
+
+    size_t expected = bench::time("length", [&p]() {
+        return length(p);
+    });
+    std::cout << "    script size: " << expected << " bytes" << std::endl;
+
+    bytes script = bench::time("compile", [&p]() {
+        return compile(p);
+    });
+
+    bytes appended = bench::time("compile 100 times into one buffer", [&p]() {
+        bytes b{};
+        for (int i = 0; i < 100; i++) compile(p, b);
+        return b;
+    });
+
+    program q = bench::time("decompile", [&script]() {
+        return decompile(script);
+    });
+
+    if (script.size() != expected || appended.size() != 100 * expected || length(q) != expected)
+        std::cout << "    compiled script has the wrong size!" << std::endl;
+
+    // a single very large push, as in a big Boost script.
+    bytes data(1 << 24);
+    bytes large = bench::time("compile a 16MB push", [&data]() {
+        return compile(program{} << instruction{data} << OP_DROP);
+    });
+    if (large.size() != data.size() + 6) std::cout << "    compiled push has the wrong size!" << std::endl;
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/codec.hpp>
+#include "bench.hpp"
+
+GIGAMONKEY_BENCHMARK(stratum_submit) {
+    using namespace Gigamonkey;
+    using namespace Gigamonkey::Stratum;
+
+    const uint32 size = 100000;
+    std::vector<share> shares{};
+    shares.reserve(size);
+    for (uint32 i = 0; i < size; i++) shares.push_back(share{i, "worker." + std::to_string(i % 100), i % 16,
+        uint64_little{uint64(i) * 0x0101010101}, timestamp{uint32_little{1600000000 + i}}, Gigamonkey::nonce{i * 7}});
+
+    std::vector<std::string> slow_lines = bench::time("write 100k shares with to_json", [&shares]() {
+        std::vector<std::string> lines{};
+        lines.reserve(shares.size());
+        for (const share& x : shares) {
+            json j;
+            to_json(j, x);
+            lines.push_back(j.dump() + "\n");
+        }
+        return lines;
+    });
+
+    std::vector<char> buffer(size * codec::size(shares.back()));
+    char* end = bench::time("write 100k shares with the codec", [&shares, &buffer]() {
+        char* o = buffer.data();
+        for (const share& x : shares) o = codec::write(o, x);
+        return o;
+    });
+
+    uint32 slow = bench::time("read 100k shares with from_json", [&slow_lines]() {
+        uint32 n = 0;
+        for (const std::string& line : slow_lines) {
+            share x;
+            from_json(json::parse(line), x);
+            if (x.valid()) n++;
+        }
+        return n;
+    });
+
+    uint32 fast = bench::time("read 100k shares with the codec", [&slow_lines]() {
+        uint32 n = 0;
+        share x;
+        for (const std::string& line : slow_lines) if (codec::read(line, x)) n++;
+        return n;
+    });
+
+    size_t written = 0;
+    for (const std::string& line : slow_lines) written += line.size();
+    if (slow != size || fast != size || written != static_cast<size_t>(end - buffer.data()))
+        std::cout << "    the codec does not agree with json!" << std::endl;
+}
+
+GIGAMONKEY_BENCHMARK(stratum_notify) {
+    using namespace Gigamonkey;
+    using namespace Gigamonkey::Stratum;
+
+    // a job with a Merkle branch of 12 hashes.
+    list<digest256> path{};
+    for (uint32 i = 0; i < 12; i++) path = path << digest256{uint256{i + 1}};
+    notify n{1, uint256{2}, bytes(100), bytes(60), path, int32_little{0x20000000},
+        work::target{0x1d, 0x00ffff}, timestamp{uint32_little{1600000000}}, true};
+
+    const uint32 size = 100000;
+    std::string slow = bench::time("write 100k notifies with to_json", [&n, size]() {
+        std::string line;
+        for (uint32 i = 0; i < size; i++) {
+            json j;
+            to_json(j, n);
+            line = j.dump() + "\n";
+        }
+        return line;
+    });
+
+    std::string fast = bench::time("write 100k notifies with the codec", [&n, size]() {
+        std::string line(codec::size(n), '\0');
+        for (uint32 i = 0; i < size; i++) codec::write(line.data(), n);
+        return line;
+    });
+
+    bool read = bench::time("read 100k notifies with from_json", [&slow, size]() {
+        notify x;
+        for (uint32 i = 0; i < size; i++) from_json(json::parse(slow), x);
+        return x.valid();
+    });
+
+    bool decoded = bench::time("read 100k notifies with the codec", [&fast, size]() {
+        notify x;
+        bool ok = true;
+        for (uint32 i = 0; i < size; i++) ok = codec::read(fast, x) && ok;
+        return ok;
+    });
+
+    if (slow != fast || !read || !decoded) std::cout << "    the codec does not agree with json!" << std::endl;
+}
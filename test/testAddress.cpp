@@ -11,6 +11,7 @@
 #include <gigamonkey/address.hpp>
 #include <gigamonkey/signature.hpp>
 #include <gigamonkey/script.hpp>
+#include <gigamonkey/script_profile.hpp>
 #include "gtest/gtest.h"
 #include <iostream>
 
@@ -67,6 +68,12 @@ namespace Gigamonkey::Bitcoin {
         
         EXPECT_FALSE(evaluate_script(redeem_p2pkh_compressed, script_p2pkh_uncompressed).valid());
         
+        // the same with a profile.
+        script_profile profile{};
+        for (const bytes& unlock : {redeem_p2pk, redeem_p2pkh_compressed, redeem_p2pkh_uncompressed}) 
+            for (const bytes& lock : {script_p2pk_compressed, script_p2pk_uncompressed, script_p2pkh_compressed, script_p2pkh_uncompressed})
+                EXPECT_EQ(evaluate_script(unlock, lock, profile), evaluate_script(unlock, lock));
+        
     }
 
 }
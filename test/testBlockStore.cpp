@@ -0,0 +1,160 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/block_store.hpp>
+#include <gigamonkey/work/string.hpp>
+#include <cstdio>
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+
+    bytes copy(bytes_view v) {
+        bytes b(v.size());
+        std::copy(v.begin(), v.end(), b.begin());
+        return b;
+    }
+
+    // A block with some meaningless transactions in it.
+    bytes synthetic_block(uint32 seed, uint32 txs, const digest256& previous) {
+        std::vector<bytes> transactions{};
+        list<digest256> ids{};
+        for (uint32 i = 0; i < txs; i++) {
+            input in{outpoint{digest256{uint256{uint64(seed) * 1000 + i + 1}}, index{i}},
+                bytes(i + 1, byte(seed)), uint32_little{0xffffffff}};
+            output out{satoshi(1000 + i), bytes(25 + i, byte(i))};
+            bytes tx = transaction{list<input>{} << in, list<output>{} << out, int32_little{0}}.write();
+            ids = ids << Gigamonkey::transaction::txid(tx);
+            transactions.push_back(tx);
+        }
+
+        header h{int32_little{1}, previous, Merkle::root(ids),
+            timestamp{uint32_little{1231006505 + 600 * seed}}, work::target{0x207fffff}, uint32_little{0}};
+        while (!work::string::valid(h.write())) h.Nonce++;
+
+        size_t size = 80 + var_int_size(txs);
+        for (const bytes& tx : transactions) size += tx.size();
+        bytes b(size);
+        bytes_writer w{b.begin(), b.end()};
+        w = write_var_int(w << h, txs);
+        for (const bytes& tx : transactions) w = w << bytes_view{tx};
+        return b;
+    }
+
+    TEST(BlockStoreTest, TestBlockStore) {
+        std::string path = testing::TempDir() + "testBlockStore.dat";
+        std::string copy_path = testing::TempDir() + "testBlockStoreCopy.dat";
+        for (const std::string& f : {path, copy_path, path + ".txids", copy_path + ".txids"}) std::remove(f.c_str());
+
+        std::vector<bytes> blocks{};
+        digest256 previous{};
+        for (uint32 i = 0; i < 5; i++) {
+            blocks.push_back(synthetic_block(i, i + 1, previous));
+            previous = Gigamonkey::header::hash(Gigamonkey::block::header(blocks.back()));
+        }
+
+        {
+            block_store store{path};
+            ASSERT_TRUE(store.valid());
+            for (const bytes& b : blocks) EXPECT_TRUE(store.add(b));
+            // a block that does not connect.
+            EXPECT_FALSE(store.add(blocks[2]));
+            EXPECT_EQ(store.height(), 4);
+        }
+
+        block_store store{path};
+        ASSERT_EQ(store.size(), 5);
+
+        for (uint32 i = 0; i < blocks.size(); i++) {
+            const slice<80> h = Gigamonkey::block::header(blocks[i]);
+            digest256 hash = Gigamonkey::header::hash(h);
+            digest256 root = Gigamonkey::header::merkle_root(h);
+
+            EXPECT_EQ(store.block(hash), blocks[i]);
+            EXPECT_EQ(store.block(root), blocks[i]);
+            EXPECT_EQ(Bitcoin::header{slice<80>(store.header(root).data())}, Bitcoin::header{h});
+
+            cross<bytes_view> txs = Gigamonkey::block::transactions(blocks[i]);
+            ASSERT_EQ(txs.size(), i + 1);
+            list<txid> ids = store.transactions(hash);
+            EXPECT_EQ(ids.size(), txs.size());
+
+            for (uint32 j = 0; j < txs.size(); j++) {
+                txid id = Gigamonkey::transaction::txid(txs[j]);
+                EXPECT_EQ(ids.first(), id);
+                ids = ids.rest();
+                EXPECT_EQ(store.transaction(id), copy(txs[j]));
+                Merkle::path p = store.merkle_path(id);
+                EXPECT_EQ(p.Index, j);
+                EXPECT_TRUE(p.check(root, id));
+            }
+        }
+
+        EXPECT_EQ(store.transaction(digest256{uint256{1}}), bytes{});
+
+        // the file we have been writing is in the same format as those written by a node.
+        block_store ingested{copy_path};
+        EXPECT_EQ(ingested.ingest(path), 5);
+        EXPECT_EQ(ingested.chain().tip(), store.chain().tip());
+
+        for (const std::string& f : {path, copy_path, path + ".txids", copy_path + ".txids"}) std::remove(f.c_str());
+    }
+
+    TEST(BlockStoreTest, TestTxidIndex) {
+        std::string path = testing::TempDir() + "testTxidIndex.txids";
+        std::remove(path.c_str());
+
+        auto id = [](uint64 i) -> txid {
+            return Bitcoin::hash256(write(8, uint64_little{i}));
+        };
+
+        auto entry_of = [](uint64 i) -> txid_index::entry {
+            return txid_index::entry{i * 1000, static_cast<uint32>(i % 5000 + 60)};
+        };
+
+        auto is = [](const txid_index::entry& x) {
+            return [x](const txid_index::entry& e) -> bool {
+                return e.Offset == x.Offset && e.Size == x.Size;
+            };
+        };
+
+        const uint64 count = 3 * txid_index::RunSize + 1234;
+        {
+            txid_index index{path};
+            ASSERT_TRUE(index.valid());
+            for (uint64 i = 0; i < count; i++) {
+                index.add(id(i), entry_of(i));
+                if (i % 1000 == 999) index.commit(i + 1);
+            }
+            EXPECT_EQ(index.size(), count);
+            EXPECT_TRUE(bool(index.find(id(17), is(entry_of(17)))));
+            EXPECT_FALSE(bool(index.find(id(count), [](const txid_index::entry&) -> bool {
+                return true;
+            })));
+        }
+
+        txid_index index{path};
+        EXPECT_EQ(index.size(), count);
+        EXPECT_EQ(index.through(), count - count % 1000);
+        // runs are merged as they are written.
+        EXPECT_LE(index.runs(), 3);
+
+        for (uint64 i = 0; i < count; i += 97) {
+            auto e = index.find(id(i), is(entry_of(i)));
+            ASSERT_TRUE(bool(e));
+            EXPECT_EQ(e->Offset, entry_of(i).Offset);
+        }
+
+        // two txids which share a prefix.
+        txid a = id(count + 1);
+        txid b = a;
+        b.Value[31] ^= 1;
+        index.add(a, txid_index::entry{1, 1});
+        index.add(b, txid_index::entry{2, 2});
+        index.flush();
+        EXPECT_EQ(index.find(b, is(txid_index::entry{2, 2}))->Size, 2);
+        EXPECT_EQ(index.find(a, is(txid_index::entry{1, 1}))->Size, 1);
+
+        std::remove(path.c_str());
+    }
+
+}
@@ -1,8 +1,14 @@
 #include <gigamonkey/boost/boost.hpp>
+#include <gigamonkey/boost/job_index.hpp>
+#include <gigamonkey/boost/scheduler.hpp>
+#include <gigamonkey/boost/solver.hpp>
+#include <gigamonkey/boost/redeem.hpp>
 #include <gigamonkey/script.hpp>
+#include <gigamonkey/script_profile.hpp>
 #include <gigamonkey/address.hpp>
 #include <gigamonkey/wif.hpp>
 #include <gigamonkey/stratum/stratum.hpp>
+#include <gigamonkey/stratum/verify.hpp>
 
 #include "gtest/gtest.h"
 
@@ -196,7 +202,9 @@ namespace Gigamonkey::Boost {
                 return {"could not serialize and deserialize input scripts."};
             
             if (!dot_cross([](bytes_view in, bytes_view out) {
-                    return Bitcoin::evaluate_script(in, out).valid();
+                    Bitcoin::evaluated e = Bitcoin::evaluate_script(in, out);
+                    Bitcoin::script_profile profile{};
+                    return e.valid() && Bitcoin::evaluate_script(in, out, profile) == e;
                 }, serialized_input_scripts.rest(), serialized_output_scripts.rest())) 
                 return {"Boost scripts are not valid."};
             
@@ -422,4 +430,238 @@ namespace Gigamonkey {
         EXPECT_TRUE(r.Success);
     }
 
+    TEST(BoostTest, TestOutputScriptView) {
+        const uint256 Content{77};
+        const work::target Target{32, 0x0080ff};
+        const digest160 Miner = Bitcoin::hash160(std::string{"miner"});
+
+        for (size_t data_size : {0, 20, 100, 300}) for (size_t tag_size : {0, 1, 20}) {
+            bytes tag(tag_size);
+            bytes data(data_size);
+            std::fill(data.begin(), data.end(), 0x33);
+
+            for (const Boost::output_script& o : {
+                Boost::output_script::bounty(int32_little{1}, Content, Target, tag, uint32_little{7}, data),
+                Boost::output_script::contract(int32_little{2}, Content, Target, tag, uint32_little{7}, data, Miner)}) {
+                bytes script = o.write();
+
+                // the same as what the pattern matcher finds.
+                bytes_view x[7];
+                ASSERT_EQ(Boost::output_script::compiled().match(script, x), Bitcoin::matcher::success);
+                EXPECT_EQ(Boost::output_script::from_captures(x), o);
+
+                Boost::output_script_view v = Boost::output_script_view::read(script);
+                ASSERT_TRUE(v.valid());
+                EXPECT_EQ(v.Type, o.Type);
+                EXPECT_EQ(v.Tag, bytes_view{tag});
+                EXPECT_EQ(v.AdditionalData, bytes_view{data});
+                EXPECT_EQ(Boost::output_script(v), o);
+                EXPECT_EQ(Boost::output_script::read(script), o);
+                EXPECT_EQ(Boost::output_script::content(script), Content);
+                EXPECT_EQ(Boost::output_script::target(script), Target);
+                EXPECT_EQ(Boost::output_script::miner_address(script), o.MinerAddress);
+
+                // a change anywhere in the part that is always the same.
+                script[script.size() - 10] ^= 1;
+                EXPECT_FALSE(Boost::output_script_view::read(script).valid());
+                EXPECT_FALSE(Boost::output_script::read(bytes_view{script}.substr(0, script.size() - 1)).valid());
+            }
+        }
+
+        EXPECT_FALSE(Boost::output_script::valid(Bitcoin::pay_to_address::script(Miner)));
+        EXPECT_FALSE(Boost::output_script::valid(bytes{}));
+    }
+
+    TEST(BoostTest, TestJobIndex) {
+        const bytes Tag{std::string{"tag"}};
+        const digest256 Funding{uint256{5}};
+
+        auto job = [&Tag](uint32 content, byte exponent) -> Bitcoin::output {
+            return Bitcoin::output{satoshi{1000}, Boost::output_script::bounty(int32_little{1}, uint256{content},
+                work::target{exponent, 0x0080ff}, Tag, uint32_little{0}, bytes{}).write()};
+        };
+
+        // a transaction with three jobs and an ordinary output.
+        bytes first = Bitcoin::transaction{list<Bitcoin::input>{} << Bitcoin::input{Bitcoin::outpoint{Funding, index{0}}, bytes{}, uint32_little{0}},
+            list<Bitcoin::output>{} << job(1, 32) << Bitcoin::output{satoshi{1000}, Bitcoin::pay_to_address::script(digest160{})}
+                << job(2, 31) << job(2, 30), int32_little{0}}.write();
+        Bitcoin::txid first_id = Gigamonkey::transaction::txid(first);
+
+        Boost::job_index jobs{};
+        EXPECT_EQ(jobs.add_transaction(first), 3);
+        EXPECT_EQ(jobs.size(), 3);
+        EXPECT_FALSE(jobs.find(Bitcoin::outpoint{first_id, index{1}}).has_value());
+        ASSERT_TRUE(jobs.find(Bitcoin::outpoint{first_id, index{2}}).has_value());
+        EXPECT_EQ(jobs.find(Bitcoin::outpoint{first_id, index{2}})->Output.Script.Content, uint256{2});
+
+        EXPECT_EQ(jobs.by_content(uint256{2}).size(), 2);
+        EXPECT_EQ(jobs.by_category(int32_little{1}).size(), 3);
+        EXPECT_EQ(jobs.by_tag(Tag).size(), 3);
+        EXPECT_EQ(jobs.by_tag(bytes{}).size(), 0);
+
+        // higher exponents are easier.
+        std::vector<Boost::job_index::job> all = jobs.by_difficulty(0, 1e30);
+        ASSERT_EQ(all.size(), 3);
+        EXPECT_LT(all[0].Difficulty, all[1].Difficulty);
+        EXPECT_EQ(all[0].Output.Reference, (Bitcoin::outpoint{first_id, index{0}}));
+        EXPECT_EQ(jobs.by_difficulty(all[1].Difficulty, all[1].Difficulty).size(), 1);
+
+        // spending a job removes it.
+        bytes second = Bitcoin::transaction{list<Bitcoin::input>{} << Bitcoin::input{Bitcoin::outpoint{first_id, index{3}}, bytes{}, uint32_little{0}},
+            list<Bitcoin::output>{} << Bitcoin::output{satoshi{900}, Bitcoin::pay_to_address::script(digest160{})}, int32_little{0}}.write();
+        EXPECT_EQ(jobs.add_transaction(second), 0);
+        EXPECT_EQ(jobs.size(), 2);
+        EXPECT_EQ(jobs.by_content(uint256{2}).size(), 1);
+        EXPECT_EQ(jobs.by_difficulty(0, 1e30).size(), 2);
+        EXPECT_FALSE(jobs.remove(Bitcoin::outpoint{first_id, index{3}}));
+    }
+
+    TEST(BoostTest, TestScheduler) {
+        const digest256 Funding{uint256{5}};
+
+        // the same target with different values, and a harder target.
+        auto job = [&Funding](uint32 i, satoshi value, byte exponent) -> Boost::output {
+            return Boost::output{Bitcoin::outpoint{Funding, index{i}}, Boost::output_script::bounty(int32_little{1}, uint256{i},
+                work::target{exponent, 0x0080ff}, bytes{}, uint32_little{0}, bytes{}), value};
+        };
+
+        Boost::scheduler s{100};
+        s.add(job(0, 1000, 32));
+        s.add(job(1, 3000, 32));
+        s.add(job(2, 2000, 32));
+        s.add(job(3, 1000000, 31));
+        EXPECT_EQ(s.size(), 4);
+
+        std::vector<Boost::scheduler::job> best = s.best(4);
+        ASSERT_EQ(best.size(), 4);
+        for (int i = 1; i < 4; i++) EXPECT_GE(best[i - 1].Profitability, best[i].Profitability);
+        EXPECT_EQ(best[0].Output.Reference.Index, 3);
+        EXPECT_EQ(best[1].Output.Reference.Index, 1);
+
+        // a claimed job is not given out again until it is released.
+        std::optional<Boost::scheduler::job> a = s.claim();
+        std::optional<Boost::scheduler::job> b = s.claim();
+        ASSERT_TRUE(a.has_value() && b.has_value());
+        EXPECT_EQ(a->Output.Reference.Index, 3);
+        EXPECT_EQ(b->Output.Reference.Index, 1);
+        EXPECT_EQ(s.claimed(), 2);
+        EXPECT_TRUE(s.release(a->Output.Reference));
+        EXPECT_FALSE(s.release(a->Output.Reference));
+        EXPECT_EQ(s.claim()->Output.Reference.Index, 3);
+
+        // a job that is claimed can still be removed when it is spent.
+        EXPECT_TRUE(s.remove(b->Output.Reference));
+        EXPECT_EQ(s.size(), 3);
+
+        // a job that pays less than the fee is worth nothing.
+        s.set_fee(1500);
+        best = s.best(4);
+        ASSERT_EQ(best.size(), 2);
+        EXPECT_EQ(best[0].Output.Reference.Index, 2);
+        EXPECT_LT(best[1].Profitability, 0);
+        EXPECT_EQ(s.claim(0)->Output.Reference.Index, 2);
+        EXPECT_FALSE(s.claim(0).has_value());
+        EXPECT_EQ(s.claimed(), 2);
+    }
+
+    TEST(BoostTest, TestSolver) {
+        // a tag and data that make the metadata document longer than a block.
+        Boost::puzzle puzzle{Boost::bounty, int32_little{1}, uint256{7}, work::target{0x207fffff},
+            bytes(13, 0x0a), uint32_little{99}, bytes(75, 0x0b), digest160{uint160{3}}, uint32_little{12345}};
+        Boost::solver solver{puzzle};
+        ASSERT_TRUE(solver.valid());
+
+        std::vector<digest256> roots = solver.merkle_roots(1000, 20);
+        ASSERT_EQ(roots.size(), 20);
+        for (uint32 i = 0; i < 20; i++) {
+            digest256 expected = work::proof{puzzle, work::solution{timestamp{1}, 0, uint64_little{1000 + i}}}.merkle_root();
+            EXPECT_EQ(roots[i], expected);
+            EXPECT_EQ(solver.merkle_root(uint64_little{1000 + i}), expected);
+        }
+
+        // about half of all nonces work with this target.
+        std::optional<work::solution> x = solver.solve(work::solution{timestamp{1}, 0, uint64_little{1000}}, 100);
+        ASSERT_TRUE(x.has_value());
+        EXPECT_TRUE(solver.proof(*x).valid());
+        EXPECT_EQ(*x, work::cpu_solve(puzzle, work::solution{timestamp{1}, 0, uint64_little{1000}}).Solution);
+    }
+
+    TEST(BoostTest, TestVerify) {
+        // two puzzles for each of two workers, with about half of
+        // all shares valid.
+        std::vector<Stratum::job> jobs{};
+        for (uint32 i = 0; i < 2; i++) for (uint32 w = 0; w < 2; w++) {
+            Boost::puzzle puzzle{Boost::bounty, int32_little{1}, uint256{i}, work::target{0x207fffff},
+                bytes(i * 30, 0x0a), uint32_little{i}, bytes(i * 50, 0x0b), digest160{uint160{w}}, uint32_little{w}};
+            jobs.push_back(Stratum::job{i, puzzle, Stratum::worker{"worker", uint32_little{w}}, timestamp{1}, false});
+        }
+
+        std::vector<Stratum::solved> submitted{};
+        for (uint32 n = 0; n < 40; n++) submitted.push_back(Stratum::solved{jobs[n % 4],
+            Stratum::share{n, "worker", jobs[n % 4].Notify.ID, uint64_little{n / 3}, timestamp{1}, nonce{n}}});
+
+        std::vector<Stratum::verdict> verdicts = Stratum::verify(submitted);
+        ASSERT_EQ(verdicts.size(), submitted.size());
+        uint32 valid = 0;
+        for (uint32 n = 0; n < submitted.size(); n++) {
+            work::proof p = submitted[n].proof();
+            EXPECT_EQ(verdicts[n].Valid, p.valid());
+            EXPECT_DOUBLE_EQ(verdicts[n].Difficulty, work::hash_difficulty(p.string().hash()));
+            if (verdicts[n].Valid) valid++;
+        }
+        EXPECT_GT(valid, 0);
+        EXPECT_LT(valid, submitted.size());
+
+        // shares of one job.
+        std::vector<Stratum::share> shares{};
+        for (uint32 n = 0; n < 11; n++) shares.push_back(submitted[4 * n % 40].Share);
+        std::vector<Stratum::verdict> one = Stratum::verify(jobs[0], shares);
+        ASSERT_EQ(one.size(), 11);
+        for (uint32 n = 0; n < 11; n++) EXPECT_EQ(one[n].Valid, verdicts[4 * n % 40].Valid);
+
+        // nothing is valid for an invalid job.
+        EXPECT_FALSE(Stratum::verify(Stratum::job{}, shares)[0].Valid);
+    }
+
+    TEST(BoostTest, TestBulkRedeem) {
+        Bitcoin::secret key(Bitcoin::secret::main, secp256k1::secret(secp256k1::coordinate(12345)));
+        digest160 miner = key.address().Digest;
+        digest160 pay_to{uint160{77}};
+        const double fee_rate = 0.5;
+
+        // bounties and contracts with different tags and data.
+        std::vector<solved_output> solved{};
+        list<Bitcoin::output> prevouts{};
+        for (uint32 i = 0; i < 12; i++) {
+            Boost::puzzle puzzle{i % 2 == 0 ? Boost::bounty : Boost::contract, int32_little{1}, uint256{i}, work::target{0x207fffff},
+                bytes(i, 0x0a), uint32_little{i}, bytes(2 * i, 0x0b), miner, uint32_little{i}};
+            Boost::proof proof{puzzle, work::cpu_solve(puzzle, work::solution{timestamp{1}, 0, uint64_little{i}}).Solution};
+            solved.push_back(solved_output{Bitcoin::outpoint{digest256{uint256{9}}, index{i}}, satoshi{10000}, proof});
+            prevouts = prevouts << Bitcoin::output{satoshi{10000}, proof.output_script().write()};
+        }
+
+        bytes tx = redeem(solved, key, pay_to, fee_rate);
+        ASSERT_NE(tx.size(), 0);
+        Bitcoin::transaction t = Bitcoin::transaction::read(tx);
+        ASSERT_EQ(t.Inputs.size(), 12);
+        ASSERT_EQ(t.Outputs.size(), 1);
+        EXPECT_EQ(t.Outputs.first().Script, Bitcoin::pay_to_address::script(pay_to));
+        EXPECT_TRUE(Bitcoin::evaluation_context(tx, prevouts).verify());
+
+        // The fee is for the size with the largest possible signatures,
+        // which is at least the real size.
+        size_t max_size = 4 + 1 + 1 + 34 + 4;
+        for (const solved_output& x : solved) max_size += 36 + 1 + input_script_size(x.Proof.Type, true) + 4;
+        double fee = double(int64(satoshi{120000} - t.Outputs.first().Value));
+        EXPECT_EQ(fee, std::ceil(fee_rate * max_size));
+        EXPECT_GE(fee, fee_rate * tx.size());
+
+        // the key must be the one that solved the outputs.
+        Bitcoin::secret other(Bitcoin::secret::main, secp256k1::secret(secp256k1::coordinate(54321)));
+        EXPECT_EQ(redeem(solved, other, pay_to, fee_rate).size(), 0);
+
+        // a fee that takes everything.
+        EXPECT_EQ(redeem(solved, key, pay_to, 1000).size(), 0);
+    }
+
 }
@@ -0,0 +1,49 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/classifier.hpp>
+#include <gigamonkey/boost/boost.hpp>
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+
+    TEST(ClassifierTest, TestClassifier) {
+        const classifier& standard = classifier::standard();
+        EXPECT_EQ(standard.size(), 4);
+
+        digest160 address = hash160(bytes_view{bytes(10, 7)});
+        classifier::result r = standard.classify(pay_to_address::script(address));
+        EXPECT_EQ(r.Template, classifier::pay_to_address);
+        ASSERT_EQ(r.Captures, 1);
+        EXPECT_EQ(r[0], bytes_view(address));
+
+        bytes compressed(33, 2);
+        r = standard.classify(compile(program{} << instruction{compressed} << OP_CHECKSIG));
+        EXPECT_EQ(r.Template, classifier::pay_to_pubkey);
+        EXPECT_EQ(r[0], bytes_view{compressed});
+
+        EXPECT_EQ(standard.classify(compile(program{} << OP_FALSE << OP_RETURN << instruction{compressed})).Template, classifier::op_return);
+        EXPECT_EQ(standard.classify(compile(program{} << OP_RETURN)).Template, classifier::op_return);
+
+        Boost::output_script boost = Boost::output_script::bounty(int32_little{1}, uint256{}, work::target{32, 0x0ffff0}, 
+            bytes_view{bytes(5, 3)}, uint32_little{17}, bytes_view{bytes(9, 4)});
+        ASSERT_TRUE(boost.valid());
+        r = standard.classify(boost.write());
+        EXPECT_EQ(r.Template, classifier::boost);
+        EXPECT_EQ(Boost::output_script::from_captures(r.Capture), boost);
+
+        // nothing matches these.
+        EXPECT_FALSE(standard.classify(bytes{}).valid());
+        EXPECT_FALSE(standard.classify(compile(program{} << OP_DUP << OP_DROP)).valid());
+        EXPECT_FALSE(standard.classify(bytes_view{pay_to_address::script(address)}.substr(0, 10)).valid());
+
+        // templates added first win.
+        classifier c{};
+        EXPECT_EQ(c.add(pattern{repeated{push{}, 0}}), 0);
+        EXPECT_EQ(c.add(op_return_data::pattern()), 1);
+        EXPECT_EQ(c.classify(compile(program{} << OP_1 << OP_2)).Template, 0);
+        EXPECT_EQ(c.classify(bytes{}).Template, 0);
+        EXPECT_EQ(c.classify(compile(program{} << OP_RETURN)).Template, 1);
+    }
+
+}
@@ -0,0 +1,183 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/headers.hpp>
+#include <gigamonkey/work/string.hpp>
+#include <gigamonkey/merkle.hpp>
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+
+    // a chain of headers at the lowest possible difficulty.
+    std::vector<header> synthetic_chain(uint32 size, uint32 seed = 0, const digest256& previous = digest256{}) {
+        std::vector<header> chain{};
+        digest256 p = previous;
+        for (uint32 i = 0; i < size; i++) {
+            header h{int32_little{1}, p, digest256{uint256{uint64(seed) * 1000000 + i + 1}},
+                timestamp{uint32_little{1231006505 + 600 * i}}, work::target{0x207fffff}, uint32_little{0}};
+            while (!work::string::valid(h.write())) h.Nonce++;
+            p = h.hash();
+            chain.push_back(h);
+        }
+        return chain;
+    }
+
+    TEST(HeadersTest, TestHeaderRanges) {
+        auto chain = synthetic_chain(100);
+
+        header_store store{};
+        for (const header& h : chain) EXPECT_TRUE(store.append(h));
+
+        EXPECT_EQ(store.size(), 100);
+        EXPECT_EQ(store.height(), 99);
+        EXPECT_EQ(store.tip(), chain.back().hash());
+
+        // a header that does not connect to the tip.
+        EXPECT_FALSE(store.append(chain[50]));
+
+        header_range r = store.headers(10, 20);
+        EXPECT_EQ(r.Height, 10);
+        EXPECT_EQ(r.size(), 10);
+        for (uint32 i = 0; i < r.size(); i++) EXPECT_EQ(header{r[i]}, chain[10 + i]);
+
+        EXPECT_EQ(store.headers(95, 200).size(), 5);
+        EXPECT_TRUE(store.headers(200, 300).empty());
+
+        header_range to_tip = store.headers_to_tip(chain[89].hash());
+        EXPECT_EQ(to_tip.Height, 90);
+        EXPECT_EQ(to_tip.size(), 10);
+
+        // heights in a locator are dense near the tip and include the base.
+        std::vector<uint64> heights = locator_heights(99);
+        EXPECT_EQ(heights.front(), 99);
+        EXPECT_EQ(heights.back(), 0);
+        EXPECT_EQ(heights[9], 90);
+        EXPECT_EQ(heights[10], 88);
+        EXPECT_EQ(heights[11], 84);
+
+        locator l = store.locate();
+        EXPECT_EQ(l.size(), heights.size());
+        EXPECT_EQ(l.first(), store.tip());
+
+        // a peer with a shorter chain sends us its locator.
+        header_store shorter{};
+        for (uint32 i = 0; i < 60; i++) shorter.append(chain[i]);
+        header_range next = store.headers(shorter.locate(), 2000);
+        EXPECT_EQ(next.Height, 60);
+        EXPECT_EQ(next.size(), 40);
+        EXPECT_EQ(store.headers(shorter.locate(), 15).size(), 15);
+
+        // a peer on a fork which shares only the first 30 headers.
+        header_store fork{};
+        for (uint32 i = 0; i < 30; i++) fork.append(chain[i]);
+        for (const header& h : synthetic_chain(50, 1, chain[29].hash())) EXPECT_TRUE(fork.append(h));
+        // the fork's locator samples heights 40 and 8 around the fork point,
+        // so we start sending from just after 8.
+        EXPECT_EQ(store.headers(fork.locate(), 2000).Height, 9);
+
+        store.truncate(49);
+        EXPECT_EQ(store.height(), 49);
+        EXPECT_FALSE(store.height(chain[50].hash()));
+        EXPECT_TRUE(store.append(chain[50]));
+    }
+
+    TEST(HeadersTest, TestForkTree) {
+        auto chain = synthetic_chain(11);
+
+        fork_tree tree{chain[0].write()};
+        std::vector<fork_tree::reorg> events{};
+        tree.listen([&events](const fork_tree&, const fork_tree::reorg& r) {
+            events.push_back(r);
+        });
+
+        for (uint32 i = 1; i < chain.size(); i++) EXPECT_NE(tree.attach(chain[i]), fork_tree::none);
+        EXPECT_EQ(events.size(), 10);
+        EXPECT_TRUE(events.back().extension());
+        EXPECT_EQ(tree.hash(tree.tip()), chain.back().hash());
+        EXPECT_EQ(tree.best().height(), 10);
+
+        // duplicates and orphans are rejected.
+        EXPECT_EQ(tree.attach(chain[5]), fork_tree::none);
+        EXPECT_EQ(tree.attach(synthetic_chain(1, 2, digest256{uint256{7}})[0]), fork_tree::none);
+
+        // a branch from height 5 which eventually overtakes the main chain.
+        auto branch = synthetic_chain(7, 1, chain[5].hash());
+        for (uint32 i = 0; i < 5; i++) EXPECT_NE(tree.attach(branch[i]), fork_tree::none);
+        EXPECT_EQ(events.size(), 10);
+        EXPECT_EQ(tree.hash(tree.tip()), chain.back().hash());
+
+        // equal work does not cause a reorg.
+        EXPECT_EQ(tree.work(tree.find(branch[4].hash())), tree.work(tree.tip()));
+
+        EXPECT_NE(tree.attach(branch[5]), fork_tree::none);
+        ASSERT_EQ(events.size(), 11);
+        const fork_tree::reorg& r = events.back();
+        EXPECT_FALSE(r.extension());
+        EXPECT_EQ(tree.hash(r.Ancestor), chain[5].hash());
+        ASSERT_EQ(r.Disconnected.size(), 5);
+        ASSERT_EQ(r.Connected.size(), 6);
+        EXPECT_EQ(tree.hash(r.Disconnected.front()), chain[10].hash());
+        EXPECT_EQ(tree.hash(r.Disconnected.back()), chain[6].hash());
+        EXPECT_EQ(tree.hash(r.Connected.front()), branch[0].hash());
+        EXPECT_EQ(tree.hash(r.Connected.back()), branch[5].hash());
+
+        EXPECT_EQ(tree.best().height(), 11);
+        EXPECT_EQ(tree.best().tip(), branch[5].hash());
+        EXPECT_EQ(tree.best().hash(5), chain[5].hash());
+        EXPECT_EQ(tree.best().hash(6), branch[0].hash());
+
+        EXPECT_NE(tree.attach(branch[6]), fork_tree::none);
+        EXPECT_TRUE(events.back().extension());
+    }
+
+    TEST(HeadersTest, TestCheckpoint) {
+        auto chain = synthetic_chain(300);
+
+        header_store full{};
+        for (const header& h : chain) full.append(h);
+
+        header_store early{};
+        for (uint32 i = 0; i < 200; i++) early.append(chain[i]);
+
+        checkpoint c = checkpoint::make(early);
+        ASSERT_TRUE(c.valid());
+        EXPECT_EQ(c.Height, 199);
+        EXPECT_EQ(c.Tip, chain[199].hash());
+        EXPECT_EQ(c.window(), checkpoint::Window);
+        EXPECT_EQ(c.median_time_past(), chain[194].Timestamp);
+        EXPECT_EQ(c.window_work().back(), c.Work);
+
+        Merkle::leaves hashes{};
+        for (uint32 i = 0; i < 200; i++) hashes = hashes << chain[i].hash();
+        EXPECT_EQ(c.Commitment, Merkle::root(hashes));
+
+        bytes b = c.write();
+        EXPECT_EQ(checkpoint::read(b), c);
+
+        // a corrupted checkpoint is rejected.
+        b[b.size() - 1] ^= 1;
+        EXPECT_FALSE(checkpoint::read(b).valid());
+
+        // start from the checkpoint and sync forward.
+        header_store loaded = c.load();
+        EXPECT_EQ(loaded.base(), 200 - checkpoint::Window);
+        EXPECT_EQ(loaded.tip(), c.Tip);
+        for (uint32 i = 200; i < 300; i++) EXPECT_TRUE(loaded.append(chain[i]));
+
+        checkpoint next = checkpoint::make(c, loaded);
+        EXPECT_TRUE(next.valid());
+        EXPECT_EQ(next, checkpoint::make(full));
+
+        // a checkpoint from a short chain has a short window.
+        header_store short_chain{};
+        for (uint32 i = 0; i < 5; i++) short_chain.append(chain[i]);
+        checkpoint s = checkpoint::make(short_chain);
+        EXPECT_TRUE(s.valid());
+        EXPECT_EQ(s.window(), 5);
+        EXPECT_EQ(checkpoint::read(s.write()), s);
+
+        // the store must reach back to the previous checkpoint.
+        EXPECT_FALSE(checkpoint::make(c, short_chain).valid());
+    }
+
+}
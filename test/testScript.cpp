@@ -0,0 +1,366 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/script.hpp>
+#include <gigamonkey/script_profile.hpp>
+#include <gigamonkey/wif.hpp>
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+
+    TEST(ScriptTest, TestMatcher) {
+        digest160 address = hash160(bytes_view{bytes(10, 7)});
+        bytes p2pkh = pay_to_address::script(address);
+
+        bytes_view captured;
+        EXPECT_EQ(pay_to_address::compiled().captures(), 1);
+        EXPECT_EQ(pay_to_address::compiled().match(p2pkh, &captured), matcher::success);
+        EXPECT_EQ(captured, bytes_view(address));
+        EXPECT_EQ(pay_to_address{p2pkh}.Address, address);
+
+        // too short, too long, and cut off in the middle of a push.
+        EXPECT_EQ(pay_to_address::compiled().match(bytes_view{p2pkh}.substr(0, 24)), matcher::mismatch);
+        EXPECT_EQ(pay_to_address::compiled().match(compile(program{} << instruction{p2pkh} << OP_DROP)), matcher::mismatch);
+        EXPECT_EQ(pay_to_address::compiled().match(bytes_view{p2pkh}.substr(0, 10)), matcher::invalid);
+        EXPECT_FALSE(pay_to_address{bytes_view{p2pkh}.substr(0, 10)}.valid());
+
+        // both alternatives of a pubkey capture into the same place.
+        bytes compressed(33, 2);
+        bytes uncompressed(65, 4);
+        EXPECT_EQ(pay_to_pubkey::compiled().captures(), 1);
+        EXPECT_EQ(pay_to_pubkey::compiled().match(compile(program{} << instruction{compressed} << OP_CHECKSIG), &captured), matcher::success);
+        EXPECT_EQ(captured, bytes_view{compressed});
+        EXPECT_EQ(pay_to_pubkey::compiled().match(compile(program{} << instruction{uncompressed} << OP_CHECKSIG), &captured), matcher::success);
+        EXPECT_EQ(captured, bytes_view{uncompressed});
+        EXPECT_EQ(pay_to_pubkey::compiled().match(compile(program{} << instruction{p2pkh} << OP_CHECKSIG)), matcher::mismatch);
+
+        // optional and repeated.
+        matcher op_return{op_return_data::pattern()};
+        EXPECT_EQ(op_return.match(compile(program{} << OP_FALSE << OP_RETURN)), matcher::success);
+        EXPECT_EQ(op_return.match(compile(program{} << OP_RETURN << instruction{compressed} << instruction{uncompressed})), matcher::success);
+        EXPECT_EQ(op_return.match(compile(program{} << OP_RETURN << instruction{compressed} << OP_DUP)), matcher::mismatch);
+
+        bytes first;
+        bytes second;
+        matcher exactly_two{pattern{repeated{push{first}, 2, exactly}, optional{push{second}}, OP_EQUAL}};
+        EXPECT_EQ(exactly_two.captures(), 2);
+        bytes_view two[2];
+        EXPECT_EQ(exactly_two.match(compile(program{} << instruction{compressed} << OP_3 << OP_EQUAL), two), matcher::success);
+        ASSERT_EQ(two[0].size(), 1);
+        EXPECT_EQ(two[0][0], 3);
+        EXPECT_EQ(two[1].size(), 0);
+        EXPECT_EQ(exactly_two.match(compile(program{} << OP_1 << OP_2 << OP_3 << OP_EQUAL), two), matcher::success);
+        ASSERT_EQ(two[1].size(), 1);
+        EXPECT_EQ(two[1][0], 3);
+        EXPECT_EQ(exactly_two.match(compile(program{} << OP_1 << OP_EQUAL)), matcher::mismatch);
+
+        // numbers are little endian with a sign bit.
+        bytes thousand(2);
+        thousand[0] = 0xe8;
+        thousand[1] = 0x03;
+        bytes minus_thousand = thousand;
+        minus_thousand[1] |= 0x80;
+        matcher numbers{pattern{push{-1}, push{16}, push{1000}, push{-1000}}};
+        EXPECT_EQ(numbers.match(compile(program{} << OP_1NEGATE << OP_16 << instruction{thousand} << instruction{minus_thousand})), matcher::success);
+        EXPECT_EQ(numbers.match(compile(program{} << OP_1NEGATE << OP_16 << instruction{minus_thousand} << instruction{thousand})), matcher::mismatch);
+    }
+
+    TEST(ScriptTest, TestInstructions) {
+        bytes small(20, 1);
+        bytes medium(100, 2);
+        bytes large(300, 3);
+
+        // pushes use the smallest op code that fits.
+        EXPECT_EQ(instruction{small}.Op, OP_PUSHSIZE20);
+        EXPECT_EQ(instruction{medium}.Op, OP_PUSHDATA1);
+        EXPECT_EQ(instruction{large}.Op, OP_PUSHDATA2);
+
+        program p = program{} << instruction{small} << OP_DUP << instruction{medium} << OP_3 << instruction{large} << OP_CHECKSIG;
+        bytes script = compile(p);
+        EXPECT_EQ(script.size(), 21 + 1 + 102 + 1 + 303 + 1);
+        EXPECT_EQ(decompile(script), p);
+
+        bytes appended = compile(program{} << instruction{small} << OP_DUP);
+        compile(program{} << instruction{medium} << OP_3 << instruction{large} << OP_CHECKSIG, appended);
+        EXPECT_EQ(appended, script);
+
+        instructions x{script};
+        EXPECT_TRUE(x.valid());
+        EXPECT_EQ(x.size(), 6);
+
+        auto i = x.begin();
+        EXPECT_EQ(i->Op, OP_PUSHSIZE20);
+        EXPECT_EQ(i->Data, bytes_view{small});
+        EXPECT_EQ(i->Data.data(), script.data() + 1);
+        EXPECT_EQ(i->Offset, 0);
+        EXPECT_EQ(i->Size, 21);
+        ++i;
+        EXPECT_EQ(i->Op, OP_DUP);
+        EXPECT_EQ(i->Size, 1);
+        ++i;
+        EXPECT_EQ(i->Op, OP_PUSHDATA1);
+        EXPECT_EQ(i->Data, bytes_view{medium});
+        ++i;
+        ASSERT_EQ(i->data().size(), 1);
+        EXPECT_EQ(i->data()[0], 3);
+        ++i;
+        EXPECT_EQ(i->Op, OP_PUSHDATA2);
+        EXPECT_EQ(i->Data, bytes_view{large});
+        EXPECT_EQ(i->Offset, 21 + 1 + 102 + 1);
+        ++i;
+        EXPECT_EQ(i->Op, OP_CHECKSIG);
+        ++i;
+        EXPECT_TRUE(i == x.end());
+
+        // a script that ends in the middle of a push.
+        instructions cut{bytes_view{script}.substr(0, 50)};
+        EXPECT_FALSE(cut.valid());
+        EXPECT_EQ(cut.size(), 2);
+        EXPECT_EQ(decompile(bytes_view{script}.substr(0, 50)), program{});
+
+        EXPECT_EQ(sigops(script), 1);
+        bytes multisig = compile(program{} << OP_2 << instruction{small} << instruction{small} << OP_2 << OP_CHECKMULTISIG);
+        EXPECT_EQ(sigops(multisig), 20);
+        EXPECT_EQ(sigops(multisig, true), 2);
+    }
+
+    TEST(ScriptTest, TestScriptTemplates) {
+        digest160 address = hash160(bytes_view{bytes(10, 7)});
+        bytes compressed(33, 2);
+        bytes uncompressed(65, 4);
+
+        EXPECT_EQ(pay_to_address::Template.size(), 25);
+        EXPECT_EQ(pay_to_address::script(address), 
+            compile(program{OP_DUP, OP_HASH160, bytes_view(address), OP_EQUALVERIFY, OP_CHECKSIG}));
+        EXPECT_EQ(pay_to_pubkey::script(pubkey{compressed}), compile(program{instruction{compressed}, OP_CHECKSIG}));
+        EXPECT_EQ(pay_to_pubkey::script(pubkey{uncompressed}), compile(program{instruction{uncompressed}, OP_CHECKSIG}));
+
+        bytes out(2 * pay_to_address::Template.size());
+        pay_to_address::write(out.data(), address);
+        pay_to_address::write(out.data() + pay_to_address::Template.size(), address);
+        EXPECT_EQ(bytes_view{out}.substr(25), bytes_view{pay_to_address::script(address)});
+
+        // pushes with sizes that need PUSHDATA op codes.
+        constexpr template_part parts[] = {template_part::push(100), OP_DROP, template_part::push(300)};
+        constexpr script_template<template_length(parts), template_holes(parts)> big{parts};
+        static_assert(big.size() == 102 + 1 + 303);
+
+        bytes medium(100, 2);
+        bytes large(300, 3);
+        EXPECT_EQ(big.write({bytes_view{medium}, bytes_view{large}}), 
+            compile(program{instruction{medium}, OP_DROP, instruction{large}}));
+
+        // pushes of the wrong size are not written.
+        EXPECT_EQ(big.write({bytes_view{large}, bytes_view{medium}}), bytes{});
+    }
+
+    TEST(ScriptTest, TestScriptMetrics) {
+        digest160 address = hash160(bytes_view{bytes(10, 7)});
+        bytes p2pkh = pay_to_address::script(address);
+        bytes data(100, 5);
+        bytes op_return = compile(program{} << OP_FALSE << OP_RETURN << instruction{data});
+        bytes unlock = compile(program{} << instruction{bytes(72, 1)} << instruction{bytes(33, 2)});
+
+        script_metrics m{p2pkh};
+        EXPECT_TRUE(m.Valid);
+        EXPECT_EQ(m.Instructions, 5);
+        EXPECT_EQ(m.Sigops, 1);
+        EXPECT_EQ(m.MaxPush, 20);
+        EXPECT_FALSE(m.PushOnly);
+        EXPECT_FALSE(m.DataCarrier);
+
+        m = script_metrics{op_return};
+        EXPECT_TRUE(m.DataCarrier);
+        EXPECT_EQ(m.MaxPush, 100);
+        EXPECT_EQ(m.Sigops, 0);
+
+        m = script_metrics{unlock};
+        EXPECT_TRUE(m.PushOnly);
+        EXPECT_EQ(m.Instructions, 2);
+        EXPECT_EQ(m.MaxPush, 72);
+
+        EXPECT_FALSE(script_metrics{bytes_view{unlock}.substr(0, 40)}.Valid);
+
+        input in{outpoint{digest256{uint256{1}}, index{0}}, unlock, uint32_little{0xffffffff}};
+        transaction t{list<input>{} << in << in, list<output>{} << output{satoshi{1000}, p2pkh} << output{satoshi{0}, op_return}, int32_little{0}};
+        EXPECT_EQ(t.sigops(), 1);
+
+        transaction_metrics tm = Gigamonkey::transaction::metrics(t.write());
+        ASSERT_TRUE(tm.Valid);
+        EXPECT_EQ(tm.Inputs.Instructions, 4);
+        EXPECT_TRUE(tm.Inputs.PushOnly);
+        EXPECT_FALSE(tm.Inputs.DataCarrier);
+        EXPECT_EQ(tm.Outputs.Instructions, 8);
+        EXPECT_TRUE(tm.Outputs.DataCarrier);
+        EXPECT_EQ(tm.Outputs.MaxPush, 100);
+        EXPECT_EQ(tm.sigops(), 1);
+
+        bytes tx = t.write();
+        EXPECT_FALSE(Gigamonkey::transaction::metrics(bytes_view{tx}.substr(0, tx.size() - 1)).Valid);
+    }
+
+    TEST(ScriptTest, TestEvaluationContext) {
+        // scripts that need no signatures.
+        bytes lock = compile(program{} << OP_3 << OP_EQUAL);
+        bytes good = compile(program{} << OP_3);
+        bytes bad = compile(program{} << OP_4);
+
+        list<output> redeemed{};
+        list<input> inputs{};
+        for (uint32 i = 0; i < 5; i++) {
+            redeemed = redeemed << output{satoshi{1000}, lock};
+            inputs = inputs << input{outpoint{digest256{uint256{i + 1}}, index{i}}, i == 3 ? bad : good, uint32_little{0xffffffff}};
+        }
+        bytes tx = transaction{inputs, list<output>{} << output{satoshi{4000}, lock}, int32_little{0}}.write();
+
+        evaluation_context context{tx, redeemed};
+        ASSERT_TRUE(context.valid());
+        EXPECT_EQ(context.inputs(), 5);
+        EXPECT_TRUE(context.evaluate(index{0}).Return);
+        EXPECT_FALSE(context.evaluate(index{3}).Return);
+        EXPECT_FALSE(context.evaluate(index{5}).valid());
+
+        for (uint32 threads : {1, 2, 8}) {
+            std::vector<evaluated> results = context.evaluate_all(threads);
+            ASSERT_EQ(results.size(), 5);
+            for (uint32 i = 0; i < 5; i++) EXPECT_EQ(results[i].valid() && results[i].Return, i != 3);
+            EXPECT_FALSE(context.verify(threads));
+        }
+
+        // without the bad input.
+        evaluation_context first_three{
+            transaction{list<input>{} << inputs.first() << inputs.first() << inputs.first(), list<output>{}, int32_little{0}}.write(),
+            list<output>{} << redeemed.first() << redeemed.first() << redeemed.first()};
+        EXPECT_TRUE(first_three.verify(2));
+
+        // there must be an output for every input.
+        EXPECT_FALSE(evaluation_context(tx, redeemed.rest()).valid());
+        EXPECT_FALSE(evaluation_context(bytes_view{tx}.substr(0, 20), redeemed).valid());
+    }
+
+    TEST(ScriptTest, TestEvaluationContextSignatures) {
+        secret key(secret::main, secp256k1::secret(secp256k1::coordinate(12345)));
+        secret other(secret::main, secp256k1::secret(secp256k1::coordinate(54321)));
+        pubkey p = key.to_public();
+        output prev{satoshi{1000}, pay_to_address::script(key.address().Digest)};
+        sighash::directive d = directive(sighash::all);
+
+        // Every signature has fork id, so its hash includes hashes of the whole
+        // transaction, which must be computed only once for this to be quick.
+        const uint32 size = 1000;
+        list<output> redeemed{};
+        list<input> unsigned_inputs{};
+        for (uint32 i = 0; i < size; i++) {
+            redeemed = redeemed << prev;
+            unsigned_inputs = unsigned_inputs << input{outpoint{digest256{uint256{i + 1}}, index{i}}, bytes{}, uint32_little{0xffffffff}};
+        }
+        list<output> outputs = list<output>{} << output{satoshi{900 * size}, prev.Script};
+        sighash_cache cache{transaction{unsigned_inputs, outputs, int32_little{0}}.write()};
+        ASSERT_TRUE(cache.valid());
+
+        auto redeem = [&cache, &prev, &p, d](uint32 i, const secret& k) -> bytes {
+            signature x = sign(cache.hash(index{i}, prev, d), k.Secret);
+            x.Data.push_back(d);
+            return pay_to_address::redeem(x, p);
+        };
+
+        // in the second transaction, one input is signed with the wrong key.
+        const uint32 wrong = 500;
+        list<input> good{};
+        list<input> bad{};
+        for (uint32 i = 0; i < size; i++) {
+            bytes script = redeem(i, key);
+            good = good << input{outpoint{digest256{uint256{i + 1}}, index{i}}, script, uint32_little{0xffffffff}};
+            bad = bad << input{outpoint{digest256{uint256{i + 1}}, index{i}}, i == wrong ? redeem(i, other) : script, uint32_little{0xffffffff}};
+        }
+
+        evaluation_context signed_context{transaction{good, outputs, int32_little{0}}.write(), redeemed};
+        ASSERT_TRUE(signed_context.valid());
+        EXPECT_TRUE(signed_context.verify());
+        EXPECT_TRUE(signed_context.verify(4));
+
+        evaluation_context wrong_context{transaction{bad, outputs, int32_little{0}}.write(), redeemed};
+        EXPECT_FALSE(wrong_context.verify(4));
+        std::vector<evaluated> results = wrong_context.evaluate_all(4);
+        ASSERT_EQ(results.size(), size);
+        for (uint32 i = 0; i < size; i++) EXPECT_EQ(results[i].valid() && results[i].Return, i != wrong);
+    }
+
+    TEST(ScriptTest, TestScriptProfile) {
+        bytes unlock = compile(program{} << OP_2 << OP_3);
+        // 2 + 3 == 5, using the alt stack and both sides of a conditional.
+        bytes lock = compile(program{} << OP_TOALTSTACK << OP_DUP << OP_IF << OP_FROMALTSTACK << OP_ADD
+            << OP_ELSE << OP_DROP << OP_FALSE << OP_ENDIF << OP_5 << OP_EQUAL);
+
+        script_profile profile{};
+        evaluated e = evaluate_script(unlock, lock, profile);
+        EXPECT_EQ(e, evaluate_script(unlock, lock));
+        EXPECT_TRUE(e.valid());
+        EXPECT_TRUE(e.Return);
+
+        EXPECT_EQ(profile.Evaluations, 1);
+        EXPECT_EQ(profile.Executed[OP_ADD], 1);
+        // the branch that was not taken is not run.
+        EXPECT_EQ(profile.Executed[OP_DROP], 0);
+        EXPECT_EQ(profile.Executed[OP_IF] + profile.Executed[OP_ELSE] + profile.Executed[OP_ENDIF], 3);
+        EXPECT_EQ(profile.instructions(), 11);
+        EXPECT_EQ(profile.executed(script_profile::push), 3);
+        EXPECT_EQ(profile.executed(script_profile::arithmetic), 1);
+        EXPECT_EQ(profile.BytesPushed, 3);
+        EXPECT_EQ(profile.MaxStack, 3);
+
+        // failures are the same as without a profile.
+        bytes wrong = compile(program{} << OP_2 << OP_2);
+        EXPECT_EQ(evaluate_script(wrong, lock, profile), evaluate_script(wrong, lock));
+        EXPECT_FALSE(evaluate_script(wrong, lock, profile).valid());
+        EXPECT_EQ(profile.Evaluations, 3);
+
+        json j = profile;
+        EXPECT_EQ(j["evaluations"], 3);
+        EXPECT_EQ(j["ops"]["add"], 3);
+        EXPECT_TRUE(j["classes"]["flow"]["nanoseconds"].is_number());
+
+        // the result is the interpreter's, even where the profile is not.
+        bytes one = compile(program{} << OP_1);
+        std::vector<std::pair<bytes, bytes>> scripts{
+            // unlocking scripts must be push only.
+            {compile(program{} << OP_1 << OP_DUP), compile(program{} << OP_DROP)},
+            // the stack must be clean.
+            {compile(program{} << OP_1 << OP_1), compile(program{} << OP_EQUAL << OP_1)},
+            // disabled op codes are not allowed where they are not run.
+            {one, compile(program{} << OP_0 << OP_IF << OP_2MUL << OP_ENDIF)},
+            // OP_RETURN outside of a conditional ends the script.
+            {one, compile(program{} << OP_RETURN << OP_0)},
+            {one, compile(program{} << OP_1 << OP_IF << OP_RETURN << OP_ENDIF << OP_0)},
+            {one, compile(program{} << OP_1 << OP_IF << OP_RETURN << OP_ELSE)},
+            {one, compile(program{} << OP_1 << OP_IF << OP_ELSE << OP_ELSE << OP_ENDIF)},
+            {one, compile(program{} << OP_ELSE)},
+            {one, compile(program{} << OP_0 << OP_NOTIF << OP_1 << OP_ENDIF << OP_EQUAL)}};
+
+        for (const auto& x : scripts) EXPECT_EQ(evaluate_script(x.first, x.second, profile), evaluate_script(x.first, x.second));
+
+        // signatures with and without fork id.
+        secret key(secret::main, secp256k1::secret(secp256k1::coordinate(12345)));
+        bytes p2pkh = pay_to_address::script(key.address().Digest);
+        input_index spend{output{satoshi{1000}, p2pkh}, transaction{
+            list<input>{} << input{outpoint{digest256{uint256{1}}, index{0}}, bytes{}, uint32_little{0xffffffff}},
+            list<output>{} << output{satoshi{900}, p2pkh}, int32_little{0}}.write(), index{0}};
+
+        script_profile signatures{};
+        for (bool fork_id : {true, false}) {
+            sighash::directive d = directive(sighash::all, fork_id);
+            signature x = sign(spend, d, key.Secret);
+            x.Data.push_back(d);
+            bytes redeem = pay_to_address::redeem(x, key.to_public());
+
+            evaluated e = evaluate_script(redeem, p2pkh, spend, signatures);
+            EXPECT_EQ(e, evaluate_script(redeem, p2pkh, spend));
+            EXPECT_EQ(e.valid() && e.Return, fork_id);
+        }
+
+        EXPECT_EQ(signatures.Evaluations, 2);
+        EXPECT_EQ(signatures.Executed[OP_CHECKSIG], 2);
+        EXPECT_EQ(signatures.executed(script_profile::signature), 2);
+    }
+
+}
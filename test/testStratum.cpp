@@ -0,0 +1,384 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/stratum/server.hpp>
+#include <gigamonkey/stratum/codec.hpp>
+#include <gigamonkey/stratum/notify_cache.hpp>
+#include <gigamonkey/stratum/validator.hpp>
+#include <map>
+#include <gigamonkey/hash.hpp>
+#include <mutex>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Stratum {
+
+    TEST(StratumTest, TestConversions) {
+        notify n{7, uint256{3}, bytes{1, 2, 3}, bytes{4, 5},
+            list<digest256>{} << Bitcoin::hash256(bytes{1}) << Bitcoin::hash256(bytes{2}),
+            int32_little{2}, work::target{32, 0x0080ff}, timestamp{uint32_little{1600000000}}, true};
+
+        EXPECT_EQ(notify{notification(n)}, n);
+
+        json jn;
+        to_json(jn, n);
+        notify from_notify;
+        from_json(jn, from_notify);
+        EXPECT_EQ(from_notify, n);
+
+        share s{11, "worker", 7, uint64_little{0x0102030405060708}, timestamp{uint32_little{1600000001}}, Gigamonkey::nonce{12345}};
+
+        EXPECT_EQ(share{request(s)}, s);
+
+        json js;
+        to_json(js, s);
+        share from_share;
+        from_json(js, from_share);
+        EXPECT_EQ(from_share, s);
+
+        // a submit with a malformed extra nonce is not a share.
+        EXPECT_FALSE(share{request{12, mining_submit, {"worker", "00000007", "0102", "5f5e1001", "00003039"}}}.valid());
+    }
+
+    TEST(StratumTest, TestCodec) {
+        notify n{7, uint256{3}, bytes{1, 2, 3}, bytes{4, 5},
+            list<digest256>{} << Bitcoin::hash256(bytes{1}) << Bitcoin::hash256(bytes{2}),
+            int32_little{2}, work::target{32, 0x0080ff}, timestamp{uint32_little{1600000000}}, false};
+
+        // the codec writes the same thing as nlohmann::json.
+        json jn;
+        to_json(jn, n);
+        std::string line = codec::write(n);
+        EXPECT_EQ(line, jn.dump() + "\n");
+        EXPECT_EQ(line.size(), codec::size(n));
+
+        notify read_notify;
+        EXPECT_TRUE(codec::read(line, read_notify));
+        EXPECT_EQ(read_notify, n);
+
+        // a name that must be escaped.
+        share s{11, "w\"o\\r\nk\x01" "er", 7, uint64_little{0x0102030405060708},
+            timestamp{uint32_little{1600000001}}, Gigamonkey::nonce{12345}};
+
+        json js;
+        to_json(js, s);
+        line = codec::write(s);
+        EXPECT_EQ(line, js.dump() + "\n");
+        EXPECT_EQ(line.size(), codec::size(s));
+
+        share read_share;
+        EXPECT_TRUE(codec::read(line, read_share));
+        EXPECT_EQ(read_share, s);
+
+        // keys in any order, whitespace, numeric job ids, unicode escapes and extra params.
+        EXPECT_TRUE(codec::read(
+            R"({ "params" : ["\u00e9\ud83d\ude00", 7, "0102030405060708", "5f5e1001", "00003039", "1fffe000"],
+                "method": "mining.submit", "extra": {"a": [1, 2.5e3, null]}, "id": 11 })", read_share));
+        EXPECT_EQ(read_share, (share{11, "\xc3\xa9\xf0\x9f\x98\x80", 7, uint64_little{0x0807060504030201},
+            timestamp{uint32_little{1600000001}}, Gigamonkey::nonce{12345}}));
+
+        for (std::string bad : {
+            std::string{R"({"id":11,"method":"mining.submit","params":["worker","00000007","0102","5f5e1001","00003039"]})"},
+            std::string{R"({"id":11,"method":"mining.notify","params":["worker","00000007","0102030405060708","5f5e1001","00003039"]})"},
+            std::string{R"({"id":-1,"method":"mining.submit","params":["worker","00000007","0102030405060708","5f5e1001","00003039"]})"},
+            std::string{R"({"id":11,"method":"mining.submit","params":["","00000007","0102030405060708","5f5e1001","00003039"]})"},
+            std::string{R"({"id":11,"method":"mining.submit","params":["worker","00000007","0102030405060708","5f5e1001"]})"},
+            std::string{R"({"id":11,"method":"mining.submit","params":["worker","00000007","0102030405060708","5f5e1001","00003039"]} x)"},
+            std::string{R"({"id":11,"method":"mining.submit","params":["worker","00000007","0102030405060708","5f5e1001","00003039"])"}}) {
+            EXPECT_FALSE(codec::read(bad, read_share)) << bad;
+            EXPECT_FALSE(read_share.valid());
+        }
+
+        for (const response& r : {
+            response{11, true}, response{12, false}, response{13, json{}, low_difficulty_share},
+            response{14, false, duplicate_share}}) {
+            json jr;
+            to_json(jr, r);
+            line = codec::write(r);
+            EXPECT_EQ(line, jr.dump() + "\n");
+            EXPECT_EQ(line.size(), codec::size(r));
+
+            response read_response;
+            EXPECT_TRUE(codec::read(line, read_response));
+            EXPECT_EQ(read_response, r);
+        }
+
+        // only results that are bools or null.
+        EXPECT_EQ(codec::size(response{15, json::array({1, 2})}), 0);
+    }
+
+    TEST(StratumTest, TestNotifyCache) {
+        notify n{7, uint256{3}, bytes{1, 2, 3}, bytes{4, 5},
+            list<digest256>{} << Bitcoin::hash256(bytes{1}) << Bitcoin::hash256(bytes{2}),
+            int32_little{2}, work::target{32, 0x0080ff}, timestamp{uint32_little{1600000000}}, true};
+
+        notify_cache cache{n};
+        ASSERT_TRUE(cache.valid());
+        EXPECT_EQ(*cache.line(), codec::write(n));
+        EXPECT_EQ(*cache.head() + *cache.tail(), *cache.line());
+
+        // a personalized notify has ExtraNonce1 at the end of GenerationTx1.
+        notify_cache::fragment f = notify_cache::write_fragment(uint32_little{0x0a0b0c0d});
+        notify personal;
+        EXPECT_TRUE(codec::read(*cache.head() + std::string{f.data(), f.size()} + *cache.tail(), personal));
+        EXPECT_EQ(personal.GenerationTx1, (bytes{1, 2, 3, 0x0d, 0x0c, 0x0b, 0x0a}));
+        personal.GenerationTx1 = n.GenerationTx1;
+        EXPECT_EQ(personal, n);
+
+        EXPECT_FALSE(notify_cache{}.valid());
+    }
+
+    TEST(StratumTest, TestValidator) {
+        // about half of all shares meet the share target and a quarter are blocks.
+        work::target share_target{0x207fffff};
+        work::target job_target{0x203fffff};
+
+        // two jobs for each of two workers, one of which has a Merkle branch.
+        list<digest256> path = list<digest256>{} << digest256{uint256{5}} << digest256{uint256{6}};
+        validator v{};
+        std::vector<job> jobs{};
+        for (uint32 i = 0; i < 2; i++) for (uint32 w = 0; w < 2; w++) {
+            jobs.push_back(job{int32_little{2}, worker{"worker" + std::to_string(w), uint32_little{w + 1}},
+                notify{i, uint256{i}, bytes(10 + i * 30, 0x0a), bytes(20 + i * 50, 0x0b), i == 0 ? path : list<digest256>{},
+                    int32_little{2}, job_target, timestamp{uint32_little{1}}, false}});
+            EXPECT_TRUE(v.add(jobs.back(), share_target));
+        }
+        EXPECT_EQ(v.size(), 4);
+        EXPECT_FALSE(v.add(job{}, share_target));
+
+        std::vector<share> shares{};
+        for (uint32 n = 0; n < 80; n++) shares.push_back(share{n, jobs[n % 4].Worker.Name, jobs[n % 4].Notify.ID,
+            uint64_little{n / 4}, timestamp{uint32_little{1}}, Gigamonkey::nonce{n}});
+
+        // a duplicate in the same batch and a share of an unknown job.
+        shares.push_back(shares[5]);
+        shares.push_back(share{81, "worker0", 7, uint64_little{0}, timestamp{uint32_little{1}}, Gigamonkey::nonce{0}});
+
+        std::vector<share_result> results = v.check(shares);
+        ASSERT_EQ(results.size(), shares.size());
+
+        // the same answers as checking each proof separately.
+        uint256 easy = share_target.expand();
+        std::map<share_result, uint32> counts{};
+        for (uint32 n = 0; n < 80; n++) {
+            work::proof p = solved{jobs[n % 4], shares[n]}.proof();
+            EXPECT_EQ(results[n], p.valid() ? block : p.string().hash() < easy ? valid : low_difficulty);
+            counts[results[n]]++;
+        }
+        EXPECT_GT(counts[block], 0);
+        EXPECT_GT(counts[valid], 0);
+        EXPECT_GT(counts[low_difficulty], 0);
+
+        EXPECT_EQ(results[80], duplicate);
+        EXPECT_EQ(results[81], stale);
+        EXPECT_EQ(v.check(shares[0]), duplicate);
+
+        // a clean job replaces the other jobs of its worker.
+        job clean = jobs[0];
+        clean.Notify.ID = 2;
+        clean.Notify.Clean = true;
+        EXPECT_TRUE(v.add(clean, share_target));
+        EXPECT_EQ(v.size(), 3);
+        EXPECT_EQ(v.check(share{82, "worker0", 0, uint64_little{100}, timestamp{uint32_little{1}}, Gigamonkey::nonce{0}}), stale);
+        EXPECT_EQ(v.check(share{83, "worker0", 1, uint64_little{100}, timestamp{uint32_little{1}}, Gigamonkey::nonce{0}}), stale);
+        EXPECT_NE(v.check(share{84, "worker0", 2, uint64_little{100}, timestamp{uint32_little{1}}, Gigamonkey::nonce{0}}), stale);
+        EXPECT_NE(v.check(share{85, "worker1", 1, uint64_little{100}, timestamp{uint32_little{1}}, Gigamonkey::nonce{0}}), stale);
+
+        v.remove("worker1", 0);
+        EXPECT_EQ(v.size(), 2);
+        v.remove("worker1");
+        EXPECT_EQ(v.size(), 1);
+
+        EXPECT_EQ(error(stale), job_not_found);
+        EXPECT_EQ(error(duplicate), duplicate_share);
+        EXPECT_EQ(error(low_difficulty), low_difficulty_share);
+        EXPECT_EQ(error(valid), none);
+        EXPECT_EQ(error(block), none);
+    }
+
+    namespace {
+
+        struct test_pool final : pool {
+            std::mutex Mutex;
+            uint32 Subscribed{0};
+            std::vector<share> Shares{};
+            bool Personal{false};
+
+            bool personal() const override {
+                return Personal;
+            }
+
+            uint32_little subscribe(connection_id) override {
+                std::lock_guard<std::mutex> lock(Mutex);
+                return uint32_little{++Subscribed};
+            }
+
+            bool authorize(connection_id, const worker_name& name, const std::string&) override {
+                return name != "nobody";
+            }
+
+            bool submit(connection_id, const share& x) override {
+                std::lock_guard<std::mutex> lock(Mutex);
+                Shares.push_back(x);
+                return true;
+            }
+        };
+
+        struct client {
+            int Socket;
+            std::string In;
+
+            explicit client(uint16 port) : Socket{socket(AF_INET, SOCK_STREAM, 0)}, In{} {
+                sockaddr_in address{};
+                address.sin_family = AF_INET;
+                address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+                address.sin_port = htons(port);
+                timeval timeout{5, 0};
+                setsockopt(Socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                if (connect(Socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+                    ::close(Socket);
+                    Socket = -1;
+                }
+            }
+
+            ~client() {
+                if (Socket >= 0) ::close(Socket);
+            }
+
+            void send(const json& j) {
+                std::string line = j.dump() + "\n";
+                ::send(Socket, line.data(), line.size(), MSG_NOSIGNAL);
+            }
+
+            // null if nothing arrives in time.
+            json receive() {
+                while (true) {
+                    size_t end = In.find('\n');
+                    if (end != std::string::npos) {
+                        json j = json::parse(In.substr(0, end), nullptr, false);
+                        In.erase(0, end + 1);
+                        return j;
+                    }
+
+                    char buffer[1024];
+                    ssize_t n = ::recv(Socket, buffer, sizeof(buffer), 0);
+                    if (n <= 0) return json{};
+                    In.append(buffer, n);
+                }
+            }
+
+            response call(const request& r) {
+                json j;
+                to_json(j, r);
+                send(j);
+                response x;
+                from_json(receive(), x);
+                return x;
+            }
+        };
+
+    }
+
+    TEST(StratumTest, TestServer) {
+        test_pool p{};
+        server s{p, 0, 2};
+        ASSERT_TRUE(s.valid());
+
+        client a{s.port()};
+        client b{s.port()};
+        client c{s.port()};
+        ASSERT_TRUE(a.Socket >= 0 && b.Socket >= 0 && c.Socket >= 0);
+
+        // authorize before subscribe.
+        response not_subscribed = a.call(request{1, mining_authorize, {"alice", ""}});
+        EXPECT_EQ(not_subscribed.ID, 1);
+        EXPECT_EQ(not_subscribed.ErrorCode, Stratum::not_subscribed);
+
+        response subscribed = a.call(request{2, mining_subscribe, {}});
+        EXPECT_EQ(subscribed.ErrorCode, none);
+        ASSERT_TRUE(subscribed.Result.is_array() && subscribed.Result.size() == 3);
+        EXPECT_EQ(subscribed.Result[2], Stratum::worker::ExtraNonce2_size);
+
+        // submit before authorize.
+        share x{3, "alice", 7, uint64_little{1}, timestamp{uint32_little{1600000000}}, Gigamonkey::nonce{99}};
+        EXPECT_EQ(a.call(request(x)).ErrorCode, unauthorized_worker);
+
+        EXPECT_EQ(a.call(request{4, mining_authorize, {"alice", ""}}).Result, true);
+
+        x.ID = 5;
+        response accepted = a.call(request(x));
+        EXPECT_EQ(accepted.ErrorCode, none);
+        EXPECT_EQ(accepted.Result, true);
+
+        {
+            std::lock_guard<std::mutex> lock(p.Mutex);
+            ASSERT_EQ(p.Shares.size(), 1);
+            EXPECT_EQ(p.Shares[0], x);
+        }
+
+        EXPECT_EQ(b.call(request{6, mining_subscribe, {}}).ErrorCode, none);
+        EXPECT_EQ(b.call(request{7, mining_authorize, {"nobody", ""}}).Result, false);
+
+        // unknown methods get an error.
+        EXPECT_EQ(c.call(request{8, mining_configure, {}}).ErrorCode, unknown);
+
+        // a and b have subscribed but c has not.
+        notify n{9, uint256{3}, bytes{1, 2, 3}, bytes{4, 5}, list<digest256>{},
+            int32_little{2}, work::target{32, 0x0080ff}, timestamp{uint32_little{1600000000}}, true};
+        s.notify(n);
+
+        notify na;
+        from_json(a.receive(), na);
+        EXPECT_EQ(na, n);
+
+        notify nb;
+        from_json(b.receive(), nb);
+        EXPECT_EQ(nb, n);
+
+        EXPECT_EQ(s.connections(), 3);
+
+        s.stop();
+        EXPECT_FALSE(s.valid());
+        EXPECT_EQ(s.connections(), 0);
+    }
+
+    TEST(StratumTest, TestPersonalNotify) {
+        test_pool p{};
+        p.Personal = true;
+        server s{p, 0, 2};
+        ASSERT_TRUE(s.valid());
+
+        client a{s.port()};
+        client b{s.port()};
+        ASSERT_TRUE(a.Socket >= 0 && b.Socket >= 0);
+
+        // the miner's part of ExtraNonce1 is empty.
+        response subscribed = a.call(request{1, mining_subscribe, {}});
+        ASSERT_TRUE(subscribed.Result.is_array() && subscribed.Result.size() == 3);
+        EXPECT_EQ(subscribed.Result[1], "");
+        EXPECT_EQ(b.call(request{2, mining_subscribe, {}}).ErrorCode, none);
+        // a miner cannot subscribe twice.
+        EXPECT_EQ(a.call(request{3, mining_subscribe, {}}).ErrorCode, unknown);
+
+        notify n{9, uint256{3}, bytes{1, 2, 3}, bytes{4, 5}, list<digest256>{},
+            int32_little{2}, work::target{32, 0x0080ff}, timestamp{uint32_little{1600000000}}, true};
+        s.notify(n);
+
+        // a subscribed first and got ExtraNonce1 = 1, and b got 2.
+        notify na;
+        from_json(a.receive(), na);
+        EXPECT_EQ(na.GenerationTx1, (bytes{1, 2, 3, 1, 0, 0, 0}));
+
+        notify nb;
+        from_json(b.receive(), nb);
+        EXPECT_EQ(nb.GenerationTx1, (bytes{1, 2, 3, 2, 0, 0, 0}));
+
+        nb.GenerationTx1 = n.GenerationTx1;
+        EXPECT_EQ(nb, n);
+    }
+
+}
@@ -0,0 +1,223 @@
+// Copyright (c) 2020 Daniel Krawisz
+// Distributed under the Open BSV software license, see the accompanying file LICENSE.
+
+#include <gigamonkey/validation.hpp>
+#include "gtest/gtest.h"
+
+namespace Gigamonkey::Bitcoin {
+
+    // outputs of a single previous transaction.
+    struct test_prevouts final : prevout_provider {
+        digest256 Reference;
+        std::map<uint32, output> Outputs;
+
+        std::optional<output> operator()(const outpoint& o) const override {
+            if (o.Reference != Reference) return {};
+            auto x = Outputs.find(uint32(o.Index));
+            if (x == Outputs.end()) return {};
+            return x->second;
+        }
+    };
+
+    // a redeemable output which just needs some fixed input script.
+    struct test_redeemable final : redeemable {
+        bytes Script;
+
+        test_redeemable(bytes s) : Script{s} {}
+
+        redemption::incomplete redeem(sighash::directive) const override {
+            return redemption::incomplete{} << redemption::element{Script};
+        }
+
+        uint32 expected_size() const override {
+            return Script.size();
+        }
+
+        uint32 sigops() const override {
+            return 0;
+        }
+    };
+
+    // an output which is redeemed with a signature alone.
+    struct test_signed final : redeemable {
+        secret Key;
+
+        test_signed(const secret& k) : Key{k} {}
+
+        redemption::incomplete redeem(sighash::directive d) const override {
+            return redemption::incomplete{} << redemption::element{&Key, d};
+        }
+
+        uint32 expected_size() const override {
+            return DerSignatureExpectedSize + 1;
+        }
+
+        uint32 sigops() const override {
+            return 1;
+        }
+    };
+
+    bytes block_of(const std::vector<bytes>& txs) {
+        header h{int32_little{1}, digest256{}, digest256{}, timestamp{uint32_little{1231006505}}, work::target{0x207fffff}, uint32_little{0}};
+        size_t size = 80 + var_int_size(txs.size());
+        for (const bytes& tx : txs) size += tx.size();
+        bytes b(size);
+        bytes_writer w{b.begin(), b.end()};
+        w = write_var_int(w << h, txs.size());
+        for (const bytes& tx : txs) w = w << bytes_view{tx};
+        return b;
+    }
+
+    TEST(ValidationTest, TestValidation) {
+        bytes lock = compile(program{} << OP_3 << OP_EQUAL);
+        bytes good = compile(program{} << OP_3);
+        bytes bad = compile(program{} << OP_4);
+        digest256 external{uint256{7}};
+
+        test_prevouts prevouts{};
+        prevouts.Reference = external;
+        for (uint32 i = 0; i < 100; i++) prevouts.Outputs[i] = output{satoshi{1000}, lock};
+
+        // a transaction with many inputs, one of which may be bad.
+        auto consolidate = [&](uint32 inputs, uint32 first, int bad_input) -> bytes {
+            list<input> in{};
+            for (uint32 i = 0; i < inputs; i++)
+                in = in << input{outpoint{external, index{first + i}}, int(i) == bad_input ? bad : good, uint32_little{0xffffffff}};
+            return transaction{in, list<output>{} << output{satoshi{1000 * inputs}, lock}, int32_little{0}}.write();
+        };
+
+        thread_pool pool{4};
+
+        script_validation v = validate_transaction(consolidate(50, 0, -1), prevouts, pool);
+        EXPECT_TRUE(v.valid());
+        ASSERT_EQ(v.Errors.size(), 1);
+        ASSERT_EQ(v.Errors[0].size(), 50);
+        for (ScriptError e : v.Errors[0]) EXPECT_EQ(e, SCRIPT_ERR_OK);
+
+        v = validate_transaction(consolidate(50, 0, 17), prevouts, pool);
+        EXPECT_EQ(v.Status, script_validation::invalid_script);
+        EXPECT_EQ(v.Input, 17);
+        EXPECT_NE(v.error(), SCRIPT_ERR_OK);
+
+        v = validate_transaction(consolidate(10, 95, -1), prevouts, pool);
+        EXPECT_EQ(v.Status, script_validation::missing_prevout);
+        EXPECT_EQ(v.Input, 5);
+
+        // the second transaction spends the output of the first.
+        bytes coinbase = transaction{list<input>{} << input{outpoint{digest256{}, index{0xffffffff}}, good, uint32_little{0}},
+            list<output>{} << output{satoshi{5000000000}, lock}, int32_little{0}}.write();
+        bytes first = consolidate(10, 0, -1);
+        bytes second = transaction{list<input>{} << input{outpoint{Gigamonkey::transaction::txid(first), index{0}}, good, uint32_little{0}},
+            list<output>{} << output{satoshi{1000}, lock}, int32_little{0}}.write();
+
+        v = validate_block(block_of({coinbase, first, second}), prevouts, pool);
+        EXPECT_TRUE(v.valid());
+        EXPECT_EQ(v.Transaction, 0);
+        ASSERT_EQ(v.Errors.size(), 3);
+        EXPECT_EQ(v.Errors[2].size(), 1);
+
+        // in the wrong order, the output of the first can't be found.
+        v = validate_block(block_of({coinbase, second, first}), prevouts, pool);
+        EXPECT_EQ(v.Status, script_validation::missing_prevout);
+        EXPECT_EQ(v.Transaction, 1);
+
+        v = validate_block(block_of({coinbase, consolidate(10, 0, 3), second}), prevouts, pool);
+        EXPECT_EQ(v.Status, script_validation::invalid_script);
+        EXPECT_EQ(v.Transaction, 1);
+        EXPECT_EQ(v.Input, 3);
+
+        // the pool can also be used directly.
+        std::vector<uint32> squares(1000);
+        pool.run(squares.size(), [&squares](uint32 i) {
+            squares[i] = i * i;
+        });
+        for (uint32 i = 0; i < squares.size(); i++) EXPECT_EQ(squares[i], i * i);
+    }
+
+    TEST(ValidationTest, TestRedeem) {
+        bytes lock = compile(program{} << OP_3 << OP_EQUAL);
+        ptr<redeemable> redeemer = std::make_shared<test_redeemable>(compile(program{} << OP_3));
+        digest256 external{uint256{7}};
+
+        list<data::entry<spendable, sighash::directive>> prev{};
+        for (uint32 i = 0; i < 20; i++) prev = prev << data::entry<spendable, sighash::directive>{
+            spendable{redeemer, prevout{output{satoshi{1000}, lock}, outpoint{external, index{i}}}, uint32_little{0xffffffff}},
+            sighash::all};
+        list<output> out = list<output>{} << output{satoshi{15000}, lock} << output{satoshi{4000}, lock};
+
+        // what the transaction should be, written without redeem.
+        list<input> inputs{};
+        for (uint32 i = 0; i < 20; i++)
+            inputs = inputs << input{outpoint{external, index{i}}, compile(program{} << OP_3), uint32_little{0xffffffff}};
+        bytes expected = transaction{inputs, out, int32_little{0}}.write();
+
+        // many transactions in the same arena.
+        arena a{};
+        std::vector<arena::span> txs{};
+        for (int i = 0; i < 10; i++) txs.push_back(redeem(a, prev, out, int32_little{0}));
+
+        vertex v = redeem(prev, out, int32_little{0});
+        ASSERT_EQ(v.Transaction.Inputs.size(), 20);
+        EXPECT_EQ(v.fee(), satoshi{1000});
+        EXPECT_TRUE(v.valid());
+        EXPECT_EQ(v.Transaction.write(), expected);
+        for (const arena::span& x : txs) EXPECT_EQ(a.view(x), bytes_view{expected});
+
+        thread_pool pool{2};
+        EXPECT_TRUE(validate(v, pool).valid());
+
+        // outputs worth more than the inputs.
+        EXPECT_EQ(redeem(a, prev, out << output{satoshi{2000}, lock}, int32_little{0}).Size, 0);
+        EXPECT_EQ(redeem(prev, out << output{satoshi{2000}, lock}, int32_little{0}).Transaction, transaction{});
+
+        // an input with a signature after one without. The signature
+        // is over the transaction with empty input scripts.
+        secret key(secret::main, secp256k1::secret(secp256k1::coordinate(12345)));
+        ptr<redeemable> signer = std::make_shared<test_signed>(key);
+        output prev_output{satoshi{1000}, lock};
+        outpoint first{external, index{20}};
+        outpoint second{external, index{21}};
+        sighash::directive d = directive(sighash::all);
+        list<output> change = list<output>{} << output{satoshi{1500}, lock};
+
+        list<data::entry<spendable, sighash::directive>> both = list<data::entry<spendable, sighash::directive>>{} <<
+            data::entry<spendable, sighash::directive>{spendable{redeemer, prevout{prev_output, first}, uint32_little{0xffffffff}}, d} <<
+            data::entry<spendable, sighash::directive>{spendable{signer, prevout{prev_output, second}, uint32_little{0xffffffff}}, d};
+
+        bytes unsigned_tx = transaction{list<input>{} <<
+            input{first, bytes{}, uint32_little{0xffffffff}} <<
+            input{second, bytes{}, uint32_little{0xffffffff}}, change, int32_little{0}}.write();
+        signature x = key.sign(input_index{prev_output, unsigned_tx, index{1}}, d);
+        bytes signed_tx = transaction{list<input>{} <<
+            input{first, compile(program{} << OP_3), uint32_little{0xffffffff}} <<
+            input{second, compile(program{} << push_data(x)), uint32_little{0xffffffff}}, change, int32_little{0}}.write();
+
+        EXPECT_EQ(a.view(redeem(a, both, change, int32_little{0})), bytes_view{signed_tx});
+        EXPECT_EQ(redeem(both, change, int32_little{0}).Transaction.write(), signed_tx);
+
+        a.clear();
+        EXPECT_EQ(a.size(), 0);
+    }
+
+    TEST(ValidationTest, TestSighashCache) {
+        bytes lock = compile(program{} << OP_3 << OP_EQUAL);
+        list<input> inputs{};
+        for (uint32 i = 0; i < 3; i++) inputs = inputs << input{outpoint{digest256{uint256{i + 1}}, index{i}}, compile(program{} << OP_3), uint32_little{i}};
+        bytes tx = transaction{inputs, list<output>{} << output{satoshi{500}, lock} << output{satoshi{700}, lock}, int32_little{0}}.write();
+        output prev{satoshi{1000}, lock};
+
+        sighash_cache cache{tx};
+        ASSERT_TRUE(cache.valid());
+        for (sighash::type t : {sighash::all, sighash::none, sighash::single}) for (bool anyone_can_pay : {false, true})
+            for (uint32 i = 0; i < 3; i++) {
+                sighash::directive d = directive(t, true, anyone_can_pay);
+                EXPECT_EQ(cache.hash(index{i}, prev, d), signature_hash(input_index{prev, tx, index{i}}, d));
+            }
+
+        // without fork id, or for an input that does not exist.
+        EXPECT_FALSE(cache.hash(index{0}, prev, directive(sighash::all, false)).valid());
+        EXPECT_FALSE(cache.hash(index{3}, prev, directive(sighash::all)).valid());
+        EXPECT_FALSE(sighash_cache{bytes{}}.valid());
+    }
+
+}
@@ -3,6 +3,7 @@
 // Distributed under the Open BSV software license, see the accompanying file LICENSE.
 
 #include <gigamonkey/work/proof.hpp>
+#include <gigamonkey/midstate.hpp>
 #include "dot_cross.hpp"
 #include "gtest/gtest.h"
 #include <iostream>
@@ -70,4 +71,26 @@ namespace Gigamonkey::work {
         
     }
 
+    TEST(WorkTest, TestMidstate) {
+        bytes message(200);
+        for (uint32 i = 0; i < message.size(); i++) message[i] = byte(i * 7 + 3);
+        bytes_view m{message.data(), message.size()};
+
+        // prefixes and suffixes on either side of a block boundary.
+        for (size_t prefix : {0, 1, 55, 63, 64, 65, 130}) for (size_t suffix : {0, 1, 8, 55, 56, 64, 70}) {
+            midstate x{m.substr(0, prefix)};
+            bytes_view rest = m.substr(prefix, suffix);
+            EXPECT_EQ(x.size(), prefix);
+            EXPECT_EQ(x.sha256(rest), sha256(m.substr(0, prefix + suffix)));
+            EXPECT_EQ(x.hash256(rest), Bitcoin::hash256(m.substr(0, prefix + suffix)));
+        }
+
+        // a batch that does not fill the last group of lanes.
+        const size_t count = 2 * midstate::lanes + 3;
+        midstate x{m.substr(0, 90)};
+        std::vector<digest256> hashes(count);
+        x.hash256(message.data(), 10, count, hashes.data());
+        for (size_t i = 0; i < count; i++) EXPECT_EQ(hashes[i], x.hash256(m.substr(10 * i, 10)));
+    }
+
 }